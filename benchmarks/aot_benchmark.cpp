@@ -0,0 +1,87 @@
+#include "aot_alu_loop.h"
+#include "aot_test_opcode.h"
+
+#include <chrono>
+#include <string>
+
+#define DEFAULT_STEPS 50000000  // Instructions executed per rom and engine
+#define CHUNK_STEPS 1000        // Instructions executed between halt checks
+
+/**
+ * The ways a recompiled rom is executed.
+ */
+enum MODE { MODE_EXEC_OP, MODE_INTERPRETER, MODE_AOT };
+
+/**
+ * Detects roms that finished by jumping to themselves or left memory.
+ * @param core Core to inspect
+ * @return Boolean indicating if the core stopped making progress
+ */
+bool is_halted(CHIP8CORE &core) {
+    uint16_t pc = core.get_pc();
+    if (pc >= MEM_SIZE - 1) {
+        return true;
+    }
+    uint16_t opcode = (uint16_t) core.get_mem()[pc] << 8 | core.get_mem()[pc + 1];
+    return opcode == (0x1000 | pc);
+}
+
+/**
+ * Runs a recompiled rom for a number of instructions, restarting it from its
+ * loaded state whenever it halts.
+ * @param module The recompiled rom
+ * @param mode Whether to step exec_op, run the interpreter or the module
+ * @param steps Number of instructions to execute
+ * @param stats Filled with the AOT counters of the run
+ * @return Instructions executed per second
+ */
+double run_mode(const AOT_MODULE &module, MODE mode, uint64_t steps,
+                AOT_STATS *stats) {
+    CHIP8AOT core(module);
+    CHIP8CORE pristine;
+    pristine.load_program_data(module.rom, module.rom_size);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; i += CHUNK_STEPS) {
+        if (mode == MODE_EXEC_OP) {
+            const uint8_t *mem = core.get_mem();
+            for (int step = 0; step < CHUNK_STEPS; step++) {
+                uint16_t pc = core.get_pc();
+                core.exec_op((uint16_t) mem[pc] << 8 | mem[pc + 1]);
+            }
+        } else if (mode == MODE_INTERPRETER) {
+            core.CHIP8CORE::run(CHUNK_STEPS);
+        } else {
+            core.run(CHUNK_STEPS);
+        }
+        if (is_halted(core)) {
+            static_cast<CHIP8CORE &>(core) = pristine;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    *stats = core.get_aot_stats();
+    return steps / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t steps = DEFAULT_STEPS;
+    if (argc == 3 && std::string(argv[1]) == "-n") {
+        steps = strtoull(argv[2], nullptr, 10);
+    }
+
+    const AOT_MODULE *modules[] = {&AOT_test_opcode, &AOT_alu_loop};
+    printf("%-16s %16s %16s %16s %8s %10s\n", "rom", "exec_op instr/s",
+           "interp instr/s", "aot instr/s", "speedup", "compiled %");
+    for (const AOT_MODULE *module : modules) {
+        AOT_STATS stats;
+        double exec_rate = run_mode(*module, MODE_EXEC_OP, steps, &stats);
+        double interp_rate = run_mode(*module, MODE_INTERPRETER, steps, &stats);
+        double aot_rate = run_mode(*module, MODE_AOT, steps, &stats);
+
+        uint64_t total = stats.compiled_steps + stats.interpreted_steps;
+        printf("%-16s %16.0f %16.0f %16.0f %7.2fx %9.1f%%\n", module->name,
+               exec_rate, interp_rate, aot_rate, aot_rate / exec_rate,
+               total ? 100.0 * stats.compiled_steps / total : 0.0);
+    }
+    return 0;
+}
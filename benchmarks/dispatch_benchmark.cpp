@@ -0,0 +1,328 @@
+#include "chip8_core.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define DEFAULT_STEPS 20000000  // Instructions executed per rom and engine
+#define CHUNK_STEPS 1000        // Instructions executed between halt checks
+
+/**
+ * Reference core that decodes with the nested opcode switch used before
+ * table-driven dispatch, kept to measure the dispatch speedup.
+ */
+class SWITCHCORE : public CHIP8CORE {
+  public:
+    bool step_switch() {
+        uint16_t opcode = (uint16_t) MEM[REGS.PC] << 8 | MEM[REGS.PC + 1];
+        return exec_switch(opcode);
+    }
+
+    bool exec_switch(uint16_t opcode) {
+        // Increment PC
+        REGS.PC += 2;
+
+        // Extract all argument information from the opcode
+        uint8_t x = (uint8_t)((opcode >> 8) & 0x0F);
+        uint8_t y = (uint8_t)((opcode >> 4) & 0x0F);
+        uint8_t kk = (uint8_t)(opcode & 0xFF);
+        uint8_t nibble = (uint8_t)(opcode & 0x0F);
+
+        // Decode and execute opcode
+        switch (opcode >> 12) {
+            case 0x0: {
+                // Two opcodes have first hex zero
+                switch (opcode) {
+                    case 0xE0:
+                        clear_screen();  // CLS - Clear Display
+                        break;
+                    case 0xEE:
+                        REGS.PC = REGS.STACK[REGS.SP];
+                        REGS.SP -= 1;  // RET - Restore PC from stack, decrement Stack
+                                  // Pointer
+                        break;
+                }
+                break;
+            }
+            case 0x1: {
+                REGS.PC = (0x0FFF & opcode);  // JMP - PC gets value of lower 12 bits
+                break;
+            }
+            case 0x2: {
+                REGS.SP += 1;
+                REGS.STACK[REGS.SP] = REGS.PC;
+                REGS.PC = (0x0FFF & opcode);  // CALL - Increment Stack Pointer, store
+                                         // PC, PC gets lower 12 bits
+                break;
+            }
+            case 0x3: {
+                REGS.PC = ((REGS.V[x] == kk) ? REGS.PC + 2 : REGS.PC);  // Skip Equal, skip next
+                                                    // instruction if Vx == kk
+                break;
+            }
+            case 0x4: {
+                REGS.PC = ((REGS.V[x] != kk) ? REGS.PC + 2 : REGS.PC);  // Skip Not Equal, skip next
+                                                    // instruction if Vx != kk
+                break;
+            }
+            case 0x5: {
+                REGS.PC = ((REGS.V[x] == REGS.V[y]) ? REGS.PC + 2 : REGS.PC);  // Skip Equal, skip next
+                                                      // instruction if Vx == Vy
+                break;
+            }
+            case 0x6: {
+                REGS.V[x] = kk;  // LoaD Vx with kk
+                break;
+            }
+            case 0x7: {
+                REGS.V[x] += kk;  // ADD kk to Vx
+                break;
+            }
+            case 0x8: {  // Nine opcodes begin with Hex 8
+                switch (opcode & 0xF) {
+                    case 0x0: {
+                        REGS.V[x] = REGS.V[y];  // LoaD Vx with Vy
+                        break;
+                    }
+                    case 0x1: {
+                        REGS.V[x] |= REGS.V[y];  // OR Vx with Vy
+                        break;
+                    }
+                    case 0x2: {
+                        REGS.V[x] &= REGS.V[y];  // AND Vx with Vy
+                        break;
+                    }
+                    case 0x3: {
+                        REGS.V[x] ^= REGS.V[y];  // XOR Vx with Vy
+                        break;
+                    }
+                    case 0x4: {
+                        REGS.V[0xF] = (((REGS.V[x] + REGS.V[y]) > 255) ? 1 : 0);
+                        REGS.V[x] += REGS.V[y];  // Add Vx with Vy, store carry bit into VF
+                        break;
+                    }
+                    case 0x5: {
+                        REGS.V[0xF] = ((REGS.V[x] > REGS.V[y]) ? 1 : 0);
+                        REGS.V[x] -= REGS.V[y];  // Subtract Vy from Vx, store borrow bit into
+                                       // VF
+                        break;
+                    }
+                    case 0x6: {
+                        REGS.V[0xF] = ((REGS.V[x] & 0x1) != 0 ? 1 : 0);
+                        REGS.V[x] = (REGS.V[x] >> 1);  // VF gets LSB of Vx, Vx gets
+                                             // bitshifted to the right by 1
+                        break;
+                    }
+                    case 0x7: {
+                        REGS.V[0xF] = ((REGS.V[y] > REGS.V[x]) ? 1 : 0);
+                        REGS.V[x] = REGS.V[y] -
+                               REGS.V[x];  // Vx gets Vy - Vx, store borrow bit into VF
+                        break;
+                    }
+                    case 0xE: {
+                        REGS.V[0xF] = ((REGS.V[x] & 0x80) != 0 ? 1 : 0);
+                        REGS.V[x] = (REGS.V[x] << 1);  // VF gets MSB of Vx, Vx gets
+                                             // bitshifted to the left by 1
+                        break;
+                    }
+                }
+                break;
+            }
+            case 0x9: {
+                REGS.PC = ((REGS.V[x] != REGS.V[y]) ? REGS.PC + 2 : REGS.PC);  // Skip Not Equal, skip next
+                                                      // instruction if Vx != Vy
+                break;
+            }
+            case 0xA: {
+                REGS.I = (opcode & 0xFFF);  // LoaD I, I gets lower 12 bits of opcode
+                break;
+            }
+            case 0xB: {
+                REGS.PC = REGS.V[0] +
+                     (opcode & 0xFFF);  // JMP, PC gets V0 + lower 12 bits of opcode
+                break;
+            }
+            case 0xC: {
+                // Vx gets a random number ANDed with lower byte of opcode
+                REGS.V[x] = (uint8_t)(rand() % 256) & kk;
+                break;
+            }
+            case 0xD: {
+                return draw_sprite(REGS.V[x], REGS.V[y],
+                                   nibble);  // Draw sprite at coordinate x, y that
+                                             // is nibble-lines long
+            }
+            case 0xE: {  // 2 Opcodes begin with Hex E
+                if ((opcode & 0xFF) == 0x9E) {
+                    if (get_key_status(REGS.V[x])) {
+                        REGS.PC += 2;
+                    }
+                } else if ((opcode & 0xFF) == 0xA1) {
+                    if (!get_key_status(REGS.V[x])) {
+                        REGS.PC += 2;
+                    }
+                }
+                break;
+            }
+            case 0xF: {
+                // Nine opcodes begin with Hex F
+                switch (opcode & 0xFF) {
+                    case 0x7: {
+                        REGS.V[x] = REGS.DT;  // Vx gets Delay Timer value
+                        break;
+                    }
+                    case 0xA: {
+                        REGS.PC -= 2;
+                        for (uint8_t key = 0; key < NUM_KEYS; key++) {
+                            if (REGS.KEYS[key]) {
+                                REGS.V[x] = key;
+                                REGS.PC += 2;
+                                break;
+                            }
+                        }
+                        break;
+                    }
+                    case 0x15: {
+                        REGS.DT = REGS.V[x];  // Delay Timer gets Vx
+                        break;
+                    }
+                    case 0x18: {
+                        REGS.ST = REGS.V[x];  // Sound Timer gets Vx
+                        break;
+                    }
+                    case 0x1E: {
+                        REGS.I += REGS.V[x];  // I gets incremented by Vx
+                        break;
+                    }
+                    case 0x29: {
+                        REGS.I = 5 * REGS.V[x];  // I gets address of sprite corresponding to
+                        break;         // value in Vx
+                    }
+                    case 0x33: {
+                        MEM[REGS.I] = REGS.V[x] / 100;
+                        MEM[REGS.I + 1] = (REGS.V[x] % 100) / 10;
+                        MEM[REGS.I + 2] = (REGS.V[x] % 10);  // Store BCD representation of Vx
+                        break;                     // in I, I+1, I+2
+                    }
+                    case 0x55: {
+                        for (int i = 0; i <= x; i++) {
+                            MEM[REGS.I + i] = REGS.V[i];  // Store V0 through Vx starting at
+                                                // memory I
+                        }
+                        break;
+                    }
+                    case 0x65: {
+                        for (int i = 0; i <= x; i++) {
+                            REGS.V[i] = MEM[REGS.I + i];  // Load V0 through Vx with values
+                                                // starting at memory I
+                        }
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+        return false;
+}
+};
+
+/**
+ * Checks if a core is halted on a jump to its own address.
+ * @param core Core to check
+ * @return Boolean indicating if the core is spinning on a jump to itself
+ */
+bool is_halted(CHIP8CORE &core) {
+    uint16_t pc = core.get_pc();
+    if (pc >= MEM_SIZE - 1) {
+        return true;
+    }
+    uint16_t opcode = (uint16_t) core.get_mem()[pc] << 8 | core.get_mem()[pc + 1];
+    return opcode == (0x1000 | pc);
+}
+
+/**
+ * Runs a core for a number of instructions in chunks, restarting the rom from
+ * its loaded state whenever it halts.
+ * @param pristine Core with the rom loaded
+ * @param steps Number of instructions to execute
+ * @param run_chunk Function executing a chunk of instructions on the core
+ * @return Instructions executed per second
+ */
+template <typename RUN>
+double run_engine(const SWITCHCORE &pristine, uint64_t steps, RUN run_chunk) {
+    SWITCHCORE core = pristine;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; i += CHUNK_STEPS) {
+        run_chunk(core);
+        if (is_halted(core)) {
+            core = pristine;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return steps / elapsed.count();
+}
+
+/**
+ * Runs the block cached engine over a rom and collects its cache counters.
+ * @param pristine Core with the rom loaded
+ * @param steps Number of instructions to execute
+ * @return Block cache counters summed over every restart of the rom
+ */
+CACHE_STATS collect_cache_stats(const SWITCHCORE &pristine, uint64_t steps) {
+    CACHE_STATS total = {0, 0, 0};
+    SWITCHCORE core = pristine;
+    for (uint64_t i = 0; i < steps; i += CHUNK_STEPS) {
+        core.run(CHUNK_STEPS);
+        if (is_halted(core) || i + CHUNK_STEPS >= steps) {
+            CACHE_STATS stats = core.get_cache_stats();
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.invalidations += stats.invalidations;
+            core = pristine;
+        }
+    }
+    return total;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t steps = DEFAULT_STEPS;
+    std::vector<const char *> roms;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-n" && i + 1 < argc) {
+            steps = strtoull(argv[++i], nullptr, 10);
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+    if (roms.empty()) {
+        roms.push_back("test_opcode.ch8");
+    }
+
+    printf("%-32s %16s %16s %8s %12s %12s %12s\n", "rom", "switch instr/s",
+           "cached instr/s", "speedup", "hits", "misses", "invalidations");
+    for (const char *rom : roms) {
+        SWITCHCORE switch_core;
+        if (!switch_core.load_program(rom)) {
+            return -1;
+        }
+
+        double switch_rate = run_engine(switch_core, steps, [](SWITCHCORE &c) {
+            for (int i = 0; i < CHUNK_STEPS; i++) {
+                c.step_switch();
+            }
+        });
+        double cached_rate = run_engine(switch_core, steps, [](SWITCHCORE &c) {
+            c.run(CHUNK_STEPS);
+        });
+
+        CACHE_STATS stats = collect_cache_stats(switch_core, steps);
+
+        printf("%-32s %16.0f %16.0f %7.2fx %12llu %12llu %12llu\n", rom,
+               switch_rate, cached_rate, cached_rate / switch_rate,
+               (unsigned long long) stats.hits,
+               (unsigned long long) stats.misses,
+               (unsigned long long) stats.invalidations);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+#include "chip8_jit.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define DEFAULT_STEPS 50000000  // Instructions executed per rom and engine
+#define CHUNK_STEPS 1000        // Instructions executed between halt checks
+
+/**
+ * Detects roms that finished by jumping to themselves or left memory.
+ * @param core Core to inspect
+ * @return Boolean indicating if the core stopped making progress
+ */
+bool is_halted(CHIP8CORE &core) {
+    uint16_t pc = core.get_pc();
+    if (pc >= MEM_SIZE - 1) {
+        return true;
+    }
+    uint16_t opcode = (uint16_t) core.get_mem()[pc] << 8 | core.get_mem()[pc + 1];
+    return opcode == (0x1000 | pc);
+}
+
+/**
+ * Runs a rom on one engine for a number of instructions, restarting it from
+ * its loaded state whenever it halts.
+ * @param pristine Core with the rom loaded
+ * @param engine Engine to run the rom on
+ * @param steps Number of instructions to execute
+ * @param stats Filled with the JIT counters of the last restart
+ * @return Instructions executed per second
+ */
+double run_engine(const CHIP8CORE &pristine, ENGINE engine, uint64_t steps,
+                  JIT_STATS *stats) {
+    CHIP8JIT core;
+    core = pristine;
+    core.set_engine(engine);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; i += CHUNK_STEPS) {
+        core.run(CHUNK_STEPS);
+        if (is_halted(core)) {
+            core = pristine;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    *stats = core.get_jit_stats();
+    return steps / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t steps = DEFAULT_STEPS;
+    std::vector<const char *> roms;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-n" && i + 1 < argc) {
+            steps = strtoull(argv[++i], nullptr, 10);
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+    if (roms.empty()) {
+        roms.push_back("test_opcode.ch8");
+    }
+    if (!CHIP8JIT::jit_supported()) {
+        printf("JIT engine not available on this host\n");
+    }
+
+    printf("%-32s %16s %16s %8s %10s\n", "rom", "interp instr/s", "jit instr/s",
+           "speedup", "native %");
+    for (const char *rom : roms) {
+        CHIP8CORE pristine;
+        if (!pristine.load_program(rom)) {
+            return -1;
+        }
+
+        JIT_STATS stats;
+        double interp_rate =
+                run_engine(pristine, ENGINE_INTERPRETER, steps, &stats);
+        double jit_rate = run_engine(pristine, ENGINE_JIT, steps, &stats);
+
+        uint64_t total = stats.native_steps + stats.fallback_steps;
+        printf("%-32s %16.0f %16.0f %7.2fx %9.1f%%\n", rom, interp_rate,
+               jit_rate, jit_rate / interp_rate,
+               total ? 100.0 * stats.native_steps / total : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "chip8_lockstep.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define DEFAULT_LANES 256
+#define DEFAULT_FRAMES 600       // Ten seconds of emulated time
+#define STEPS_PER_FRAME 1000
+
+/**
+ * Runs one core per instance, one after another, the way chip8_batch runs
+ * jobs on a single thread.
+ * @param rom The program
+ * @param lanes Number of instances
+ * @param frames Number of frames to run
+ * @return Instance instructions executed per second
+ */
+double run_cores(const std::vector<uint8_t> &rom, uint32_t lanes,
+                 uint32_t frames) {
+    std::vector<std::unique_ptr<CHIP8CORE>> cores;
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        cores.emplace_back(new CHIP8CORE());
+        cores[lane]->load_program_data(rom.data(), rom.size());
+        cores[lane]->seed_rng(lane);
+    }
+
+    uint64_t steps = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            steps += cores[lane]->run_frame(STEPS_PER_FRAME);
+        }
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return steps / elapsed.count();
+}
+
+/**
+ * Runs every instance on one lockstep engine.
+ * @param rom The program
+ * @param lanes Number of instances
+ * @param frames Number of frames to run
+ * @param stats Filled with the lane utilization counters
+ * @return Instance instructions executed per second
+ */
+double run_lockstep(const std::vector<uint8_t> &rom, uint32_t lanes,
+                    uint32_t frames, LOCKSTEP_STATS *stats) {
+    CHIP8LOCKSTEP lockstep(lanes);
+    lockstep.load_program_data(rom.data(), rom.size());
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        lockstep.seed_rng(lane, lane);
+    }
+
+    uint64_t steps = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        steps += lockstep.run(STEPS_PER_FRAME);
+        lockstep.tick_timers();
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    *stats = lockstep.get_lockstep_stats();
+    return steps / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t lanes = DEFAULT_LANES;
+    uint32_t frames = DEFAULT_FRAMES;
+    std::vector<const char *> roms;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            lanes = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-f" && i + 1 < argc) {
+            frames = strtoul(argv[++i], nullptr, 10);
+        } else {
+            roms.push_back(argv[i]);
+        }
+    }
+    if (roms.empty()) {
+        roms.push_back("alu_loop.ch8");
+        roms.push_back("test_opcode.ch8");
+    }
+
+    printf("%-32s %6s %16s %16s %8s %12s\n", "rom", "lanes", "cores instr/s",
+           "lockstep instr/s", "speedup", "lanes/issue");
+    for (const char *rom_path : roms) {
+        FILE *file = fopen(rom_path, "rb");
+        if (file == nullptr) {
+            printf("Unable to open file %s\n", rom_path);
+            return -1;
+        }
+        std::vector<uint8_t> rom(MAX_PROG_SIZE);
+        rom.resize(fread(rom.data(), 1, rom.size(), file));
+        fclose(file);
+
+        LOCKSTEP_STATS stats;
+        double cores_rate = run_cores(rom, lanes, frames);
+        double lockstep_rate = run_lockstep(rom, lanes, frames, &stats);
+        printf("%-32s %6u %16.0f %16.0f %7.2fx %12.1f\n", rom_path, lanes,
+               cores_rate, lockstep_rate, lockstep_rate / cores_rate,
+               stats.issues ? (double) stats.lane_steps / stats.issues : 0.0);
+    }
+    return 0;
+}
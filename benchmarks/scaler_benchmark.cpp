@@ -0,0 +1,109 @@
+#include "chip8_scaler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define DEFAULT_FRAMES 200
+
+/**
+ * Draws a framebuffer the way VIDEO drew its pixel map before the scaler,
+ * one CHIP 8 pixel at a time with a store per target pixel.
+ * @param frame Rows of the framebuffer
+ * @param pixels Target of width x height pixels
+ * @param width Width of the target
+ * @param height Height of the target
+ */
+void draw_pixels(const uint64_t *frame, uint32_t *pixels, int width,
+                 int height) {
+    int pixel_width = width / SCREEN_WIDTH;
+    int pixel_height = height / SCREEN_HEIGHT;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            uint32_t rgb = frame_pixel(frame, x, y) ? 0xFFFFFF : 0;
+            uint32_t *pixmem =
+                    pixels + x * pixel_width + y * pixel_height * width;
+            for (int screen_y = 0; screen_y < pixel_height; screen_y++) {
+                for (int screen_x = 0; screen_x < pixel_width; screen_x++) {
+                    *(pixmem + screen_x + screen_y * width) = rgb;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Times drawing frames with one of the ways of scaling.
+ * @param draw Function drawing the framebuffer into the target
+ * @param frames Number of frames to draw
+ * @return Milliseconds per frame
+ */
+template <typename DRAW>
+double time_frames(const DRAW &draw, uint32_t frames) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        draw(frame);
+    }
+    std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t frames = DEFAULT_FRAMES;
+    unsigned threads = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-f" && i + 1 < argc) {
+            frames = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = strtoul(argv[++i], nullptr, 10);
+        }
+    }
+
+    // A checkerboard that shifts every frame, so no frame is the same
+    std::vector<uint64_t> frame(SCREEN_HEIGHT);
+    auto next_frame = [&](uint32_t index) {
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            frame[y] = 0xAAAAAAAAAAAAAAAA >> ((y + index) & 1);
+        }
+    };
+
+    WORK_STEALING_POOL pool(threads);
+    int sizes[][2] = {{640, 480}, {1920, 1080}, {3840, 2160}};
+    printf("%-10s %8s %14s %14s %14s %8s\n", "target", "threads",
+           "per pixel ms", "scaler ms", "banded ms", "speedup");
+    for (auto &size : sizes) {
+        int width = size[0], height = size[1];
+        int pitch = width * sizeof(uint32_t);
+        std::vector<uint32_t> pixels(width * height);
+
+        double pixel_ms = time_frames(
+                [&](uint32_t index) {
+                    next_frame(index);
+                    draw_pixels(frame.data(), pixels.data(), width, height);
+                },
+                frames);
+        double scaler_ms = time_frames(
+                [&](uint32_t index) {
+                    next_frame(index);
+                    scale_frame(frame.data(), 0, 0xFFFFFF, pixels.data(),
+                                width, height, pitch);
+                },
+                frames);
+        double banded_ms = time_frames(
+                [&](uint32_t index) {
+                    next_frame(index);
+                    scale_frame(frame.data(), 0, 0xFFFFFF, pixels.data(),
+                                width, height, pitch, &pool);
+                },
+                frames);
+        std::string target = std::to_string(width) + "x" +
+                             std::to_string(height);
+        printf("%-10s %8u %14.3f %14.3f %14.3f %7.2fx\n", target.c_str(),
+               pool.get_threads(), pixel_ms, scaler_ms, banded_ms,
+               pixel_ms / std::min(scaler_ms, banded_ms));
+    }
+    return 0;
+}
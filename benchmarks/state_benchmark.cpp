@@ -0,0 +1,112 @@
+#include "chip8_core.h"
+#include "chip8_rewind.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#define DEFAULT_CLONES 1000000
+#define POOL_SIZE 64  // Clones kept alive, like the frontier of a tree search
+
+/**
+ * Measures the time per iteration of a function.
+ * @param count Number of iterations
+ * @param body Function called with the iteration number
+ * @return Nanoseconds per iteration
+ */
+template <typename F>
+double time_ns(uint64_t count, F body) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++) {
+        body(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count() / count;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t clones = DEFAULT_CLONES;
+    const char *rom = "test_opcode.ch8";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            clones = strtoull(argv[++i], nullptr, 10);
+        } else {
+            rom = argv[i];
+        }
+    }
+
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    if (!core->load_program(rom)) {
+        return -1;
+    }
+    core->run(1000);
+    std::vector<MACHINE_STATE> pool(POOL_SIZE);
+
+    // Forking copies the state, restoring also checks which code pages
+    // changed, a rollout runs a frame from the restored state
+    double clone_ns = time_ns(clones, [&](uint64_t i) {
+        pool[i % POOL_SIZE] = core->get_state();
+    });
+    double restore_ns = time_ns(clones, [&](uint64_t i) {
+        core->set_state(pool[i % POOL_SIZE]);
+    });
+    double rollout_ns = time_ns(clones / 10, [&](uint64_t i) {
+        core->set_state(pool[i % POOL_SIZE]);
+        core->run_frame(12);
+    });
+
+
+    // Snapshots share the pages the rollouts did not write
+    std::vector<SNAPSHOT> snapshots(POOL_SIZE);
+    double snapshot_ns = time_ns(clones, [&](uint64_t i) {
+        snapshots[i % POOL_SIZE] = core->snapshot();
+    });
+    double restore_snapshot_ns = time_ns(clones, [&](uint64_t i) {
+        core->restore(snapshots[i % POOL_SIZE]);
+    });
+    double snapshot_rollout_ns = time_ns(clones / 10, [&](uint64_t i) {
+        core->restore(snapshots[i % POOL_SIZE]);
+        core->run_frame(12);
+        snapshots[(i + 1) % POOL_SIZE] = core->snapshot();
+    });
+
+    // Serialized states can cross threads, processes and files
+    std::vector<uint8_t> bytes(SERIALIZED_STATE_SIZE);
+    double serialize_ns = time_ns(clones, [&](uint64_t /*i*/) {
+        core->serialize(bytes.data(), bytes.size());
+    });
+    double deserialize_ns = time_ns(clones, [&](uint64_t /*i*/) {
+        core->deserialize(bytes.data(), bytes.size());
+    });
+
+    // Rewinding records a frame and steps back through the recorded ones
+    std::unique_ptr<CHIP8REWIND> rewind(new CHIP8REWIND());
+    double record_ns = time_ns(clones / 10, [&](uint64_t /*i*/) {
+        core->run_frame(12);
+        rewind->push(*core);
+    });
+    size_t recorded = rewind->get_frames();
+    size_t recorded_bytes = rewind->get_used_bytes();
+    double step_back_ns = time_ns(recorded - 1, [&](uint64_t /*i*/) {
+        rewind->step_back(*core);
+    });
+
+    printf("state size %zu bytes, alignment %zu\n", sizeof(MACHINE_STATE),
+           alignof(MACHINE_STATE));
+    printf("%-24s %10.1f ns\n", "clone", clone_ns);
+    printf("%-24s %10.1f ns\n", "restore", restore_ns);
+    printf("%-24s %10.1f ns\n", "restore + 12 instr", rollout_ns);
+    printf("%-24s %10.1f ns\n", "snapshot", snapshot_ns);
+    printf("%-24s %10.1f ns\n", "restore snapshot", restore_snapshot_ns);
+    printf("%-24s %10.1f ns\n", "restore + 12 + snapshot", snapshot_rollout_ns);
+    printf("%-24s %10.1f ns\n", "serialize", serialize_ns);
+    printf("%-24s %10.1f ns\n", "deserialize", deserialize_ns);
+    printf("%-24s %10.1f ns\n", "12 instr + rewind push", record_ns);
+    printf("%-24s %10.1f ns\n", "rewind step back", step_back_ns);
+    printf("rewind history %zu frames in %zu bytes\n", recorded,
+           recorded_bytes);
+    return 0;
+}
@@ -0,0 +1,14 @@
+# Recompiles a CHIP 8 ROM ahead of time with the chip8_aot tool into a static
+# library TARGET exposing the module AOT_<NAME>, declared in aot_<NAME>.h
+function(chip8_add_aot_rom TARGET NAME ROM)
+    get_filename_component(AOT_ROM ${ROM} ABSOLUTE)
+    set(AOT_SOURCE ${CMAKE_CURRENT_BINARY_DIR}/aot_${NAME}.cpp)
+    set(AOT_HEADER ${CMAKE_CURRENT_BINARY_DIR}/aot_${NAME}.h)
+    add_custom_command(OUTPUT ${AOT_SOURCE} ${AOT_HEADER}
+            COMMAND chip8_aot ${AOT_ROM} ${NAME} ${AOT_SOURCE} ${AOT_HEADER}
+            DEPENDS chip8_aot ${AOT_ROM}
+            COMMENT "Recompiling ${ROM}")
+    add_library(${TARGET} STATIC ${AOT_SOURCE})
+    target_include_directories(${TARGET} PUBLIC ${CMAKE_CURRENT_BINARY_DIR})
+    target_link_libraries(${TARGET} chip8_core)
+endfunction()
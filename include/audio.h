@@ -65,6 +65,10 @@ class AUDIO {
 
     ~AUDIO();
 
+    // Copies would close the same audio device
+    AUDIO(const AUDIO &) = delete;
+    AUDIO &operator=(const AUDIO &) = delete;
+
     bool init();
 
     void play_tone();
@@ -0,0 +1,90 @@
+#ifndef CHIP8_AOT_H
+#define CHIP8_AOT_H
+
+#include <vector>
+
+#include "chip8_core.h"
+
+class CHIP8AOT;
+
+// Entry point of a recompiled ROM, runs at most max_steps instructions and
+// returns how many it executed, stopping early where the interpreter is needed
+typedef uint32_t (*AOT_FN)(CHIP8AOT &core, uint32_t max_steps);
+
+/**
+ * A ROM translated ahead of time into C++ by the chip8_aot tool.
+ */
+struct AOT_MODULE {
+    const char *name;    // Name the module was generated with
+    const uint8_t *rom;  // ROM image the code was translated from
+    uint16_t rom_size;   // Size of the ROM image in bytes
+    AOT_FN run;          // Translated code
+};
+
+/**
+ * Counters describing how much of a ROM ran as recompiled code.
+ */
+struct AOT_STATS {
+    uint64_t compiled_steps;     // Instructions executed by recompiled code
+    uint64_t interpreted_steps;  // Instructions executed by the interpreter
+};
+
+/**
+ * CHIP 8 core running a ROM recompiled ahead of time.  The recompiled code
+ * handles every instruction it found by following the ROM's control flow,
+ * the interpreter takes over for indirect Bnnn jumps, addresses that were not
+ * discovered and code that no longer matches the ROM image.
+ */
+class CHIP8AOT : public CHIP8CORE {
+  public:
+    // Main constructor for CHIP8AOT, loads the module's ROM image
+    CHIP8AOT(const AOT_MODULE &module);
+
+    // Function for executing a batch of instructions
+    uint32_t run(uint32_t max_steps);
+
+    // Function that returns if memory still holds the ROM image at a block
+    inline bool block_intact(uint16_t addr, uint16_t length) {
+        uint32_t first = PAGE_VERSION[addr / CODE_PAGE_SIZE];
+        uint32_t last = PAGE_VERSION[(addr + length - 1) / CODE_PAGE_SIZE];
+        return (first == verified[addr].first && last == verified[addr].last) ||
+               verify_block(addr, length);
+    }
+
+    // Function that returns the recompiled and interpreted step counts
+    AOT_STATS get_aot_stats();
+
+  private:
+    friend struct AOT_ACCESS;
+
+    /**
+     * Page versions at which a block was last found to match the ROM image.
+     */
+    struct VERIFIED {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    // Function for comparing a block of memory against the ROM image
+    bool verify_block(uint16_t addr, uint16_t length);
+
+    const AOT_MODULE *module;       // Recompiled ROM
+    std::vector<VERIFIED> verified;  // Last verified versions per address
+    AOT_STATS aot_stats;             // Step counters
+};
+
+/**
+ * Access to the machine state for recompiled code.
+ */
+struct AOT_ACCESS {
+    static uint8_t *V(CHIP8AOT &core) { return core.REGS.V; }
+    static uint16_t &I(CHIP8AOT &core) { return core.REGS.I; }
+    static uint16_t &PC(CHIP8AOT &core) { return core.REGS.PC; }
+    static uint8_t &SP(CHIP8AOT &core) { return core.REGS.SP; }
+    static uint16_t *STACK(CHIP8AOT &core) { return core.REGS.STACK; }
+    static uint8_t *MEM(CHIP8AOT &core) { return core.MEM; }
+    static uint8_t &DT(CHIP8AOT &core) { return core.REGS.DT; }
+    static uint8_t &ST(CHIP8AOT &core) { return core.REGS.ST; }
+};
+
+#endif
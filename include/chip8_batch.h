@@ -0,0 +1,127 @@
+#ifndef CHIP8_BATCH_H
+#define CHIP8_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8_core.h"
+#include "chip8_rom_cache.h"
+
+/**
+ * A key change applied at the start of a frame by an input script.
+ */
+struct INPUT_EVENT {
+    uint32_t frame;  // Frame the change happens at, counted from 0
+    uint8_t key;     // Hex key
+    bool pressed;    // New state of the key
+};
+
+/**
+ * One headless run: a ROM, a seed for Cxkk and the keys pressed over time.
+ */
+struct BATCH_JOB {
+    std::string rom;                  // Path of the ROM
+    uint64_t seed;                    // Seed of the core's generator
+    std::string script;               // Path of the input script, or empty
+    std::vector<INPUT_EVENT> events;  // Parsed input script, sorted by frame
+};
+
+/**
+ * Limits shared by every job of a batch.
+ */
+struct BATCH_OPTIONS {
+    uint32_t frames;           // Frames to run each job for at most
+    uint32_t steps_per_frame;  // Instructions executed per frame
+};
+
+/**
+ * What a job left behind.
+ */
+struct BATCH_RESULT {
+    bool loaded;          // False if the ROM could not be loaded
+    bool halted;          // Stopped early by jumping to itself or escaping
+    uint32_t frames;      // Frames run
+    uint64_t steps;       // Instructions executed, including skipped idle loops
+    uint64_t frame_hash;  // FNV-1a hash of the final framebuffer
+    double seconds;       // Wall time of the job
+};
+
+/**
+ * Thread pool that spreads tasks over per-worker queues.  Workers take their
+ * own tasks from the back of their queue and steal from the front of the
+ * others once it runs dry, so long and short tasks balance out.  The worker
+ * threads live as long as the pool and sleep between runs.
+ */
+class WORK_STEALING_POOL {
+  public:
+    // Main constructor for WORK_STEALING_POOL, 0 uses every hardware thread
+    WORK_STEALING_POOL(unsigned threads = 0);
+
+    // Main destructor for WORK_STEALING_POOL, stops the worker threads
+    ~WORK_STEALING_POOL();
+
+    // Function for running task(i) for every i below count on the workers
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+    // Function that returns the number of worker threads
+    unsigned get_threads();
+
+    // Function that returns how many tasks were stolen by the last run
+    uint64_t get_steals();
+
+  private:
+    /**
+     * Tasks queued for one worker.
+     */
+    struct QUEUE {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    // Function for taking the next task of a worker, stealing if needed
+    bool next_task(unsigned worker, size_t &task);
+
+    // Function for running the tasks of a worker until every queue is empty
+    void drain(unsigned worker, const std::function<void(size_t)> &task);
+
+    // Function run by each worker thread, waits for runs until destruction
+    void work(unsigned worker);
+
+    unsigned threads;                             // Number of workers
+    std::vector<std::unique_ptr<QUEUE>> queues;  // One queue per worker
+    std::atomic<uint64_t> steals;                 // Tasks run by a thief
+
+    std::vector<std::thread> workers;  // Threads of every worker but the first
+    std::mutex lock;                   // Guards the members below
+    std::condition_variable wake;      // Signals a new run or destruction
+    std::condition_variable done;      // Signals the last worker finishing
+    const std::function<void(size_t)> *current;  // Task of the current run
+    uint64_t generation;  // Runs started, workers wake when it changes
+    unsigned busy;        // Worker threads still draining the current run
+    bool stopping;        // Set by the destructor
+};
+
+// Function for parsing an input script of "<frame> <hex key> <down|up>" lines
+bool load_input_script(const char *path, std::vector<INPUT_EVENT> &events);
+
+// Function for hashing a framebuffer with 64-bit FNV-1a
+uint64_t hash_frame_buffer(const uint64_t *frame);
+
+// Function for running one job on a ROM image already in memory
+BATCH_RESULT run_job(const BATCH_JOB &job, const uint8_t *rom, size_t size,
+                     const BATCH_OPTIONS &options,
+                     uint16_t quirks = QUIRKS_DEFAULT);
+
+// Function for running every job of a batch on a pool
+std::vector<BATCH_RESULT> run_batch(const std::vector<BATCH_JOB> &jobs,
+                                    const BATCH_OPTIONS &options,
+                                    WORK_STEALING_POOL &pool);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CHIP8_BUNDLE_H
+#define CHIP8_BUNDLE_H
+
+#include <string>
+#include <vector>
+
+#include "chip8_rom_cache.h"
+
+#define BUNDLE_VERSION 1       // Version of the bundle file format
+#define BUNDLE_HEADER_SIZE 16  // Magic, version, header size, counts
+#define BUNDLE_ENTRY_SIZE 24   // Bytes per ROM in the index
+
+/**
+ * A ROM of a bundle, as listed in its index.
+ */
+struct BUNDLE_ENTRY {
+    std::string name;  // Name the ROM is referenced by
+    uint64_t hash;     // FNV-1a hash of the image
+    uint32_t offset;   // Offset of the image in the bundle
+    uint32_t size;     // Bytes of the image
+    uint16_t quirks;   // Quirk profile the ROM runs with, 0 for the default
+};
+
+/**
+ * A ROM to write into a bundle.
+ */
+struct BUNDLE_ROM {
+    std::string name;           // Name the ROM is referenced by
+    uint16_t quirks;            // Quirk profile the ROM runs with
+    std::vector<uint8_t> data;  // The image
+};
+
+/**
+ * A read-only bundle of many ROMs in one file.  The file holds a header
+ * (magic "C8PK", 16-bit version, 16-bit header size, 32-bit ROM count,
+ * 32-bit name bytes), an index of hash, offset, size, name and quirk
+ * profile per ROM, the names, and the images one after another.  The file
+ * is mapped once and the index parsed on open, after which every ROM is
+ * found by name without touching the filesystem.
+ */
+class ROM_BUNDLE {
+  public:
+    // Main constructor for ROM_BUNDLE, nothing is mapped
+    ROM_BUNDLE();
+
+    // Main destructor for ROM_BUNDLE, unmaps the file
+    ~ROM_BUNDLE();
+
+    // A mapping has a single owner, share the bundle through a shared_ptr
+    ROM_BUNDLE(const ROM_BUNDLE &) = delete;
+    ROM_BUNDLE &operator=(const ROM_BUNDLE &) = delete;
+
+    // Function for mapping a bundle and reading its index
+    bool open(const char *path);
+
+    // Function for unmapping the bundle
+    void close();
+
+    // Function for finding a ROM by name
+    const BUNDLE_ENTRY *find(const char *name) const;
+
+    // Function that returns every ROM, sorted by name
+    const std::vector<BUNDLE_ENTRY> &get_entries() const;
+
+    // Function that returns the image of a ROM
+    const uint8_t *get_data(const BUNDLE_ENTRY &entry) const;
+
+  private:
+    const uint8_t *data;                // Start of the mapping, or null
+    size_t size;                        // Bytes of the file
+    std::vector<BUNDLE_ENTRY> entries;  // The index, sorted by name
+};
+
+// Function for writing a bundle, images with equal contents are stored once
+bool write_bundle(const char *path, const std::vector<BUNDLE_ROM> &roms);
+
+#endif
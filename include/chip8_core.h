@@ -0,0 +1,596 @@
+#ifndef CHIP8_CORE_H
+#define CHIP8_CORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+
+#define MEM_SIZE 4096        // 4kB memory
+#define REG_SIZE 16          // 16 Registers
+#define STACK_SIZE 16        // 16 Stack entries
+#define PC_START 0x200       // Programs start at 0x200
+#define MAX_PROG_SIZE 0xD00  // Maximum allowable size of program
+#define ETI_START 0x600      // Start of ETI area in memory
+#define MAP_LENGTH (5 * 16)  // Size of Sprite Map
+#define SCREEN_WIDTH 64      // CHIP 8 display dimensions
+#define SCREEN_HEIGHT 32
+#define NUM_KEYS 16  // Chip 8 has 16 hexadecimal keys on its keyboard
+#define MAX_BLOCK_LENGTH 32  // Maximum instructions in a predecoded block
+#define CODE_PAGE_SIZE 64    // Granularity of memory write tracking
+#define DEFAULT_RNG_SEED 0x8  // Seed of Cxkk's generator until seed_rng
+#define NUM_CODE_PAGES (MEM_SIZE / CODE_PAGE_SIZE)
+#define CACHE_LINE_SIZE 64  // Alignment of MACHINE_STATE
+#define SNAPSHOT_PAGE_SIZE 256  // Granularity of memory shared by snapshots
+#define NUM_SNAPSHOT_PAGES (MEM_SIZE / SNAPSHOT_PAGE_SIZE)
+#define STATE_VERSION 1       // Version of the serialized state layout
+#define STATE_HEADER_SIZE 16  // Magic, version, header and payload sizes
+#define STATE_REGS_USED 65    // Bytes of registers, stack, keys and RNG
+#define STATE_REGS_SIZE 112   // STATE_REGS_USED padded for aligned copies
+#define SERIALIZED_STATE_SIZE              \
+    (STATE_HEADER_SIZE + STATE_REGS_SIZE + \
+     MEM_SIZE + SCREEN_HEIGHT * SCREEN_WIDTH)
+#define NUM_QUIRK_PROFILES 32  // Every combination of the QUIRK bits
+
+/**
+ * Hexadecimal Sprite Bit Map loaded into Interpreter Area of CHIP 8 Memory
+ * (0x000 - 0x1FF)
+ */
+extern uint8_t SPRITE_MAP[MAP_LENGTH];
+
+/**
+ * Instruction classes of the CHIP 8 instruction set, used to select the opcode
+ * handler.
+ */
+enum OP_CLASS : uint8_t {
+    OP_NOP,        // 0nnn - SYS addr (ignored) and undefined opcodes
+    OP_CLS,        // 00E0 - CLS
+    OP_RET,        // 00EE - RET
+    OP_JP,         // 1nnn - JP addr
+    OP_CALL,       // 2nnn - CALL addr
+    OP_SE_VX_KK,   // 3xkk - SE Vx, byte
+    OP_SNE_VX_KK,  // 4xkk - SNE Vx, byte
+    OP_SE_VX_VY,   // 5xy0 - SE Vx, Vy
+    OP_LD_VX_KK,   // 6xkk - LD Vx, byte
+    OP_ADD_VX_KK,  // 7xkk - ADD Vx, byte
+    OP_LD_VX_VY,   // 8xy0 - LD Vx, Vy
+    OP_OR,         // 8xy1 - OR Vx, Vy
+    OP_AND,        // 8xy2 - AND Vx, Vy
+    OP_XOR,        // 8xy3 - XOR Vx, Vy
+    OP_ADD_VX_VY,  // 8xy4 - ADD Vx, Vy
+    OP_SUB,        // 8xy5 - SUB Vx, Vy
+    OP_SHR,        // 8xy6 - SHR Vx
+    OP_SUBN,       // 8xy7 - SUBN Vx, Vy
+    OP_SHL,        // 8xyE - SHL Vx
+    OP_SNE_VX_VY,  // 9xy0 - SNE Vx, Vy
+    OP_LD_I,       // Annn - LD I, addr
+    OP_JP_V0,      // Bnnn - JP V0, addr
+    OP_RND,        // Cxkk - RND Vx, byte
+    OP_DRW,        // Dxyn - DRW Vx, Vy, nibble
+    OP_SKP,        // Ex9E - SKP Vx
+    OP_SKNP,       // ExA1 - SKNP Vx
+    OP_LD_VX_DT,   // Fx07 - LD Vx, DT
+    OP_LD_VX_K,    // Fx0A - LD Vx, K
+    OP_LD_DT_VX,   // Fx15 - LD DT, Vx
+    OP_LD_ST_VX,   // Fx18 - LD ST, Vx
+    OP_ADD_I_VX,   // Fx1E - ADD I, Vx
+    OP_LD_F_VX,    // Fx29 - LD F, Vx
+    OP_LD_B_VX,    // Fx33 - LD B, Vx
+    OP_LD_MEM_VX,  // Fx55 - LD [I], Vx
+    OP_LD_VX_MEM,  // Fx65 - LD Vx, [I]
+    NUM_OP_CLASSES
+};
+
+/**
+ * Behaviors CHIP 8 interpreters disagree on.  A quirk profile is a set of
+ * these bits, 0 keeps the behavior of this core.  Every profile is compiled
+ * into a core of its own, selected when the program is loaded.
+ */
+enum QUIRK : uint16_t {
+    QUIRK_SHIFT_VY = 1 << 0,   // 8xy6/8xyE shift Vy into Vx instead of Vx
+    QUIRK_MEM_INC_I = 1 << 1,  // Fx55/Fx65 leave I past the last register
+    QUIRK_LOGIC_VF = 1 << 2,   // 8xy1/8xy2/8xy3 reset VF
+    QUIRK_JUMP_VX = 1 << 3,    // Bxnn jumps to Vx + nnn instead of V0 + nnn
+    QUIRK_WRAP = 1 << 4,       // Sprites wrap around the screen edges
+};
+
+/**
+ * Quirk profiles of well known interpreters.
+ */
+enum QUIRK_PROFILE : uint16_t {
+    QUIRKS_DEFAULT = 0,
+    QUIRKS_COSMAC_VIP = QUIRK_SHIFT_VY | QUIRK_MEM_INC_I | QUIRK_LOGIC_VF,
+    QUIRKS_SCHIP = QUIRK_JUMP_VX,
+    QUIRKS_XO_CHIP = QUIRK_SHIFT_VY | QUIRK_MEM_INC_I | QUIRK_WRAP,
+};
+
+/**
+ * An opcode split into its instruction class and operands.
+ */
+struct DECODED_OP {
+    uint8_t op;    // OP_CLASS of the instruction
+    uint8_t x;     // Lower 4 bits of the high byte
+    uint8_t y;     // Upper 4 bits of the low byte
+    uint8_t kk;    // Lowest 8 bits, lowest 4 bits are the nibble
+    uint16_t nnn;  // Lowest 12 bits
+};
+
+/**
+ * Determines the instruction class of an opcode.
+ * @param opcode The 16-bit opcode to classify
+ * @return The OP_CLASS of the opcode
+ */
+constexpr uint8_t op_class(uint16_t opcode) {
+    switch (opcode >> 12) {
+        case 0x0:
+            return opcode == 0x00E0   ? OP_CLS
+                   : opcode == 0x00EE ? OP_RET
+                                      : OP_NOP;
+        case 0x1:
+            return OP_JP;
+        case 0x2:
+            return OP_CALL;
+        case 0x3:
+            return OP_SE_VX_KK;
+        case 0x4:
+            return OP_SNE_VX_KK;
+        case 0x5:
+            return OP_SE_VX_VY;
+        case 0x6:
+            return OP_LD_VX_KK;
+        case 0x7:
+            return OP_ADD_VX_KK;
+        case 0x8:
+            switch (opcode & 0xF) {
+                case 0x0:
+                    return OP_LD_VX_VY;
+                case 0x1:
+                    return OP_OR;
+                case 0x2:
+                    return OP_AND;
+                case 0x3:
+                    return OP_XOR;
+                case 0x4:
+                    return OP_ADD_VX_VY;
+                case 0x5:
+                    return OP_SUB;
+                case 0x6:
+                    return OP_SHR;
+                case 0x7:
+                    return OP_SUBN;
+                case 0xE:
+                    return OP_SHL;
+            }
+            return OP_NOP;
+        case 0x9:
+            return OP_SNE_VX_VY;
+        case 0xA:
+            return OP_LD_I;
+        case 0xB:
+            return OP_JP_V0;
+        case 0xC:
+            return OP_RND;
+        case 0xD:
+            return OP_DRW;
+        case 0xE:
+            switch (opcode & 0xFF) {
+                case 0x9E:
+                    return OP_SKP;
+                case 0xA1:
+                    return OP_SKNP;
+            }
+            return OP_NOP;
+        default:
+            switch (opcode & 0xFF) {
+                case 0x07:
+                    return OP_LD_VX_DT;
+                case 0x0A:
+                    return OP_LD_VX_K;
+                case 0x15:
+                    return OP_LD_DT_VX;
+                case 0x18:
+                    return OP_LD_ST_VX;
+                case 0x1E:
+                    return OP_ADD_I_VX;
+                case 0x29:
+                    return OP_LD_F_VX;
+                case 0x33:
+                    return OP_LD_B_VX;
+                case 0x55:
+                    return OP_LD_MEM_VX;
+                case 0x65:
+                    return OP_LD_VX_MEM;
+            }
+            return OP_NOP;
+    }
+}
+
+/**
+ * Builds the table mapping every 16-bit opcode to its instruction class.
+ * @return Array indexed by opcode holding OP_CLASS values
+ */
+constexpr std::array<uint8_t, 0x10000> build_op_table() {
+    std::array<uint8_t, 0x10000> table{};
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++) {
+        table[opcode] = op_class((uint16_t) opcode);
+    }
+    return table;
+}
+
+/**
+ * Opcode to instruction class table, built at compile time.
+ */
+extern const std::array<uint8_t, 0x10000> OP_TABLE;
+
+/**
+ * Decodes an opcode into its instruction class and operands.
+ * @param opcode The 16-bit opcode to decode
+ * @return The decoded opcode
+ */
+inline DECODED_OP decode_op(uint16_t opcode) {
+    return DECODED_OP{OP_TABLE[opcode], (uint8_t)((opcode >> 8) & 0x0F),
+                      (uint8_t)((opcode >> 4) & 0x0F), (uint8_t)(opcode & 0xFF),
+                      (uint16_t)(opcode & 0xFFF)};
+}
+
+/**
+ * Determines if an instruction class ends a predecoded block, either because
+ * it may change PC or because it writes memory that can hold cached code.
+ * @param op The OP_CLASS of the instruction
+ * @return Boolean indicating if the block ends after this instruction
+ */
+inline bool ends_block(uint8_t op) {
+    switch (op) {
+        case OP_RET:
+        case OP_JP:
+        case OP_CALL:
+        case OP_SE_VX_KK:
+        case OP_SNE_VX_KK:
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+        case OP_JP_V0:
+        case OP_SKP:
+        case OP_SKNP:
+        case OP_LD_VX_K:
+        case OP_LD_B_VX:
+        case OP_LD_MEM_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Spreads a seed over the state of Cxkk's xorshift64* generator with
+ * splitmix64, xorshift never leaves the all zero state so it is avoided.
+ */
+inline uint64_t rng_seed_state(uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z != 0) ? z : 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+ * Advances an xorshift64* generator, returning the high byte of the product,
+ * which is the best mixed.
+ */
+inline uint8_t rng_next(uint64_t &state) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (uint8_t)((state * 0x2545F4914F6CDD1DULL) >> 56);
+}
+
+/**
+ * Reads a pixel of a framebuffer stored as one 64-bit word per row, with the
+ * leftmost pixel in the most significant bit.
+ * @param rows The SCREEN_HEIGHT rows of the framebuffer
+ * @param x Column of the pixel, below SCREEN_WIDTH
+ * @param y Row of the pixel, below SCREEN_HEIGHT
+ * @return Boolean indicating if the pixel is lit
+ */
+inline bool frame_pixel(const uint64_t *rows, uint32_t x, uint32_t y) {
+    return ((rows[y] >> (SCREEN_WIDTH - 1 - x)) & 1) != 0;
+}
+
+// Functions for converting framebuffer rows to and from one byte per pixel
+void unpack_frame(const uint64_t *rows, uint8_t *pixels);
+void pack_frame(const uint8_t *pixels, uint64_t *rows);
+
+/**
+ * Counters describing how well the predecoded block cache performs.
+ */
+struct CACHE_STATS {
+    uint64_t hits;           // Lookups served by an already decoded block
+    uint64_t misses;         // Lookups that had to decode a new block
+    uint64_t invalidations;  // Memory writes that discarded cached blocks
+};
+
+/**
+ * Counters describing how much polling was skipped by idle loop detection.
+ */
+struct IDLE_STATS {
+    uint64_t fast_forwards;  // Times an idle loop was skipped
+    uint64_t skipped_steps;  // Instructions accounted for without executing
+};
+
+/**
+ * The registers, stack, timers, keyboard and Cxkk's generator of a machine,
+ * everything but memory and the framebuffer.
+ */
+struct REGISTER_STATE {
+    uint8_t V[REG_SIZE];         // Register file
+    uint16_t PC;                 // 16-bit Program Counter
+    uint16_t I;                  // Index register
+    uint8_t SP;                  // 8-bit Stack pointer
+    uint8_t DT, ST;              // Delay timer and sound timer
+    bool KEYS[NUM_KEYS];         // Hex keyboard state
+    uint64_t RNG;                // Cxkk xorshift64* state
+    uint16_t STACK[STACK_SIZE];  // Stack
+};
+
+/**
+ * Everything that makes up an emulated CHIP 8 machine: registers, stack,
+ * memory, timers, framebuffer, keyboard and Cxkk's generator.  Plain data
+ * without pointers, so a machine is cloned by copying the struct.  The
+ * registers touched by every instruction share the first cache line.  It has
+ * no base class, so as a base of CHIP8CORE its tail padding is never reused
+ * for the core's own members.
+ */
+struct alignas(CACHE_LINE_SIZE) MACHINE_STATE {
+    REGISTER_STATE REGS;            // Registers
+    uint8_t MEM[MEM_SIZE];          // Memory
+    uint64_t FRAME[SCREEN_HEIGHT];  // Framebuffer rows, see frame_pixel
+};
+
+static_assert(std::is_trivially_copyable<MACHINE_STATE>::value,
+              "MACHINE_STATE must be copyable with memcpy");
+static_assert(std::is_standard_layout<MACHINE_STATE>::value,
+              "MACHINE_STATE must not share its padding with CHIP8CORE");
+static_assert(SCREEN_WIDTH == 64, "A framebuffer row must fill a uint64_t");
+
+/**
+ * Contents of one SNAPSHOT_PAGE_SIZE page of memory.
+ */
+struct MEM_PAGE {
+    uint8_t data[SNAPSHOT_PAGE_SIZE];
+};
+
+/**
+ * Contents of the framebuffer.
+ */
+struct FRAME_PAGE {
+    uint64_t data[SCREEN_HEIGHT];
+};
+
+/**
+ * A machine state whose memory pages and framebuffer are immutable and
+ * reference counted.  Snapshots taken from the same line of execution, and
+ * the cores they are restored into, share every page neither of them wrote
+ * since, so a fork costs the registers plus the pages it touched.
+ */
+struct SNAPSHOT {
+    REGISTER_STATE REGS;                                   // Registers
+    std::shared_ptr<const MEM_PAGE> PAGES[NUM_SNAPSHOT_PAGES];  // Memory
+    std::shared_ptr<const FRAME_PAGE> FRAME;               // Framebuffer
+};
+
+static_assert(NUM_SNAPSHOT_PAGES <= 16, "Dirty pages are tracked in 16 bits");
+
+/**
+ * Headless CHIP 8 machine.  Holds the state of the emulated hardware in its
+ * MACHINE_STATE and implements fetch/decode/execute without depending on
+ * SDL, so that many instances can be run without a display, audio device or
+ * event queue.
+ */
+class CHIP8CORE : protected MACHINE_STATE {
+  public:
+    // Main constructor for CHIP8CORE
+    CHIP8CORE();
+
+    // Main destructor for CHIP8CORE
+    ~CHIP8CORE();
+
+    // Function for loading a program file into the interpretter's memory
+    bool load_program(const char *program_name);
+
+    // Function for loading a program held in host memory
+    bool load_program_data(const uint8_t *data, size_t size);
+
+    // Functions for selecting and reading the quirk profile, see QUIRK
+    bool set_quirks(uint16_t quirks);
+    uint16_t get_quirks();
+
+    // Function for fetching and executing the opcode at PC
+    bool step();
+
+    // Function for executing a batch of instructions in a tight loop
+    uint32_t run(uint32_t max_steps);
+
+    // Function for executing one 60Hz frame: a batch, then a timer tick
+    uint32_t run_frame(uint32_t steps_per_frame);
+
+    // Function for decoding and executing opcodes
+    bool exec_op(uint16_t opcode);
+
+    // Function for executing an already decoded opcode
+    bool exec_decoded(const DECODED_OP &op);
+
+    // Helper function for Dxyn opcode, draws a sprite to the framebuffer
+    bool draw_sprite(uint8_t x, uint8_t y, uint8_t nibble);
+
+    // Helper function for 00E0 opcode, clears the framebuffer
+    void clear_screen();
+
+    // Function for decrementing the delay and sound timers at 60Hz
+    void tick_timers();
+
+    // Functions for seeding and reading Cxkk's random number generator
+    void seed_rng(uint64_t seed);
+    uint64_t get_rng_state();
+
+    // Functions for cloning the machine state and restoring a clone
+    const MACHINE_STATE &get_state();
+    void set_state(const MACHINE_STATE &state);
+
+    // Functions for converting the machine state to and from bytes
+    size_t serialize(uint8_t *out, size_t size);
+    bool deserialize(const uint8_t *data, size_t size);
+
+    // Functions for forking the machine with pages shared copy-on-write
+    SNAPSHOT snapshot();
+    bool restore(const SNAPSHOT &snap);
+
+    // Function for updating the pressed state of a hex key
+    void set_key_status(uint8_t key, bool pressed);
+
+    // Function that returns pressed state of a given key
+    bool get_key_status(uint8_t key);
+
+    // Function for writing into memory from outside the machine
+    bool write_mem(uint16_t addr, const uint8_t *data, size_t size);
+
+    // Function for discarding cached blocks that overlap written memory
+    void invalidate_code(uint16_t addr, uint16_t length);
+
+    // Function for discarding every cached block
+    void flush_cache();
+
+    // Function that returns the write count of the page holding an address
+    uint32_t get_code_version(uint16_t addr);
+
+    // Functions for reading and clearing the block cache counters
+    CACHE_STATS get_cache_stats();
+    void reset_cache_stats();
+
+    // Function that returns if PC is in a loop waiting for a timer or key
+    bool is_idle();
+
+    // Function that returns if PC jumped to itself or escaped memory
+    bool is_halted();
+
+    // Functions for reading and clearing the idle loop counters
+    IDLE_STATS get_idle_stats();
+    void reset_idle_stats();
+
+    // Debugging Functions
+    void print_mem_contents();
+
+    void print_sys_contents();
+
+    uint16_t get_pc();
+    uint8_t get_sp();
+    uint16_t *get_stack();
+    const uint8_t *get_mem();
+    uint8_t *get_reg_file();
+    uint16_t get_index_reg();
+    uint8_t get_delay_timer();
+    uint8_t get_sound_timer();
+    const uint64_t *get_frame_buffer();
+
+  protected:
+    /**
+     * Entry points of the core compiled for one quirk profile.
+     */
+    struct QUIRK_CORE {
+        uint32_t (CHIP8CORE::*run)(uint32_t max_steps);
+        bool (CHIP8CORE::*exec)(const DECODED_OP &op);
+    };
+
+    // Cores of every quirk profile, indexed by profile
+    static const QUIRK_CORE QUIRK_CORES[NUM_QUIRK_PROFILES];
+
+    // Functions for running and executing with the quirks of a profile
+    template <uint16_t Q>
+    uint32_t run_quirks(uint32_t max_steps);
+    template <uint16_t Q>
+    bool exec_quirks(const DECODED_OP &op);
+
+    // Function for calling the handler of a decoded opcode's class
+    template <uint16_t Q>
+    bool dispatch(const DECODED_OP &op);
+
+    // Helper function for Dxyn opcode, draws a sprite wrapping at the edges
+    bool wrap_sprite(uint8_t x, uint8_t y, uint8_t nibble);
+
+    // Function that returns the next byte of Cxkk's random number generator
+    inline uint8_t next_random() { return rng_next(REGS.RNG); }
+
+    // Function for decoding the block starting at an address into the cache
+    uint8_t decode_block(uint16_t addr);
+
+    // Function that returns the length of the idle loop at an address
+    uint8_t idle_loop(uint16_t addr);
+
+    // Function for skipping whole iterations of the idle loop at PC
+    uint32_t skip_idle_loop(uint32_t max_steps);
+
+    // Opcode handlers, return if the screen needs redrawing
+    bool op_nop(const DECODED_OP &op);
+    bool op_cls(const DECODED_OP &op);
+    bool op_ret(const DECODED_OP &op);
+    bool op_jp(const DECODED_OP &op);
+    bool op_call(const DECODED_OP &op);
+    bool op_se_vx_kk(const DECODED_OP &op);
+    bool op_sne_vx_kk(const DECODED_OP &op);
+    bool op_se_vx_vy(const DECODED_OP &op);
+    bool op_ld_vx_kk(const DECODED_OP &op);
+    bool op_add_vx_kk(const DECODED_OP &op);
+    bool op_ld_vx_vy(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_or(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_and(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_xor(const DECODED_OP &op);
+    bool op_add_vx_vy(const DECODED_OP &op);
+    bool op_sub(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_shr(const DECODED_OP &op);
+    bool op_subn(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_shl(const DECODED_OP &op);
+    bool op_sne_vx_vy(const DECODED_OP &op);
+    bool op_ld_i(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_jp_v0(const DECODED_OP &op);
+    bool op_rnd(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_drw(const DECODED_OP &op);
+    bool op_skp(const DECODED_OP &op);
+    bool op_sknp(const DECODED_OP &op);
+    bool op_ld_vx_dt(const DECODED_OP &op);
+    bool op_ld_vx_k(const DECODED_OP &op);
+    bool op_ld_dt_vx(const DECODED_OP &op);
+    bool op_ld_st_vx(const DECODED_OP &op);
+    bool op_add_i_vx(const DECODED_OP &op);
+    bool op_ld_f_vx(const DECODED_OP &op);
+    bool op_ld_b_vx(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_ld_mem_vx(const DECODED_OP &op);
+    template <uint16_t Q>
+    bool op_ld_vx_mem(const DECODED_OP &op);
+
+    DECODED_OP BLOCK_OPS[MEM_SIZE];  // Predecoded opcode at each address
+    uint8_t BLOCK_LEN[MEM_SIZE];     // Instructions left in block, 0 = uncached
+    bool CODE_MAP[MEM_SIZE];         // Memory bytes covered by cached blocks
+    CACHE_STATS STATS;               // Block cache counters
+    IDLE_STATS IDLE;                 // Idle loop counters
+    uint32_t PAGE_VERSION[NUM_CODE_PAGES];  // Bumped on writes to each page
+
+    // Pages the memory held at the last snapshot or restore
+    std::shared_ptr<const MEM_PAGE> SHARED_PAGES[NUM_SNAPSHOT_PAGES];
+    std::shared_ptr<const FRAME_PAGE> SHARED_FRAME;  // Framebuffer likewise
+    uint16_t DIRTY_PAGES;  // Bit set for pages written since, 1 bit per page
+    bool FRAME_DIRTY;      // Framebuffer drawn since
+    uint16_t QUIRKS;       // Quirk profile of the program
+    QUIRK_CORE CORE;       // Core of the quirk profile
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef CHIP8_JIT_H
+#define CHIP8_JIT_H
+
+#include <vector>
+
+#include "chip8_core.h"
+
+#define JIT_CODE_SIZE (256 * 1024)  // Bytes of executable memory per JIT
+#define NO_EXIT UINT32_MAX          // No block exit waiting to be linked
+
+/**
+ * Execution engines that can run a CHIP8JIT.
+ */
+enum ENGINE {
+    ENGINE_INTERPRETER,  // Predecoded block interpreter of CHIP8CORE
+    ENGINE_JIT           // Native x86-64 code with interpreter fallback
+};
+
+/**
+ * Counters describing how much work the JIT handled natively.
+ */
+struct JIT_STATS {
+    uint64_t compiled_blocks;  // Blocks translated into native code
+    uint64_t native_steps;     // Instructions executed by native code
+    uint64_t fallback_steps;   // Instructions executed by the interpreter
+    uint64_t linked_exits;     // Block exits patched to jump to their target
+};
+
+// Entry point of a translated block, takes the address of the core
+typedef void (*NATIVE_FN)(uint8_t *core);
+
+/**
+ * A translated block, valid while the pages it was read from are unchanged.
+ */
+struct NATIVE_BLOCK {
+    NATIVE_FN fn;            // Native code, nullptr if not translated
+    const uint8_t *source;   // Instructions the code was translated from
+    uint32_t first_version;  // Code version of the first page of the block
+    uint32_t last_version;   // Code version of the last page of the block
+    uint8_t length;          // Instructions translated, 0 = interpret
+    bool compiled;           // If translation of this address was attempted
+    bool linkable;           // If other blocks may jump straight into it
+};
+
+/**
+ * CHIP 8 core with a selectable x86-64 JIT engine.  Straight-line blocks of
+ * ALU, load, timer, branch and subroutine instructions are translated into
+ * native code that keeps the V registers and I in host registers.  Anything
+ * else, such as Dxyn, Fx0A, Cxkk and memory stores, runs on the interpreter.
+ * Blocks are chained: once an exit of a block has led to a translated block,
+ * it is patched to jump there directly, so loops stay in native code until
+ * the batch runs out.  Writes to memory only retranslate the blocks whose
+ * instructions changed.
+ */
+class CHIP8JIT : public CHIP8CORE {
+  public:
+    // Main constructor for CHIP8JIT
+    CHIP8JIT();
+
+    // Main destructor for CHIP8JIT, releases the executable memory
+    ~CHIP8JIT();
+
+    // The executable memory is owned, so a JIT can not be copied
+    CHIP8JIT(const CHIP8JIT &) = delete;
+    CHIP8JIT &operator=(const CHIP8JIT &) = delete;
+
+    // Function for replacing the machine state with that of another core
+    CHIP8JIT &operator=(const CHIP8CORE &core);
+
+    // Function that returns if this host can run the JIT engine
+    static bool jit_supported();
+
+    // Functions for selecting the engine used by run
+    bool set_engine(ENGINE engine);
+    ENGINE get_engine();
+
+    // Function for executing a batch of instructions on the selected engine
+    uint32_t run(uint32_t max_steps);
+
+    // Function for discarding all translated code
+    void flush_native();
+
+    // Function that returns the JIT counters
+    JIT_STATS get_jit_stats();
+
+  private:
+    // Function for translating the block starting at an address
+    void compile(uint16_t addr);
+
+    // Function that returns if the translation at an address is current
+    bool native_valid(uint16_t addr);
+
+    // Function for patching a block exit to jump straight to a block
+    void link(uint32_t exit, const NATIVE_BLOCK &block);
+
+    // Function for writing into the executable memory
+    void patch_code(size_t offset, const void *bytes, size_t size);
+
+    ENGINE engine;                     // Engine used by run
+    uint8_t *code;                     // Executable memory, nullptr if none
+    uint8_t *code_rw;                  // Writable view of the same memory
+    size_t code_used;                  // Bytes of executable memory in use
+    std::vector<NATIVE_BLOCK> native;  // Translation of each address
+    JIT_STATS jit_stats;               // JIT counters
+    uint32_t jit_budget;               // Steps native code may still run
+    uint32_t jit_exit;                 // Code offset of the exit last taken
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef CHIP8_LOCKSTEP_H
+#define CHIP8_LOCKSTEP_H
+
+#include <vector>
+
+#include "chip8_core.h"
+
+#define LANE_ALIGN 32  // Lane arrays are padded to a whole AVX2 register
+
+/**
+ * Counters describing how well the lanes of a CHIP8LOCKSTEP stay together.
+ */
+struct LOCKSTEP_STATS {
+    uint64_t issues;             // Instructions issued to a group of lanes
+    uint64_t lane_steps;         // Instructions executed summed over lanes
+    uint64_t scalar_lane_steps;  // Lane instructions run one lane at a time
+};
+
+/**
+ * Runs many instances of one ROM in lockstep.  The registers, timers, stack
+ * and keys of every instance (lane) are stored as structure of arrays, so an
+ * instruction is executed for all lanes at the same PC by loops over
+ * contiguous lane arrays that compile to SSE2 or AVX2 code.  Instructions
+ * with per-lane memory or framebuffer access run lane by lane.  Lanes that
+ * branch differently split into groups, the group with the lowest PC runs
+ * first so groups merge again when they reach the same code.  Each lane
+ * follows exactly the semantics of CHIP8CORE with the default quirk
+ * profile.
+ */
+class CHIP8LOCKSTEP {
+  public:
+    // Main constructor for CHIP8LOCKSTEP, every lane starts like a CHIP8CORE
+    CHIP8LOCKSTEP(uint32_t lanes);
+
+    // Function for loading the same program into every lane
+    bool load_program_data(const uint8_t *data, size_t size);
+
+    // Function for executing up to max_steps instructions in every lane
+    uint64_t run(uint32_t max_steps);
+
+    // Function for decrementing the timers of every lane at 60Hz
+    void tick_timers();
+
+    // Functions for per-lane input and Cxkk seeds
+    void set_key_status(uint32_t lane, uint8_t key, bool pressed);
+    void seed_rng(uint32_t lane, uint64_t seed);
+
+    // Functions that return the state of a lane
+    uint32_t get_lanes();
+    uint16_t get_pc(uint32_t lane);
+    uint8_t get_sp(uint32_t lane);
+    uint16_t get_stack(uint32_t lane, uint8_t entry);
+    uint8_t get_reg(uint32_t lane, uint8_t reg);
+    uint16_t get_index_reg(uint32_t lane);
+    uint8_t get_delay_timer(uint32_t lane);
+    uint8_t get_sound_timer(uint32_t lane);
+    uint8_t *get_mem(uint32_t lane);
+    const uint64_t *get_frame_buffer(uint32_t lane);
+
+    // Function that returns the lane utilization counters
+    LOCKSTEP_STATS get_lockstep_stats();
+
+  private:
+    // Function for fetching an instruction that every lane holds
+    bool fetch_shared(uint16_t addr, DECODED_OP &op);
+
+    // Function for selecting the lanes that execute the next instruction
+    bool select_group(uint16_t &pc, DECODED_OP &op, uint32_t &budget);
+
+    // Function for executing straight-line code for the lanes in MASK
+    uint32_t execute_block(uint16_t pc, DECODED_OP op, uint32_t budget);
+
+    // Function for executing an instruction for the lanes in MASK
+    void execute(const DECODED_OP &op);
+
+    // Function for executing an instruction one lane at a time
+    void execute_scalar(const DECODED_OP &op);
+
+    // Function for drawing a sprite into the framebuffer of a lane
+    void draw_sprite(uint32_t lane, uint8_t x, uint8_t y, uint8_t nibble);
+
+    // Function for recording which code pages a lane wrote
+    void mark_written(uint32_t lane, uint16_t addr, uint16_t length);
+
+    uint32_t lanes;   // Number of instances
+    uint32_t stride;  // Lanes rounded up to LANE_ALIGN
+
+    std::vector<uint16_t> PC;     // Program counters [lane]
+    std::vector<uint8_t> SP;      // Stack pointers [lane]
+    std::vector<uint16_t> STACK;  // Stacks [entry][lane]
+    std::vector<uint8_t> V;       // Register files [register][lane]
+    std::vector<uint16_t> I;      // Index registers [lane]
+    std::vector<uint8_t> DT, ST;  // Delay and sound timers [lane]
+    std::vector<uint16_t> KEYS;   // Pressed keys, one bit per key [lane]
+    std::vector<uint64_t> RNG;    // Cxkk generator states [lane]
+    std::vector<uint8_t> MEM;     // Memories [lane][address]
+    std::vector<uint64_t> FRAME;  // Framebuffer rows [lane][y]
+
+    std::vector<uint8_t> PRISTINE;      // Memory every lane had after loading
+    std::vector<uint8_t> PAGE_WRITTEN;  // Lane wrote the page [lane][page]
+    std::vector<uint32_t> DIRTY_LANES;  // Lanes that wrote the page [page]
+
+    std::vector<uint32_t> LEFT;  // Steps left in the current run [lane]
+    std::vector<uint8_t> MASK;   // 0xFF for lanes in the current group [lane]
+    LOCKSTEP_STATS STATS;        // Lane utilization counters
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef CHIP8_MOVIE_H
+#define CHIP8_MOVIE_H
+
+#include <vector>
+
+#include "chip8_core.h"
+
+#define MOVIE_VERSION 2  // Version of the movie file format
+#define DEFAULT_MOVIE_KEYFRAME_INTERVAL 1800  // Thirty seconds of frames
+
+/**
+ * A key transition of a movie, applied before frame runs.
+ */
+struct MOVIE_EVENT {
+    uint32_t frame;  // Frames completed when the key changed
+    uint64_t step;   // Instructions executed when the key changed
+    uint8_t key;     // Hex key
+    bool pressed;    // New state of the key
+};
+
+/**
+ * A machine state a movie can be resumed from.
+ */
+struct MOVIE_KEYFRAME {
+    uint32_t frame;       // Frames completed
+    uint32_t event;       // First event at or after the frame
+    uint64_t step;               // Instructions executed
+    std::vector<uint8_t> state;  // The machine after the frame, serialized
+};
+
+/**
+ * Input recording of a session.  Records the key transitions of a core,
+ * stamped with the frame and instruction count, together with the starting
+ * state and Cxkk seed, so replaying it reproduces the session bit for bit
+ * without a display.  Every keyframe interval frames the machine state is
+ * stored as well, so a replay can start from the keyframe before any frame
+ * instead of from the beginning.
+ */
+class CHIP8MOVIE {
+  public:
+    // Main constructor for CHIP8MOVIE
+    CHIP8MOVIE();
+
+    // Function for starting a recording on a core that just loaded its ROM
+    void record(CHIP8CORE &core, uint64_t rng_seed, uint32_t steps_per_frame,
+                uint32_t keyframe_interval = DEFAULT_MOVIE_KEYFRAME_INTERVAL);
+
+    // Function for pressing or releasing a key of the recorded core
+    void key_event(CHIP8CORE &core, uint8_t key, bool pressed);
+
+    // Function for ending a recording
+    void stop(CHIP8CORE &core);
+
+    // Function for starting a replay of the movie on a core
+    bool play(CHIP8CORE &core);
+
+    // Function for replaying up to a frame, starting from the keyframe before
+    bool seek(CHIP8CORE &core, uint32_t target);
+
+    // Function for running one frame, recording or replaying its input
+    uint32_t run_frame(CHIP8CORE &core);
+
+    // Functions for writing and reading movie files
+    bool save(const char *path);
+    bool load(const char *path);
+
+    // Functions that return the progress of a recording or replay
+    bool is_recording();
+    bool is_finished();
+    bool is_desynced();
+    uint32_t get_frame();
+    uint64_t get_steps();
+
+    // Functions that return what the movie holds
+    uint32_t get_frames();
+    uint64_t get_total_steps();
+    uint64_t get_final_hash();
+    uint64_t get_seed();
+    uint32_t get_steps_per_frame();
+    const std::vector<MOVIE_EVENT> &get_events();
+    const std::vector<MOVIE_KEYFRAME> &get_keyframes();
+
+  private:
+    // Function for storing the state of the core as a keyframe
+    void add_keyframe(CHIP8CORE &core);
+
+    bool recording;       // Frames are recorded rather than replayed
+    bool desynced;        // A replayed event came at another instruction
+    uint64_t seed;        // Seed of Cxkk's generator
+    uint32_t spf;         // Instructions per frame
+    uint32_t interval;    // Frames between keyframes
+    uint32_t frames;      // Frames in the movie
+    uint64_t steps;       // Instructions executed over the whole movie
+    uint64_t final_hash;  // Framebuffer hash after the last frame
+
+    uint32_t frame;     // Frames completed by the recording or replay
+    uint64_t step;      // Instructions executed by the recording or replay
+    size_t next_event;  // Next event to replay
+    std::vector<MOVIE_EVENT> EVENTS;        // Key transitions, in order
+    std::vector<MOVIE_KEYFRAME> KEYFRAMES;  // States, in order of frame
+};
+
+#endif
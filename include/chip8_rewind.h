@@ -0,0 +1,71 @@
+#ifndef CHIP8_REWIND_H
+#define CHIP8_REWIND_H
+
+#include <deque>
+#include <vector>
+
+#include "chip8_core.h"
+
+#define DEFAULT_REWIND_BYTES (4 << 20)  // 4 MB of compressed history
+#define DEFAULT_KEYFRAME_INTERVAL 60    // One keyframe per emulated second
+
+/**
+ * Location of one recorded frame in a CHIP8REWIND ring.
+ */
+struct REWIND_ENTRY {
+    size_t offset;      // First byte of the compressed state in the ring
+    uint32_t length;    // Compressed bytes
+    uint32_t distance;  // Frames since the keyframe, 0 for a keyframe
+};
+
+/**
+ * History of the states a core went through, one per frame, for rewinding.
+ * Frames are kept in memory in a fixed-size ring, each stored as the XOR of
+ * its serialized state with the last keyframe, compressed by run length
+ * encoding the unchanged bytes.  Consecutive frames differ in a few bytes of
+ * registers, memory and framebuffer, so minutes of history fit in a few
+ * megabytes.  The oldest frames are dropped once the ring is full.
+ */
+class CHIP8REWIND {
+  public:
+    // Main constructor for CHIP8REWIND
+    CHIP8REWIND(size_t capacity = DEFAULT_REWIND_BYTES,
+                uint32_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL);
+
+    // Function for recording the state of a core after a frame
+    bool push(CHIP8CORE &core);
+
+    // Function for dropping the newest frame and restoring the one before
+    bool step_back(CHIP8CORE &core);
+
+    // Function for dropping the whole history
+    void clear();
+
+    // Functions that return the frames and ring bytes the history holds
+    size_t get_frames();
+    size_t get_used_bytes();
+
+  private:
+    // Function for compressing the XOR of a state with a reference state
+    static uint32_t encode(const uint8_t *state, const uint8_t *reference,
+                           uint8_t *out);
+
+    // Function for XORing a compressed frame into a state
+    static void decode(const uint8_t *in, uint32_t length, uint8_t *state);
+
+    // Function for dropping the oldest keyframe and the frames based on it
+    void drop_oldest();
+
+    // Function for freeing length bytes at the head of the ring
+    bool make_room(uint32_t length);
+
+    std::vector<uint8_t> RING;         // Compressed frames
+    size_t head;                       // Offset the next frame is written at
+    uint32_t interval;                 // Frames between keyframes
+    std::deque<REWIND_ENTRY> ENTRIES;  // Recorded frames, oldest first
+    std::vector<uint8_t> ENCODED;      // Frame being compressed
+    std::vector<uint8_t> KEYFRAME;     // Newest keyframe, serialized
+    std::vector<uint8_t> SCRATCH;      // Frame being (de)compressed
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef CHIP8_ROM_CACHE_H
+#define CHIP8_ROM_CACHE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "chip8_core.h"
+
+class ROM_BUNDLE;
+
+/**
+ * A ROM file mapped read-only into memory.  The bytes are read from the page
+ * cache on first access instead of being copied through a buffer.  A ROM
+ * can also be a view of an image inside a bundle, which it keeps mapped.
+ */
+class MAPPED_ROM {
+  public:
+    // Main constructor for MAPPED_ROM, nothing is mapped
+    MAPPED_ROM();
+
+    // Main destructor for MAPPED_ROM, unmaps the file
+    ~MAPPED_ROM();
+
+    // A mapping has a single owner, share it through ROM_CACHE instead
+    MAPPED_ROM(const MAPPED_ROM &) = delete;
+    MAPPED_ROM &operator=(const MAPPED_ROM &) = delete;
+
+    // Function for mapping a ROM file or a "bundle.pak#name" reference
+    bool open(const char *path);
+
+    // Function for viewing a ROM of a bundle that is already open
+    bool open(const std::shared_ptr<const ROM_BUNDLE> &bundle,
+              const char *name);
+
+    // Function for unmapping the file
+    void close();
+
+    const uint8_t *get_data() const;
+    size_t get_size() const;
+    uint64_t get_hash() const;
+    uint16_t get_quirks() const;
+
+  private:
+    const uint8_t *data;  // Start of the ROM, or null
+    size_t size;          // Bytes of the ROM
+    uint64_t hash;        // FNV-1a hash of the contents
+    uint16_t quirks;      // Quirk profile, 0 unless stored in a bundle
+    bool mapped;          // The ROM owns its mapping
+    std::shared_ptr<const ROM_BUNDLE> bundle;  // Bundle viewed, or null
+};
+
+/**
+ * ROMs shared by every core that runs them.  Each file is mapped once, and
+ * files with the same contents share one mapping, found by its hash, so
+ * starting an instance costs one copy of the program into memory.  Bundles
+ * referenced as "bundle.pak#name" are opened once for all their ROMs.
+ */
+class ROM_CACHE {
+  public:
+    // Main constructor for ROM_CACHE, the cache starts empty
+    ROM_CACHE();
+
+    // Function for getting the ROM of a path, mapping it on first use
+    std::shared_ptr<const MAPPED_ROM> load(const char *path);
+
+    // Functions that return how effective the cache was
+    size_t get_mappings();
+    uint64_t get_hits();
+
+  private:
+    std::mutex lock;  // Guards everything below
+    std::map<std::string, std::shared_ptr<const MAPPED_ROM>> paths;
+    std::unordered_map<uint64_t, std::shared_ptr<const MAPPED_ROM>> contents;
+    std::map<std::string, std::shared_ptr<const ROM_BUNDLE>> bundles;
+    uint64_t hits;  // Loads answered without a new mapping
+};
+
+// Function for hashing bytes with 64-bit FNV-1a
+uint64_t hash_bytes(const uint8_t *data, size_t size);
+
+// Functions for mapping a whole file read-only and unmapping it
+bool map_file(const char *path, size_t max_size, const uint8_t *&data,
+              size_t &size);
+void unmap_file(const uint8_t *data, size_t size);
+
+// Function for splitting a "bundle.pak#name" reference
+bool split_bundle_ref(const char *ref, std::string &bundle, std::string &name);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef CHIP8_SCALER_H
+#define CHIP8_SCALER_H
+
+#include "chip8_batch.h"
+#include "chip8_core.h"
+
+// Targets from this size on are scaled in bands on a pool, about 1080p
+#define SCALE_THREADED_PIXELS (1920 * 1080)
+
+// Function for upscaling rows of CHIP 8 palette indices into 32-bit pixels
+void scale_pixels(const uint8_t (*indices)[SCREEN_WIDTH],
+                  const uint32_t *palette, uint32_t *pixels, int width,
+                  int height, int pitch, WORK_STEALING_POOL *pool = nullptr);
+
+// Function for upscaling a CHIP 8 framebuffer into 32-bit pixels
+void scale_frame(const uint64_t *frame, uint32_t background,
+                 uint32_t foreground, uint32_t *pixels, int width, int height,
+                 int pitch, WORK_STEALING_POOL *pool = nullptr);
+
+#endif
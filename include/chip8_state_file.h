@@ -0,0 +1,58 @@
+#ifndef CHIP8_STATE_FILE_H
+#define CHIP8_STATE_FILE_H
+
+#include "chip8_core.h"
+
+#define STATE_FILE_VERSION 1       // Version of the compact state file format
+#define STATE_FILE_HEADER_SIZE 16  // Magic, version, sizes and checksum
+#define STATE_PALETTE_SIZE 8     // Background and foreground colors
+#define FRAME_BITS_SIZE (SCREEN_HEIGHT * SCREEN_WIDTH / 8)  // 1 bit per pixel
+#define LZ_HASH_BITS 12            // log2 of the match finder's table size
+
+// Worst case size of data compressed with lz_compress
+#define LZ_MAX_COMPRESSED_SIZE(size) ((size) + (size) / 255 + 16)
+#define STATE_FILE_MAX_SIZE                                      \
+    (STATE_FILE_HEADER_SIZE + STATE_PALETTE_SIZE +               \
+     STATE_HEADER_SIZE + STATE_REGS_USED + FRAME_BITS_SIZE +     \
+     LZ_MAX_COMPRESSED_SIZE(MEM_SIZE))
+
+// Layout of the state files written before states were serialized
+#define LEGACY_STATE_SIZE 12343  // Size of a legacy state file
+#define LEGACY_V_OFFSET 7
+#define LEGACY_STACK_OFFSET (LEGACY_V_OFFSET + REG_SIZE)
+#define LEGACY_MEM_OFFSET (LEGACY_STACK_OFFSET + 2 * STACK_SIZE)
+#define LEGACY_PIX_OFFSET (LEGACY_MEM_OFFSET + MEM_SIZE)
+
+/**
+ * The two colors a framebuffer is shown in, kept with a saved state.
+ */
+struct STATE_PALETTE {
+    uint32_t background;  // Color of unlit pixels
+    uint32_t foreground;  // Color of lit pixels
+};
+
+// Function for computing the CRC-32 of a buffer
+uint32_t state_crc32(const uint8_t *data, size_t size);
+
+// Function for compressing a buffer with the LZ codec of state files
+size_t lz_compress(const uint8_t *in, size_t size, uint8_t *out,
+                   size_t out_size);
+
+// Function for decompressing a buffer written by lz_compress
+size_t lz_decompress(const uint8_t *in, size_t size, uint8_t *out,
+                     size_t out_size);
+
+// Function for packing a serialized state into a compact state file
+size_t pack_state(const uint8_t *state, const STATE_PALETTE &palette,
+                  uint8_t *out, size_t out_size);
+
+// Function for unpacking a compact state file into a serialized state
+bool unpack_state(const uint8_t *data, size_t size, uint8_t *state,
+                  STATE_PALETTE &palette);
+
+// Function for converting a legacy state file into a machine state
+bool convert_legacy_state(const uint8_t *data, size_t size,
+                          uint32_t foreground, MACHINE_STATE &state,
+                          STATE_PALETTE &palette);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef CHIP8_STATE_WRITER_H
+#define CHIP8_STATE_WRITER_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A state file waiting to be written.
+ */
+struct STATE_WRITE {
+    uint64_t ticket;            // Ticket of the newest save it holds
+    uint32_t saves;             // Saves coalesced into this write
+    std::string path;           // File to write
+    std::vector<uint8_t> data;  // Contents of the file
+};
+
+/**
+ * How a write of the state writer ended.
+ */
+struct SAVE_RESULT {
+    uint64_t ticket;    // Ticket of the newest save written
+    uint32_t saves;     // Saves the write covered, older ones were dropped
+    std::string path;   // File written
+    bool success;       // The file was written and synced
+    std::string error;  // Reason the write failed
+};
+
+/**
+ * Background writer for save states.  The emulation thread hands over the
+ * bytes of a state file, which takes no longer than a copy, and a worker
+ * thread writes, syncs and renames them into place.  A save for a file that
+ * is still queued replaces the queued contents, so a burst of saves costs
+ * one write.  Outcomes are collected with poll on the emulation thread.
+ */
+class STATE_WRITER {
+  public:
+    // Main constructor for STATE_WRITER, starts the worker
+    STATE_WRITER();
+
+    // Main destructor for STATE_WRITER, finishes queued writes
+    ~STATE_WRITER();
+
+    // The worker refers to its writer, writers can not be copied
+    STATE_WRITER(const STATE_WRITER &) = delete;
+    STATE_WRITER &operator=(const STATE_WRITER &) = delete;
+
+    // Function for queueing the contents of a file, returns the save's ticket
+    uint64_t save(const char *path, std::vector<uint8_t> data);
+
+    // Function for taking the outcome of a finished write
+    bool poll(SAVE_RESULT &result);
+
+    // Function for reading the newest contents queued for a file
+    bool get_pending(const char *path, std::vector<uint8_t> &data);
+
+    // Function that waits until every queued write finished
+    void flush();
+
+    // Function that returns how many saves were replaced before written
+    uint64_t get_coalesced();
+
+  private:
+    // Function run by the worker thread
+    void work();
+
+    std::mutex lock;                  // Guards everything below
+    std::condition_variable wake;     // Signals queued writes and stopping
+    std::condition_variable idle;     // Signals finished writes
+    std::deque<STATE_WRITE> queue;    // Writes not started, one per path
+    std::deque<SAVE_RESULT> results;  // Finished writes not polled yet
+    STATE_WRITE writing;              // Write in progress
+    bool busy;                        // The worker is writing
+    bool stopping;                    // The worker exits once queue is empty
+    uint64_t next_ticket;             // Ticket of the next save
+    uint64_t coalesced;               // Saves replaced while queued
+    std::thread worker;               // Started last, after the members
+};
+
+// Function for writing a file through a synced temporary file and a rename
+bool write_file_durably(const char *path, const uint8_t *data, size_t size,
+                        std::string &error);
+
+#endif
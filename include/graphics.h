@@ -1,23 +1,35 @@
 #ifndef GRAPHICS_H
 #define GRAPHICS_H
 
+#include "chip8_core.h"
+#include "chip8_scaler.h"
+
 #include <SDL2/SDL.h>
 
 #include <cstdio>
 #include <ctime>
 #include <iostream>
 #include <mutex>
+#include <random>
 
 #define WINDOW_WIDTH 640  // Window Dimensions
 #define WINDOW_HEIGHT 480
-#define SCREEN_WIDTH 64
-#define SCREEN_HEIGHT 32
 #define BLACK 0         // Constants for Black and White to be used
 #define WHITE 16777215  // for 32-bit pixel color info in SDL window.
 #define INTMAX 4294967296
+#define PALETTE_BACKGROUND 0  // Palette index of unlit pixels
+#define PALETTE_FOREGROUND 1  // Palette index of lit pixels
+#define PALETTE_SIZE 2
 
 static std::mutex mtx;
 
+/**
+ * Ways of presenting the CHIP 8 screen.  The surface backend scales pixels
+ * into the window surface on the CPU, the texture backend uploads the screen
+ * as a texture once per frame and lets an SDL renderer scale it.
+ */
+enum VIDEO_BACKEND { VIDEO_SURFACE, VIDEO_TEXTURE };
+
 /**
  * Helper module for verifying initialization of video-related components.
  */
@@ -25,6 +37,8 @@ class VideoInitChecker {
   public:
     bool check_sdl_init_code(int init_code);
     bool check_sdl_create_window_code(SDL_Window *window_ptr);
+    bool check_sdl_create_renderer_code(SDL_Renderer *renderer_ptr);
+    bool check_sdl_create_texture_code(SDL_Texture *texture_ptr);
 };
 
 /**
@@ -39,8 +53,12 @@ class VIDEO {
     // Destructor to terminate SDL components
     ~VIDEO();
 
+    // Copies would close the same window
+    VIDEO(const VIDEO &) = delete;
+    VIDEO &operator=(const VIDEO &) = delete;
+
     // Function to initialize SDL components
-    bool init();
+    bool init(VIDEO_BACKEND backend = VIDEO_SURFACE);
 
     // Function for handling SDL window events
     void handle_event(SDL_Event event);
@@ -54,9 +72,16 @@ class VIDEO {
     // Function for drawing the screen per the pixel map
     void draw_pix_map();
 
+    // Function for updating the pixel map from a CHIP 8 framebuffer
+    void draw_frame(const uint64_t *frame);
+
     // Function for chaning the Chip-8 color scheme
     void rand_color_scheme();
 
+    // Function for setting the Chip-8 color scheme
+    void set_color_scheme(uint32_t newforeground_color,
+                          uint32_t newbackground_color);
+
     // Debugging function
     uint32_t get_color(uint8_t r, uint8_t g, uint8_t b);
 
@@ -75,6 +100,13 @@ class VIDEO {
     // Draws pixels to the SDL window
     void draw_pixel(uint8_t x, uint8_t y, uint32_t rgb);
 
+    // Functions for marking what the next show has to update
+    void mark_dirty(uint8_t x, uint8_t y);
+    void mark_all_dirty();
+
+    // Function for gathering the window areas drawn since the last show
+    int get_dirty_rects(SDL_Rect *rects);
+
     uint32_t get_pixel_width();
     uint32_t get_pixel_height();
     int get_window_width();
@@ -82,10 +114,20 @@ class VIDEO {
     uint32_t get_background_color();
     uint32_t get_foreground_color();
 
-    uint32_t (*get_pix_map())[SCREEN_WIDTH];
+    uint8_t (*get_pix_map())[SCREEN_WIDTH];
+    const uint32_t *get_palette();
     uint32_t *get_vid_mem();
 
   private:
+    // Function for forgetting what was drawn once it is shown
+    void clear_dirty();
+
+    // Function for creating the renderer and texture of the texture backend
+    bool init_renderer();
+
+    // Function for presenting the pixel map through the texture backend
+    void show_texture();
+
     VideoInitChecker video_init_checker;
     SDL_Window *gWindow;   // Pointer to SDL window object
     uint32_t pixel_width;  // Pixel dimensions in terms of larger scale window
@@ -95,12 +137,18 @@ class VIDEO {
     int gHeight;
     SDL_Surface *gSurface;     // Main surface we draw to
     SDL_Surface *gBackground;  // Background
+    SDL_Renderer *gRenderer;   // Renderer of the texture backend, or null
+    SDL_Texture *gTexture;     // Texture holding the CHIP 8 screen
     uint32_t *vid_mem;         // Pointer to beginning of video memory for SDL
-    uint32_t pix_map[SCREEN_HEIGHT]
-                    [SCREEN_WIDTH];  // Pixel map containing pixel
-                                     // representation of Chip-8 screen
-    uint32_t background_color;       // Background color for surface
-    uint32_t foreground_color;       // Foreground color for surface
+    uint8_t pix_map[SCREEN_HEIGHT]
+                   [SCREEN_WIDTH];  // Palette index of each pixel of the
+                                    // Chip-8 screen
+    uint32_t palette[PALETTE_SIZE];  // Colors the indices are shown in
+    std::minstd_rand color_rng;      // Generator for random color schemes
+    WORK_STEALING_POOL scale_pool;   // Workers redrawing large windows
+    uint8_t dirty_left[SCREEN_HEIGHT];   // First column drawn since show
+    uint8_t dirty_right[SCREEN_HEIGHT];  // Last column, < left if clean
+    bool dirty_all;  // Whole window needs updating, e.g. after a resize
 };
 
 #endif
\ No newline at end of file
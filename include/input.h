@@ -1,13 +1,13 @@
 #ifndef INPUT_H
 #define INPUT_H
 
+#include "chip8_core.h"
+
 #include <SDL2/SDL.h>
 
 #include <iostream>
 #include <map>
 
-#define NUM_KEYS 16  // Chip 8 has 16 hexadecimal keys on its keyboard
-
 // Define keycodes
 #define KEY_0 0x0
 #define KEY_1 0x1
@@ -29,6 +29,7 @@
 #define KEY_COLOR_CHANGE 0x11
 #define KEY_SAVE 0x12
 #define KEY_LOAD 0x13
+#define KEY_REWIND 0x14
 #define KEY_ERR 0xFF
 
 // Default keymap
@@ -39,7 +40,8 @@ static std::map<SDL_Keycode, uint8_t> keymap{
         {SDLK_s, KEY_9},    {SDLK_d, KEY_A},      {SDLK_f, KEY_B},
         {SDLK_z, KEY_C},    {SDLK_x, KEY_D},      {SDLK_c, KEY_E},
         {SDLK_v, KEY_F},    {SDL_QUIT, KEY_QUIT}, {SDLK_t, KEY_COLOR_CHANGE},
-        {SDLK_p, KEY_SAVE}, {SDLK_l, KEY_LOAD}};
+        {SDLK_p, KEY_SAVE}, {SDLK_l, KEY_LOAD},
+        {SDLK_BACKSPACE, KEY_REWIND}};
 
 /**
  * Module for handling input-related activities of CHIP 8.  Handles translation
@@ -0,0 +1,76 @@
+#include "chip8_aot.h"
+
+#include <string.h>
+
+/**
+ * Main constructor for CHIP8AOT, loads the ROM image the module was
+ * translated from so that the recompiled code matches memory.
+ * @param module The recompiled ROM
+ */
+CHIP8AOT::CHIP8AOT(const AOT_MODULE &module)
+    : module(&module),
+      verified(MEM_SIZE, VERIFIED{UINT32_MAX, UINT32_MAX}),
+      aot_stats{0, 0} {
+    // Blocks are compared against the ROM image the first time they run
+    load_program_data(module.rom, module.rom_size);
+}
+
+/**
+ * Compares a block of memory against the ROM image after its pages were
+ * written, remembering the page versions if it still matches.
+ * @param addr Address of the first instruction of the block
+ * @param length Length of the block in bytes
+ * @return Boolean indicating if the recompiled block can be used
+ */
+bool CHIP8AOT::verify_block(uint16_t addr, uint16_t length) {
+    if (addr < PC_START || addr + length > PC_START + module->rom_size ||
+        memcmp(MEM + addr, module->rom + (addr - PC_START), length) != 0) {
+        return false;
+    }
+    verified[addr] =
+            VERIFIED{PAGE_VERSION[addr / CODE_PAGE_SIZE],
+                     PAGE_VERSION[(addr + length - 1) / CODE_PAGE_SIZE]};
+    return true;
+}
+
+/**
+ * Returns the recompiled and interpreted step counts
+ * @return Counters of executed instructions
+ */
+AOT_STATS CHIP8AOT::get_aot_stats() { return aot_stats; }
+
+/**
+ * Executes up to max_steps instructions, on the recompiled code wherever
+ * possible and one instruction at a time on the interpreter otherwise.  The
+ * recompiled code follows the default quirk profile, other profiles run on
+ * the interpreter.  Idle loops are handed to the interpreter, which
+ * fast-forwards them as CHIP8CORE::run does.
+ * @param max_steps Maximum number of instructions to execute
+ * @return Number of instructions executed
+ */
+uint32_t CHIP8AOT::run(uint32_t max_steps) {
+    if (QUIRKS != QUIRKS_DEFAULT) {
+        return CHIP8CORE::run(max_steps);
+    }
+
+    uint32_t steps = 0;
+    while (steps < max_steps && REGS.PC < MEM_SIZE - 1) {
+        // An idle loop repeats until the batch ends, the timers and keys
+        // only change between batches
+        if (is_idle()) {
+            uint32_t idle = CHIP8CORE::run(max_steps - steps);
+            aot_stats.interpreted_steps += idle;
+            steps += idle;
+            continue;
+        }
+
+        uint32_t compiled = module->run(*this, max_steps - steps);
+        aot_stats.compiled_steps += compiled;
+        steps += compiled;
+        if (steps < max_steps && REGS.PC < MEM_SIZE - 1 && !is_idle()) {
+            steps += CHIP8CORE::run(1);
+            aot_stats.interpreted_steps++;
+        }
+    }
+    return steps;
+}
@@ -0,0 +1,289 @@
+#include "chip8_batch.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+/**
+ * Main constructor for WORK_STEALING_POOL.
+ * @param threads Number of worker threads, 0 for one per hardware thread
+ */
+WORK_STEALING_POOL::WORK_STEALING_POOL(unsigned threads)
+    : steals(0), current(nullptr), generation(0), busy(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    this->threads = threads;
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::unique_ptr<QUEUE>(new QUEUE()));
+    }
+
+    // The thread calling run is the first worker
+    for (unsigned worker = 1; worker < threads; worker++) {
+        workers.emplace_back(&WORK_STEALING_POOL::work, this, worker);
+    }
+}
+
+/**
+ * Main destructor for WORK_STEALING_POOL, wakes the workers and waits for
+ * them to exit.
+ */
+WORK_STEALING_POOL::~WORK_STEALING_POOL() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+/**
+ * Takes the next task of a worker from the back of its own queue, or steals
+ * the oldest task of another worker once its own queue is empty.
+ * @param worker Index of the worker asking for a task
+ * @param task Set to the task to run
+ * @return Boolean indicating if a task was found
+ */
+bool WORK_STEALING_POOL::next_task(unsigned worker, size_t &task) {
+    {
+        QUEUE &own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (unsigned i = 1; i < threads; i++) {
+        QUEUE &victim = *queues[(worker + i) % threads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Runs the tasks of a worker, then those it can steal, until every queue is
+ * empty.  No task queues new tasks, so the worker is then done.
+ * @param worker Index of the worker
+ * @param task Function called with the index of each task
+ */
+void WORK_STEALING_POOL::drain(unsigned worker,
+                               const std::function<void(size_t)> &task) {
+    size_t next;
+    while (next_task(worker, next)) {
+        task(next);
+    }
+}
+
+/**
+ * Body of a worker thread.  Sleeps until run starts a new generation of
+ * tasks, drains the queues and reports back, until the pool is destroyed.
+ * @param worker Index of the worker, from 1
+ */
+void WORK_STEALING_POOL::work(unsigned worker) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        const std::function<void(size_t)> &task = *current;
+        guard.unlock();
+        drain(worker, task);
+        guard.lock();
+        if (--busy == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+/**
+ * Runs task(i) for every i below count and returns once all of them
+ * finished.  Tasks are dealt round robin to the workers' queues up front and
+ * the sleeping workers are woken to take them, the calling thread works as
+ * the first worker.  Runs must not overlap.
+ * @param count Number of tasks
+ * @param task Function called with the index of each task, from any worker
+ */
+void WORK_STEALING_POOL::run(size_t count,
+                             const std::function<void(size_t)> &task) {
+    steals = 0;
+    for (size_t i = 0; i < count; i++) {
+        QUEUE &queue = *queues[i % threads];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(i);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        current = &task;
+        busy = threads - 1;
+        generation++;
+    }
+    wake.notify_all();
+    drain(0, task);
+
+    // Tasks may still be running on other workers
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [&] { return busy == 0; });
+    current = nullptr;
+}
+
+/**
+ * Getter function for the number of worker threads.
+ * @return Number of workers, including the thread calling run
+ */
+unsigned WORK_STEALING_POOL::get_threads() { return threads; }
+
+/**
+ * Getter function for the number of stolen tasks.
+ * @return Tasks the last run took from another worker's queue
+ */
+uint64_t WORK_STEALING_POOL::get_steals() { return steals; }
+
+/**
+ * Parses an input script.  Each line holds "<frame> <hex key> <down|up>",
+ * empty lines and lines starting with '#' are ignored.
+ * @param path Path of the script
+ * @param events Filled with the key changes, sorted by frame
+ * @return Boolean indicating if the script was read successfully
+ */
+bool load_input_script(const char *path, std::vector<INPUT_EVENT> &events) {
+    FILE *script = fopen(path, "r");
+    if (script == nullptr) {
+        std::cout << "Unable to open input script " << path << std::endl;
+        return false;
+    }
+
+    events.clear();
+    char line[128];
+    int number = 0;
+    bool success = true;
+    while (fgets(line, sizeof(line), script) != nullptr) {
+        number++;
+        unsigned frame, key;
+        char state[8];
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (sscanf(line, "%u %x %7s", &frame, &key, state) != 3 ||
+            key >= NUM_KEYS ||
+            (strcmp(state, "down") != 0 && strcmp(state, "up") != 0)) {
+            std::cout << path << ":" << number << ": bad input event"
+                      << std::endl;
+            success = false;
+            break;
+        }
+        events.push_back(INPUT_EVENT{frame, (uint8_t) key,
+                                     strcmp(state, "down") == 0});
+    }
+    fclose(script);
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const INPUT_EVENT &a, const INPUT_EVENT &b) {
+                         return a.frame < b.frame;
+                     });
+    return success;
+}
+
+/**
+ * Hashes a framebuffer with 64-bit FNV-1a, so runs can be compared by their
+ * final screen.  The pixels are hashed one byte each, so hashes recorded
+ * before the framebuffer was packed stay valid.
+ * @param frame The rows of the framebuffer
+ * @return Hash of the framebuffer
+ */
+uint64_t hash_frame_buffer(const uint64_t *frame) {
+    uint8_t pixels[SCREEN_HEIGHT * SCREEN_WIDTH];
+    unpack_frame(frame, pixels);
+    return hash_bytes(pixels, sizeof(pixels));
+}
+
+/**
+ * Runs one job headless on a ROM image shared with other jobs, which is
+ * copied into the job's core and never written.
+ * @param job The job to run
+ * @param rom ROM image of the job
+ * @param size Bytes of the ROM image
+ * @param options Frame limit and instructions per frame
+ * @param quirks Quirk profile the ROM runs with
+ * @return Result of the job
+ */
+BATCH_RESULT run_job(const BATCH_JOB &job, const uint8_t *rom, size_t size,
+                     const BATCH_OPTIONS &options, uint16_t quirks) {
+    auto start = std::chrono::steady_clock::now();
+    BATCH_RESULT result = BATCH_RESULT{false, false, 0, 0, 0, 0.0};
+
+    // Cores are too large for the stack of a worker thread
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    result.loaded =
+            core->set_quirks(quirks) && core->load_program_data(rom, size);
+    if (result.loaded) {
+        core->seed_rng(job.seed);
+
+        size_t event = 0;
+        while (result.frames < options.frames && !result.halted) {
+            for (; event < job.events.size() &&
+                   job.events[event].frame <= result.frames;
+                 event++) {
+                core->set_key_status(job.events[event].key,
+                                     job.events[event].pressed);
+            }
+            result.steps += core->run_frame(options.steps_per_frame);
+            result.frames++;
+            result.halted = core->is_halted();
+        }
+        result.frame_hash = hash_frame_buffer(core->get_frame_buffer());
+    }
+
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    return result;
+}
+
+/**
+ * Runs every job of a batch on a pool.  Each distinct ROM is mapped once up
+ * front through a ROM cache, jobs share the mapping and run on cores of
+ * their own with the quirk profile of the ROM.
+ * @param jobs The jobs to run
+ * @param options Frame limit and instructions per frame
+ * @param pool Pool the jobs are spread over
+ * @return One result per job, in the order of the jobs
+ */
+std::vector<BATCH_RESULT> run_batch(const std::vector<BATCH_JOB> &jobs,
+                                    const BATCH_OPTIONS &options,
+                                    WORK_STEALING_POOL &pool) {
+    ROM_CACHE cache;
+    std::map<std::string, std::shared_ptr<const MAPPED_ROM>> roms;
+    for (const BATCH_JOB &job : jobs) {
+        if (roms.count(job.rom) == 0) {
+            roms[job.rom] = cache.load(job.rom.c_str());
+        }
+    }
+
+    std::vector<BATCH_RESULT> results(jobs.size());
+    pool.run(jobs.size(), [&](size_t i) {
+        const MAPPED_ROM *rom = roms.at(jobs[i].rom).get();
+        if (rom == nullptr) {
+            results[i] = BATCH_RESULT{false, false, 0, 0, 0, 0.0};
+        } else {
+            results[i] = run_job(jobs[i], rom->get_data(), rom->get_size(),
+                                 options, rom->get_quirks());
+        }
+    });
+    return results;
+}
@@ -0,0 +1,219 @@
+#include "chip8_bundle.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "chip8_state_writer.h"
+
+/**
+ * Appends a little endian value to a buffer.
+ * @param out The buffer
+ * @param value Value to append
+ * @param bytes Number of bytes to append
+ */
+static void put_le(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+/**
+ * Reads a little endian value from a buffer.
+ * @param in The buffer
+ * @param bytes Number of bytes to read
+ * @return The value
+ */
+static uint64_t get_le(const uint8_t *in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t) in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Main constructor for ROM_BUNDLE, the bundle is empty until opened.
+ */
+ROM_BUNDLE::ROM_BUNDLE() : data(nullptr), size(0) {}
+
+/**
+ * Main destructor for ROM_BUNDLE, unmaps the file if one is mapped.
+ */
+ROM_BUNDLE::~ROM_BUNDLE() { close(); }
+
+/**
+ * Maps a bundle and reads its index.  Every offset and size is checked
+ * against the file, so a truncated or corrupt bundle is rejected on open
+ * rather than read out of bounds later.
+ * @param path Path of the bundle
+ * @return Boolean indicating if the file is a bundle of this version
+ */
+bool ROM_BUNDLE::open(const char *path) {
+    close();
+    if (!map_file(path, UINT32_MAX, data, size)) {
+        return false;
+    }
+
+    uint64_t count = 0, names_size = 0;
+    bool valid = size >= BUNDLE_HEADER_SIZE && memcmp(data, "C8PK", 4) == 0 &&
+                 get_le(data + 4, 2) == BUNDLE_VERSION &&
+                 get_le(data + 6, 2) == BUNDLE_HEADER_SIZE;
+    if (valid) {
+        count = get_le(data + 8, 4);
+        names_size = get_le(data + 12, 4);
+        valid = BUNDLE_HEADER_SIZE + count * BUNDLE_ENTRY_SIZE + names_size <=
+                size;
+    }
+
+    const uint8_t *index = data + BUNDLE_HEADER_SIZE;
+    const uint8_t *names = index + count * BUNDLE_ENTRY_SIZE;
+    for (uint64_t i = 0; valid && i < count; i++) {
+        const uint8_t *entry = index + i * BUNDLE_ENTRY_SIZE;
+        BUNDLE_ENTRY rom;
+        rom.hash = get_le(entry, 8);
+        rom.offset = (uint32_t) get_le(entry + 8, 4);
+        rom.size = (uint32_t) get_le(entry + 12, 4);
+        uint64_t name_offset = get_le(entry + 16, 4);
+        uint64_t name_size = get_le(entry + 20, 2);
+        rom.quirks = (uint16_t) get_le(entry + 22, 2);
+        valid = rom.size <= MAX_PROG_SIZE &&
+                (uint64_t) rom.offset + rom.size <= size &&
+                name_offset + name_size <= names_size;
+        if (valid) {
+            rom.name.assign((const char *) names + name_offset, name_size);
+            entries.push_back(rom);
+        }
+    }
+
+    if (!valid) {
+        std::cout << "Not a ROM bundle: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    // Names are looked up by binary search
+    std::sort(entries.begin(), entries.end(),
+              [](const BUNDLE_ENTRY &a, const BUNDLE_ENTRY &b) {
+                  return a.name < b.name;
+              });
+    return true;
+}
+
+/**
+ * Unmaps the bundle, leaving it empty.
+ */
+void ROM_BUNDLE::close() {
+    unmap_file(data, size);
+    data = nullptr;
+    size = 0;
+    entries.clear();
+}
+
+/**
+ * Finds a ROM by name.
+ * @param name Name of the ROM
+ * @return The ROM's entry, or null if the bundle does not hold it
+ */
+const BUNDLE_ENTRY *ROM_BUNDLE::find(const char *name) const {
+    auto entry = std::lower_bound(
+            entries.begin(), entries.end(), name,
+            [](const BUNDLE_ENTRY &a, const char *b) { return a.name < b; });
+    if (entry == entries.end() || entry->name != name) {
+        return nullptr;
+    }
+    return &*entry;
+}
+
+/**
+ * Getter function for the index of the bundle.
+ * @return Every ROM of the bundle, sorted by name
+ */
+const std::vector<BUNDLE_ENTRY> &ROM_BUNDLE::get_entries() const {
+    return entries;
+}
+
+/**
+ * Getter function for the image of a ROM.
+ * @param entry Entry of the ROM, from this bundle
+ * @return Pointer to the mapped image
+ */
+const uint8_t *ROM_BUNDLE::get_data(const BUNDLE_ENTRY &entry) const {
+    return data + entry.offset;
+}
+
+/**
+ * Writes a bundle.  Images with equal contents are stored once and share
+ * their offset.  The file is replaced atomically, see write_file_durably.
+ * @param path Path of the bundle
+ * @param roms The ROMs, each name must be unique and images fit in memory
+ * @return Boolean indicating if the bundle was written
+ */
+bool write_bundle(const char *path, const std::vector<BUNDLE_ROM> &roms) {
+    std::vector<uint8_t> names;
+    std::vector<uint8_t> images;
+    std::vector<uint8_t> index;
+    std::unordered_map<uint64_t, std::vector<size_t>> stored;
+    std::vector<uint32_t> offsets;
+    for (const BUNDLE_ROM &rom : roms) {
+        if (rom.data.size() > MAX_PROG_SIZE || rom.name.size() > 0xFFFF) {
+            std::cout << "Can not bundle " << rom.name << std::endl;
+            return false;
+        }
+    }
+
+    size_t data_start = BUNDLE_HEADER_SIZE + roms.size() * BUNDLE_ENTRY_SIZE;
+    for (const BUNDLE_ROM &rom : roms) {
+        data_start += rom.name.size();
+    }
+
+    for (size_t i = 0; i < roms.size(); i++) {
+        const BUNDLE_ROM &rom = roms[i];
+        uint64_t hash = hash_bytes(rom.data.data(), rom.data.size());
+
+        // Reuse the image of an earlier ROM with the same contents
+        size_t offset = data_start + images.size();
+        bool found = false;
+        for (size_t other : stored[hash]) {
+            if (roms[other].data == rom.data) {
+                offset = offsets[other];
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            images.insert(images.end(), rom.data.begin(), rom.data.end());
+            stored[hash].push_back(i);
+        }
+        if (offset > UINT32_MAX - MAX_PROG_SIZE) {
+            std::cout << "Bundle too large: " << path << std::endl;
+            return false;
+        }
+        offsets.push_back((uint32_t) offset);
+
+        put_le(index, hash, 8);
+        put_le(index, offset, 4);
+        put_le(index, rom.data.size(), 4);
+        put_le(index, names.size(), 4);
+        put_le(index, rom.name.size(), 2);
+        put_le(index, rom.quirks, 2);
+        names.insert(names.end(), rom.name.begin(), rom.name.end());
+    }
+
+    std::vector<uint8_t> bundle = {'C', '8', 'P', 'K'};
+    put_le(bundle, BUNDLE_VERSION, 2);
+    put_le(bundle, BUNDLE_HEADER_SIZE, 2);
+    put_le(bundle, roms.size(), 4);
+    put_le(bundle, names.size(), 4);
+    bundle.insert(bundle.end(), index.begin(), index.end());
+    bundle.insert(bundle.end(), names.begin(), names.end());
+    bundle.insert(bundle.end(), images.begin(), images.end());
+
+    std::string error;
+    if (!write_file_durably(path, bundle.data(), bundle.size(), error)) {
+        std::cout << "Error writing bundle: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,1387 @@
+#include "chip8_core.h"
+
+#include <string.h>
+
+#include "chip8_rom_cache.h"
+
+/**
+ * Hexadecimal Sprite Bit Map loaded into Interpreter Area of CHIP 8 Memory
+ * (0x000 - 0x1FF)
+ */
+uint8_t SPRITE_MAP[MAP_LENGTH] = {
+        0xF0, 0x90, 0x90, 0x90, 0xF0,  // Hex digit 0
+        0x20, 0x60, 0x20, 0x20, 0x70,  // Hex digit 1
+        0xF0, 0x10, 0xF0, 0x80, 0xF0,  // Hex digit 2
+        0xF0, 0x10, 0xF0, 0x10, 0xF0,  // Hex digit 3
+        0x90, 0x90, 0xF0, 0x10, 0x10,  // Hex digit 4
+        0xF0, 0x80, 0xF0, 0x10, 0xF0,  // Hex digit 5
+        0xF0, 0x80, 0xF0, 0x90, 0xF0,  // Hex digit 6
+        0xF0, 0x10, 0x20, 0x40, 0x40,  // Hex digit 7
+        0xF0, 0x90, 0xF0, 0x90, 0xF0,  // Hex digit 8
+        0xF0, 0x90, 0xF0, 0x10, 0xF0,  // Hex digit 9
+        0xF0, 0x90, 0xF0, 0x90, 0x90,  // Hex digit A
+        0xE0, 0x90, 0xE0, 0x90, 0xE0,  // Hex digit B
+        0xF0, 0x80, 0x80, 0x80, 0xF0,  // Hex digit C
+        0xE0, 0x90, 0x90, 0x90, 0xE0,  // Hex digit D
+        0xF0, 0x80, 0xF0, 0x80, 0xF0,  // Hex digit E
+        0xF0, 0x80, 0xF0, 0x80, 0x80   // Hex digit F
+};
+
+/**
+ * Main constructor for CHIP8CORE object, clears all internal registers, the
+ * framebuffer and the keyboard state, padding of the machine state included.
+ * Sets PC to program start. Loads CHIP8 memory 0x000-0x1FF with Hex Sprite
+ * data.
+ */
+CHIP8CORE::CHIP8CORE() : MACHINE_STATE() {
+    // Initialize internals
+    REGS.PC = PC_START;
+    REGS.SP = 0xFF;
+    REGS.I = 0x00;
+    REGS.DT = 0x00;
+    REGS.ST = 0x00;
+
+    // Clear stack, V registers, and memory
+    for (int i = 0; i < MEM_SIZE; i++) {
+        // Stack
+        if (i < STACK_SIZE) {
+            REGS.STACK[i] = 0;
+        }
+
+        // Registers
+        if (i < REG_SIZE) {
+            REGS.V[i] = 0;
+        }
+
+        // Load memory with sprite map if in area
+        if (i < MAP_LENGTH) {
+            MEM[i] = SPRITE_MAP[i];
+        } else {
+            MEM[i] = 0;
+        }
+    }
+
+    // Release all keys
+    for (int i = 0; i < NUM_KEYS; i++) {
+        REGS.KEYS[i] = false;
+    }
+
+    clear_screen();
+
+    // Runs are reproducible unless the host seeds the generator
+    seed_rng(DEFAULT_RNG_SEED);
+
+    // Start with an empty block cache
+    for (int i = 0; i < NUM_CODE_PAGES; i++) {
+        PAGE_VERSION[i] = 0;
+    }
+    flush_cache();
+    reset_cache_stats();
+    reset_idle_stats();
+
+    set_quirks(QUIRKS_DEFAULT);
+}
+
+/**
+ * Main destructor for CHIP8CORE object, the core does not own any external
+ * resources.
+ */
+CHIP8CORE::~CHIP8CORE() {}
+
+/**
+ * Reads binary file CHIP8 program and stores data into memory starting at
+ * address 0x200.  The quirk profile becomes the one the ROM is stored with in
+ * its bundle, or the default for plain files, set_quirks afterwards to
+ * override it.
+ * @param program_name A string containing the file name of the program to load.
+ * @return Boolean indicating if load was successful
+ */
+bool CHIP8CORE::load_program(const char *program_name) {
+    // Map the game read-only, it is copied into memory in one go
+    MAPPED_ROM program;
+    return program.open(program_name) && set_quirks(program.get_quirks()) &&
+           load_program_data(program.get_data(), program.get_size());
+}
+
+/**
+ * Stores a CHIP8 program already held in host memory into memory starting at
+ * address 0x200, the rest of the program area is cleared.
+ * @param data The program bytes
+ * @param size Number of program bytes
+ * @return Boolean indicating if load was successful
+ */
+bool CHIP8CORE::load_program_data(const uint8_t *data, size_t size) {
+    if (size > MAX_PROG_SIZE) {
+        std::cout << "Program too large.\n" << std::endl;
+        return false;
+    }
+
+    if (size != 0) {
+        memcpy(MEM + PC_START, data, size);
+    }
+    memset(MEM + PC_START + size, 0, MAX_PROG_SIZE - size);
+
+    // Code decoded from the previous program is stale
+    flush_cache();
+    return true;
+}
+
+/**
+ * Selects the quirk profile.  Each profile has a core of its own with the
+ * quirks compiled in, so this is the only place the profile is looked at.
+ * @param quirks Set of QUIRK bits
+ * @return Boolean indicating if the profile exists, it is unchanged otherwise
+ */
+bool CHIP8CORE::set_quirks(uint16_t quirks) {
+    if (quirks >= NUM_QUIRK_PROFILES) {
+        std::cout << "Unknown quirk profile " << quirks << std::endl;
+        return false;
+    }
+    QUIRKS = quirks;
+    CORE = QUIRK_CORES[quirks];
+    return true;
+}
+
+/**
+ * Getter function for the quirk profile.
+ * @return Set of QUIRK bits the core runs with
+ */
+uint16_t CHIP8CORE::get_quirks() { return QUIRKS; }
+
+/**
+ * Helper function for handling DXYN instruction for CHIP8.  Each line of the
+ * sprite is shifted into place across a whole framebuffer row, so drawing it
+ * is one AND to detect a collision and one XOR.  Pixels past the right or
+ * bottom edge are clipped.
+ * @param x CHIP8 x coordinate to start drawing sprite at
+ * @param y CHIP8 y coordinate to start drawing sprite at
+ * @param nibble Number of bytes that make up the sprite
+ * @return Boolean indicating if a collision occurred when drawing sprite.
+ */
+bool CHIP8CORE::draw_sprite(uint8_t x, uint8_t y, uint8_t nibble) {
+    FRAME_DIRTY = true;
+
+    // Sprites starting off screen draw nothing
+    uint64_t collision = 0;
+    if (x < SCREEN_WIDTH) {
+        for (int line = 0; line < nibble && y + line < SCREEN_HEIGHT; line++) {
+            // The line's leftmost pixel lands on column x, the shift drops
+            // the pixels past the right edge
+            uint64_t bits = (uint64_t) MEM[REGS.I + line] << 56 >> x;
+            collision |= FRAME[y + line] & bits;
+            FRAME[y + line] ^= bits;
+        }
+    }
+
+    // Set the VF flag if we have a collision
+    REGS.V[0xF] = (collision != 0) ? 1 : 0;
+    return REGS.V[0xF] == 0;
+}
+
+/**
+ * Helper function for handling DXYN instruction with QUIRK_WRAP, pixels past
+ * an edge of the screen are drawn at the opposite edge.  Lines are rotated
+ * into place instead of shifted.
+ * @param x CHIP8 x coordinate to start drawing sprite at
+ * @param y CHIP8 y coordinate to start drawing sprite at
+ * @param nibble Number of bytes that make up the sprite
+ * @return Boolean indicating if a collision occurred when drawing sprite.
+ */
+bool CHIP8CORE::wrap_sprite(uint8_t x, uint8_t y, uint8_t nibble) {
+    FRAME_DIRTY = true;
+    uint32_t shift = x % SCREEN_WIDTH;
+    uint64_t collision = 0;
+    for (int line = 0; line < nibble; line++) {
+        uint64_t bits = (uint64_t) MEM[REGS.I + line] << 56;
+        if (shift != 0) {
+            bits = bits >> shift | bits << (SCREEN_WIDTH - shift);
+        }
+        uint64_t &row = FRAME[(y + line) % SCREEN_HEIGHT];
+        collision |= row & bits;
+        row ^= bits;
+    }
+    REGS.V[0xF] = (collision != 0) ? 1 : 0;
+    return REGS.V[0xF] == 0;
+}
+
+/**
+ * Helper function for clearing the framebuffer.
+ */
+void CHIP8CORE::clear_screen() {
+    memset(FRAME, 0, sizeof(FRAME));
+    FRAME_DIRTY = true;
+}
+
+/**
+ * Expands framebuffer rows into one byte per pixel, row by row.
+ * @param rows The SCREEN_HEIGHT rows of the framebuffer
+ * @param pixels Receives SCREEN_HEIGHT * SCREEN_WIDTH bytes, 1 = pixel lit
+ */
+void unpack_frame(const uint64_t *rows, uint8_t *pixels) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            *pixels++ = frame_pixel(rows, x, y) ? 1 : 0;
+        }
+    }
+}
+
+/**
+ * Packs one byte per pixel, row by row, into framebuffer rows.
+ * @param pixels SCREEN_HEIGHT * SCREEN_WIDTH bytes, non-zero pixels are lit
+ * @param rows Receives the SCREEN_HEIGHT rows of the framebuffer
+ */
+void pack_frame(const uint8_t *pixels, uint64_t *rows) {
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        uint64_t row = 0;
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            row = row << 1 | (*pixels++ != 0);
+        }
+        rows[y] = row;
+    }
+}
+
+/**
+ * Decrements the delay and sound timers, must be called at 60Hz.
+ */
+void CHIP8CORE::tick_timers() {
+    if (REGS.DT != 0) {
+        REGS.DT--;
+    }
+    if (REGS.ST != 0) {
+        REGS.ST--;
+    }
+}
+
+/**
+ * Seeds the generator used by Cxkk.  Each core has its own generator, so
+ * cores on different threads never share state and equal seeds replay the
+ * same sequence.
+ * @param seed Any 64-bit value, spread over the state with splitmix64
+ */
+void CHIP8CORE::seed_rng(uint64_t seed) { REGS.RNG = rng_seed_state(seed); }
+
+/**
+ * Returns the state of Cxkk's generator, for saving and comparing machines.
+ * @return The 64-bit generator state
+ */
+uint64_t CHIP8CORE::get_rng_state() { return REGS.RNG; }
+
+/**
+ * Returns the machine state, copying it clones the machine.  Caches of
+ * decoded code are not part of it.
+ * @return The registers, stack, memory, timers, framebuffer and keyboard
+ */
+const MACHINE_STATE &CHIP8CORE::get_state() { return *this; }
+
+/**
+ * Replaces the machine state, e.g. with a clone taken by get_state.  Code
+ * decoded from memory pages the new state holds unchanged stays cached.
+ * @param state The state to restore
+ */
+void CHIP8CORE::set_state(const MACHINE_STATE &state) {
+    for (int page = 0; page < NUM_CODE_PAGES; page++) {
+        int offset = page * CODE_PAGE_SIZE;
+        if (memcmp(MEM + offset, state.MEM + offset, CODE_PAGE_SIZE) != 0) {
+            invalidate_code(offset, CODE_PAGE_SIZE);
+        }
+    }
+    static_cast<MACHINE_STATE &>(*this) = state;
+    FRAME_DIRTY = true;
+}
+
+/**
+ * Writes the machine state into a buffer, e.g. to hand it to another thread
+ * or process.  The buffer holds a header (magic "C8ST", 16-bit version,
+ * 16-bit header size, 32-bit payload size, 32 reserved bits) followed by
+ * the registers, stack, keys and generator in little endian, zero padded so
+ * memory starts at a cache line, then memory copied as it is and the
+ * framebuffer one byte per pixel.
+ * @param out Buffer receiving the state
+ * @param size Bytes available in the buffer
+ * @return Bytes written, SERIALIZED_STATE_SIZE, or 0 if the buffer is too
+ * small
+ */
+size_t CHIP8CORE::serialize(uint8_t *out, size_t size) {
+    if (size < SERIALIZED_STATE_SIZE) {
+        return 0;
+    }
+    const uint32_t payload = SERIALIZED_STATE_SIZE - STATE_HEADER_SIZE;
+    const uint8_t header[STATE_HEADER_SIZE] = {
+            'C', '8', 'S', 'T', STATE_VERSION, 0, STATE_HEADER_SIZE, 0,
+            (uint8_t) payload, (uint8_t)(payload >> 8), 0, 0, 0, 0, 0, 0};
+    memcpy(out, header, STATE_HEADER_SIZE);
+
+    uint8_t *regs = out + STATE_HEADER_SIZE;
+    memcpy(regs, REGS.V, REG_SIZE);
+    regs[16] = (uint8_t) REGS.PC, regs[17] = (uint8_t)(REGS.PC >> 8);
+    regs[18] = (uint8_t) REGS.I, regs[19] = (uint8_t)(REGS.I >> 8);
+    regs[20] = REGS.SP, regs[21] = REGS.DT, regs[22] = REGS.ST;
+    uint16_t keys = 0;
+    for (int key = 0; key < NUM_KEYS; key++) {
+        keys |= (uint16_t) REGS.KEYS[key] << key;
+    }
+    regs[23] = (uint8_t) keys, regs[24] = (uint8_t)(keys >> 8);
+    for (int i = 0; i < 8; i++) {
+        regs[25 + i] = (uint8_t)(REGS.RNG >> (8 * i));
+    }
+    for (int i = 0; i < STACK_SIZE; i++) {
+        regs[33 + 2 * i] = (uint8_t) REGS.STACK[i];
+        regs[34 + 2 * i] = (uint8_t)(REGS.STACK[i] >> 8);
+    }
+    memset(regs + STATE_REGS_USED, 0, STATE_REGS_SIZE - STATE_REGS_USED);
+
+    memcpy(regs + STATE_REGS_SIZE, MEM, MEM_SIZE);
+    unpack_frame(FRAME, regs + STATE_REGS_SIZE + MEM_SIZE);
+    return SERIALIZED_STATE_SIZE;
+}
+
+/**
+ * Replaces the machine state with one written by serialize.  Code decoded
+ * from memory pages the new state holds unchanged stays cached.
+ * @param data The serialized state
+ * @param size Bytes of serialized state
+ * @return Boolean indicating if the data holds a state of this version, the
+ * machine is unchanged otherwise
+ */
+bool CHIP8CORE::deserialize(const uint8_t *data, size_t size) {
+    const uint32_t payload = SERIALIZED_STATE_SIZE - STATE_HEADER_SIZE;
+    if (size != SERIALIZED_STATE_SIZE || memcmp(data, "C8ST", 4) != 0 ||
+        (data[4] | data[5] << 8) != STATE_VERSION ||
+        (data[6] | data[7] << 8) != STATE_HEADER_SIZE ||
+        (data[8] | data[9] << 8 | data[10] << 16 | (uint32_t) data[11] << 24) !=
+                payload) {
+        return false;
+    }
+
+    // SP is 0xFF while the stack is empty
+    const uint8_t *regs = data + STATE_HEADER_SIZE;
+    if (regs[20] >= STACK_SIZE && regs[20] != 0xFF) {
+        return false;
+    }
+    memcpy(REGS.V, regs, REG_SIZE);
+    REGS.PC = regs[16] | regs[17] << 8;
+    REGS.I = regs[18] | regs[19] << 8;
+    REGS.SP = regs[20], REGS.DT = regs[21], REGS.ST = regs[22];
+    uint16_t keys = regs[23] | regs[24] << 8;
+    for (int key = 0; key < NUM_KEYS; key++) {
+        REGS.KEYS[key] = (keys >> key) & 1;
+    }
+    REGS.RNG = 0;
+    for (int i = 0; i < 8; i++) {
+        REGS.RNG |= (uint64_t) regs[25 + i] << (8 * i);
+    }
+    for (int i = 0; i < STACK_SIZE; i++) {
+        REGS.STACK[i] = regs[33 + 2 * i] | regs[34 + 2 * i] << 8;
+    }
+
+    // Memory is copied straight from the buffer, pixels are packed
+    const uint8_t *mem = regs + STATE_REGS_SIZE;
+    for (int offset = 0; offset < MEM_SIZE; offset += CODE_PAGE_SIZE) {
+        if (memcmp(MEM + offset, mem + offset, CODE_PAGE_SIZE) != 0) {
+            memcpy(MEM + offset, mem + offset, CODE_PAGE_SIZE);
+            invalidate_code(offset, CODE_PAGE_SIZE);
+        }
+    }
+    pack_frame(mem + MEM_SIZE, FRAME);
+    FRAME_DIRTY = true;
+    return true;
+}
+
+/**
+ * Takes a snapshot of the machine.  Pages written since the last snapshot or
+ * restore are copied into new pages, every other page is shared with the
+ * snapshot taken or restored last.  Writes from Fx33, Fx55 and anything else
+ * that calls invalidate_code mark their pages for copying.
+ * @return Registers plus shared memory and framebuffer pages
+ */
+SNAPSHOT CHIP8CORE::snapshot() {
+    SNAPSHOT snap;
+    snap.REGS = REGS;
+
+    for (int page = 0; page < NUM_SNAPSHOT_PAGES; page++) {
+        const uint8_t *data = MEM + page * SNAPSHOT_PAGE_SIZE;
+        if ((DIRTY_PAGES & (1 << page)) != 0 &&
+            (SHARED_PAGES[page] == nullptr ||
+             memcmp(SHARED_PAGES[page]->data, data, SNAPSHOT_PAGE_SIZE) != 0)) {
+            std::shared_ptr<MEM_PAGE> copy = std::make_shared<MEM_PAGE>();
+            memcpy(copy->data, data, SNAPSHOT_PAGE_SIZE);
+            SHARED_PAGES[page] = copy;
+        }
+        snap.PAGES[page] = SHARED_PAGES[page];
+    }
+    DIRTY_PAGES = 0;
+
+    if (FRAME_DIRTY) {
+        std::shared_ptr<FRAME_PAGE> copy = std::make_shared<FRAME_PAGE>();
+        memcpy(copy->data, FRAME, sizeof(FRAME));
+        SHARED_FRAME = copy;
+        FRAME_DIRTY = false;
+    }
+    snap.FRAME = SHARED_FRAME;
+    return snap;
+}
+
+/**
+ * Restores a snapshot.  Only pages that are not already shared with it are
+ * copied, code decoded from pages that keep their contents stays cached.
+ * @param snap A snapshot taken by this or any other core
+ * @return Boolean indicating if the snapshot holds every page, a default
+ * constructed one does not and leaves the machine unchanged
+ */
+bool CHIP8CORE::restore(const SNAPSHOT &snap) {
+    if (snap.FRAME == nullptr) {
+        return false;
+    }
+    for (int page = 0; page < NUM_SNAPSHOT_PAGES; page++) {
+        if (snap.PAGES[page] == nullptr) {
+            return false;
+        }
+    }
+    REGS = snap.REGS;
+
+    for (int page = 0; page < NUM_SNAPSHOT_PAGES; page++) {
+        if (SHARED_PAGES[page] == snap.PAGES[page] &&
+            (DIRTY_PAGES & (1 << page)) == 0) {
+            continue;
+        }
+        int offset = page * SNAPSHOT_PAGE_SIZE;
+        const uint8_t *data = snap.PAGES[page]->data;
+        if (memcmp(MEM + offset, data, SNAPSHOT_PAGE_SIZE) != 0) {
+            memcpy(MEM + offset, data, SNAPSHOT_PAGE_SIZE);
+            invalidate_code(offset, SNAPSHOT_PAGE_SIZE);
+        }
+        SHARED_PAGES[page] = snap.PAGES[page];
+    }
+    DIRTY_PAGES = 0;
+
+    if (SHARED_FRAME != snap.FRAME || FRAME_DIRTY) {
+        memcpy(FRAME, snap.FRAME->data, sizeof(FRAME));
+        SHARED_FRAME = snap.FRAME;
+        FRAME_DIRTY = false;
+    }
+    return true;
+}
+
+/**
+ * Updates the pressed state of a key on the hex keyboard.
+ * @param key The hex key to update
+ * @param pressed Boolean indicating if the key is pressed (true) or not
+ */
+void CHIP8CORE::set_key_status(uint8_t key, bool pressed) {
+    if (key < NUM_KEYS) {
+        REGS.KEYS[key] = pressed;
+    }
+}
+
+/**
+ * Pulls key status information from the keyboard state
+ * @return Boolean representings if key is pressed (true) or not (false)
+ */
+bool CHIP8CORE::get_key_status(uint8_t key) {
+    return key < NUM_KEYS && REGS.KEYS[key];
+}
+
+/**
+ * Writes bytes into memory, e.g. to patch a program from a test or debugger.
+ * Code decoded from the written bytes is discarded and the next snapshot
+ * copies their pages, as for writes by Fx33 and Fx55.
+ * @param addr First memory address to write
+ * @param data Bytes to write
+ * @param size Number of bytes
+ * @return Boolean indicating if the bytes fit in memory, nothing is written
+ * otherwise
+ */
+bool CHIP8CORE::write_mem(uint16_t addr, const uint8_t *data, size_t size) {
+    if (size > MEM_SIZE || addr > MEM_SIZE - size) {
+        return false;
+    }
+    memcpy(MEM + addr, data, size);
+    invalidate_code(addr, (uint16_t) size);
+    return true;
+}
+
+/**
+ * Discards every cached block containing a byte in the written range, so that
+ * self-modifying code is decoded again before it executes.
+ * @param addr First memory address that was written
+ * @param length Number of bytes written
+ */
+void CHIP8CORE::invalidate_code(uint16_t addr, uint16_t length) {
+    uint32_t end = (uint32_t) addr + length;
+    if (end > MEM_SIZE) {
+        end = MEM_SIZE;
+    }
+    if (addr >= end) {
+        return;
+    }
+
+    // Let code translated outside of this cache know the pages changed
+    for (uint32_t page = addr / CODE_PAGE_SIZE;
+         page <= (end - 1) / CODE_PAGE_SIZE; page++) {
+        PAGE_VERSION[page]++;
+    }
+
+    // The next snapshot copies the pages instead of sharing them
+    for (uint32_t page = addr / SNAPSHOT_PAGE_SIZE;
+         page <= (end - 1) / SNAPSHOT_PAGE_SIZE; page++) {
+        DIRTY_PAGES |= 1 << page;
+    }
+
+    bool discarded = false;
+    for (uint32_t a = addr; a < end; a++) {
+        if (!CODE_MAP[a]) {
+            continue;
+        }
+
+        // Only blocks starting less than MAX_BLOCK_LENGTH opcodes back can
+        // reach this byte
+        uint32_t first = 0;
+        if (a >= 2 * MAX_BLOCK_LENGTH) {
+            first = a - 2 * MAX_BLOCK_LENGTH + 1;
+        }
+        for (uint32_t start = first; start <= a; start++) {
+            if (BLOCK_LEN[start] != 0 && start + 2 * BLOCK_LEN[start] > a) {
+                BLOCK_LEN[start] = 0;
+                discarded = true;
+            }
+        }
+        CODE_MAP[a] = false;
+    }
+
+    if (discarded) {
+        STATS.invalidations++;
+    }
+}
+
+/**
+ * Discards all predecoded blocks, used when memory is replaced wholesale.
+ */
+void CHIP8CORE::flush_cache() {
+    for (int i = 0; i < MEM_SIZE; i++) {
+        BLOCK_LEN[i] = 0;
+        CODE_MAP[i] = false;
+    }
+    for (int i = 0; i < NUM_CODE_PAGES; i++) {
+        PAGE_VERSION[i]++;
+    }
+    DIRTY_PAGES = (1 << NUM_SNAPSHOT_PAGES) - 1;
+}
+
+/**
+ * Returns how often the memory page holding an address has been written by
+ * the core, so translated code can tell when it went stale.
+ * @param addr Memory address inside the page
+ * @return Write count of the page
+ */
+uint32_t CHIP8CORE::get_code_version(uint16_t addr) {
+    return PAGE_VERSION[(addr % MEM_SIZE) / CODE_PAGE_SIZE];
+}
+
+/**
+ * Returns the block cache counters accumulated since the last reset
+ * @return Hit, miss and invalidation counts of the block cache
+ */
+CACHE_STATS CHIP8CORE::get_cache_stats() { return STATS; }
+
+/**
+ * Clears the block cache counters
+ */
+void CHIP8CORE::reset_cache_stats() { STATS = CACHE_STATS{0, 0, 0}; }
+
+/**
+ * Returns if PC is in a polling loop that can not exit before the timers are
+ * ticked or the keyboard state changes.
+ * @return Boolean indicating if the core is idle
+ */
+bool CHIP8CORE::is_idle() {
+    return REGS.PC < MEM_SIZE - 1 && idle_loop(REGS.PC) != 0;
+}
+
+/**
+ * Returns if the program finished, either by jumping to itself, the usual
+ * way CHIP 8 programs end, or by moving PC out of memory.
+ * @return Boolean indicating if the core can not make further progress
+ */
+bool CHIP8CORE::is_halted() {
+    if (REGS.PC >= MEM_SIZE - 1) {
+        return true;
+    }
+    uint16_t opcode = (uint16_t) MEM[REGS.PC] << 8 | MEM[REGS.PC + 1];
+    return opcode == (0x1000 | REGS.PC);
+}
+
+/**
+ * Returns the idle loop counters
+ * @return Counters of skipped idle loop iterations
+ */
+IDLE_STATS CHIP8CORE::get_idle_stats() { return IDLE; }
+
+/**
+ * Clears the idle loop counters
+ */
+void CHIP8CORE::reset_idle_stats() { IDLE = IDLE_STATS{0, 0}; }
+
+/**
+ * Recognizes the loops ROMs spin in while waiting: a jump to itself,
+ * Fx07 / 3xkk / 1nnn polling the delay timer and Ex9E / 1nnn or ExA1 / 1nnn
+ * polling a key.  Memory is read directly, so self-modified loops are seen as
+ * they are now.
+ * @param addr Address of the first instruction of the loop
+ * @return Instructions per iteration if the loop will repeat with the current
+ * timers and keys, 0 otherwise
+ */
+uint8_t CHIP8CORE::idle_loop(uint16_t addr) {
+    auto fetch = [&](int i) {
+        uint16_t pc = addr + 2 * i;
+        return (pc < MEM_SIZE - 1)
+                       ? decode_op((uint16_t) MEM[pc] << 8 | MEM[pc + 1])
+                       : decode_op(0x0000);
+    };
+    auto jumps_back = [&](int i) {
+        DECODED_OP op = fetch(i);
+        return op.op == OP_JP && op.nnn == addr;
+    };
+
+    DECODED_OP first = fetch(0);
+    switch (first.op) {
+        case OP_JP:
+            return first.nnn == addr ? 1 : 0;
+        case OP_LD_VX_DT: {
+            // The loop exits once DT reaches the compared value
+            DECODED_OP skip = fetch(1);
+            if (skip.x != first.x || !jumps_back(2)) {
+                return 0;
+            }
+            if (skip.op == OP_SE_VX_KK) {
+                return REGS.DT != skip.kk ? 3 : 0;
+            }
+            if (skip.op == OP_SNE_VX_KK) {
+                return REGS.DT == skip.kk ? 3 : 0;
+            }
+            return 0;
+        }
+        case OP_SKP:
+            return !get_key_status(REGS.V[first.x]) && jumps_back(1) ? 2 : 0;
+        case OP_SKNP:
+            return get_key_status(REGS.V[first.x]) && jumps_back(1) ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Accounts for as many whole iterations of the idle loop at PC as fit in the
+ * step budget without executing them.  The machine ends in the state the
+ * iterations would have left, with PC back at the start of the loop.
+ * @param max_steps Maximum number of instructions to skip
+ * @return Number of instructions skipped, 0 if PC is not in an idle loop
+ */
+uint32_t CHIP8CORE::skip_idle_loop(uint32_t max_steps) {
+    uint8_t length = idle_loop(REGS.PC);
+    if (length == 0 || length > max_steps) {
+        return 0;
+    }
+
+    // Fx07 is the only instruction of an idle loop with a side effect
+    DECODED_OP first =
+            decode_op((uint16_t) MEM[REGS.PC] << 8 | MEM[REGS.PC + 1]);
+    if (first.op == OP_LD_VX_DT) {
+        REGS.V[first.x] = REGS.DT;
+    }
+
+    uint32_t skipped = max_steps - max_steps % length;
+    IDLE.fast_forwards++;
+    IDLE.skipped_steps += skipped;
+    return skipped;
+}
+
+/**
+ * Decodes the straight-line code starting at an address, up to the next
+ * branch, skip or memory store, into the block cache.
+ * @param addr Address of the first opcode of the block, below MEM_SIZE - 1
+ * @return Number of opcodes in the block
+ */
+uint8_t CHIP8CORE::decode_block(uint16_t addr) {
+    STATS.misses++;
+
+    uint8_t length = 0;
+    for (uint16_t pc = addr; length < MAX_BLOCK_LENGTH && pc < MEM_SIZE - 1;
+         pc += 2) {
+        BLOCK_OPS[pc] = decode_op((uint16_t) MEM[pc] << 8 | MEM[pc + 1]);
+        CODE_MAP[pc] = true;
+        CODE_MAP[pc + 1] = true;
+        length++;
+        if (ends_block(BLOCK_OPS[pc].op)) {
+            break;
+        }
+    }
+
+    // Every tail of the block is a block too, so jumping into the middle or
+    // single stepping through it also hits
+    for (uint8_t i = 0; i < length; i++) {
+        BLOCK_LEN[addr + 2 * i] = length - i;
+    }
+    return length;
+}
+
+/**
+ * Opcode to instruction class table, built at compile time so decoding an
+ * opcode is a single lookup.
+ */
+constexpr std::array<uint8_t, 0x10000> OP_TABLE = build_op_table();
+
+/**
+ * 0nnn - SYS addr, ignored along with undefined opcodes.
+ */
+bool CHIP8CORE::op_nop(const DECODED_OP & /*op*/) { return false; }
+
+/**
+ * 00E0 - CLS, clear the display.
+ */
+bool CHIP8CORE::op_cls(const DECODED_OP & /*op*/) {
+    clear_screen();
+    return false;
+}
+
+/**
+ * 00EE - RET, restore PC from stack and decrement the stack pointer.
+ */
+bool CHIP8CORE::op_ret(const DECODED_OP & /*op*/) {
+    REGS.PC = REGS.STACK[REGS.SP];
+    REGS.SP -= 1;
+    return false;
+}
+
+/**
+ * 1nnn - JP addr, PC gets the lower 12 bits of the opcode.
+ */
+bool CHIP8CORE::op_jp(const DECODED_OP &op) {
+    REGS.PC = op.nnn;
+    return false;
+}
+
+/**
+ * 2nnn - CALL addr, increment stack pointer, store PC, PC gets lower 12 bits.
+ */
+bool CHIP8CORE::op_call(const DECODED_OP &op) {
+    REGS.SP += 1;
+    REGS.STACK[REGS.SP] = REGS.PC;
+    REGS.PC = op.nnn;
+    return false;
+}
+
+/**
+ * 3xkk - SE Vx, byte, skip next instruction if Vx == kk.
+ */
+bool CHIP8CORE::op_se_vx_kk(const DECODED_OP &op) {
+    REGS.PC = ((REGS.V[op.x] == op.kk) ? REGS.PC + 2 : REGS.PC);
+    return false;
+}
+
+/**
+ * 4xkk - SNE Vx, byte, skip next instruction if Vx != kk.
+ */
+bool CHIP8CORE::op_sne_vx_kk(const DECODED_OP &op) {
+    REGS.PC = ((REGS.V[op.x] != op.kk) ? REGS.PC + 2 : REGS.PC);
+    return false;
+}
+
+/**
+ * 5xy0 - SE Vx, Vy, skip next instruction if Vx == Vy.
+ */
+bool CHIP8CORE::op_se_vx_vy(const DECODED_OP &op) {
+    REGS.PC = ((REGS.V[op.x] == REGS.V[op.y]) ? REGS.PC + 2 : REGS.PC);
+    return false;
+}
+
+/**
+ * 6xkk - LD Vx, byte, load Vx with kk.
+ */
+bool CHIP8CORE::op_ld_vx_kk(const DECODED_OP &op) {
+    REGS.V[op.x] = op.kk;
+    return false;
+}
+
+/**
+ * 7xkk - ADD Vx, byte, add kk to Vx.
+ */
+bool CHIP8CORE::op_add_vx_kk(const DECODED_OP &op) {
+    REGS.V[op.x] += op.kk;
+    return false;
+}
+
+/**
+ * 8xy0 - LD Vx, Vy, load Vx with Vy.
+ */
+bool CHIP8CORE::op_ld_vx_vy(const DECODED_OP &op) {
+    REGS.V[op.x] = REGS.V[op.y];
+    return false;
+}
+
+/**
+ * 8xy1 - OR Vx, Vy, VF is reset with QUIRK_LOGIC_VF.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_or(const DECODED_OP &op) {
+    REGS.V[op.x] |= REGS.V[op.y];
+    if constexpr ((Q & QUIRK_LOGIC_VF) != 0) {
+        REGS.V[0xF] = 0;
+    }
+    return false;
+}
+
+/**
+ * 8xy2 - AND Vx, Vy, VF is reset with QUIRK_LOGIC_VF.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_and(const DECODED_OP &op) {
+    REGS.V[op.x] &= REGS.V[op.y];
+    if constexpr ((Q & QUIRK_LOGIC_VF) != 0) {
+        REGS.V[0xF] = 0;
+    }
+    return false;
+}
+
+/**
+ * 8xy3 - XOR Vx, Vy, VF is reset with QUIRK_LOGIC_VF.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_xor(const DECODED_OP &op) {
+    REGS.V[op.x] ^= REGS.V[op.y];
+    if constexpr ((Q & QUIRK_LOGIC_VF) != 0) {
+        REGS.V[0xF] = 0;
+    }
+    return false;
+}
+
+/**
+ * 8xy4 - ADD Vx, Vy, store carry bit into VF.
+ */
+bool CHIP8CORE::op_add_vx_vy(const DECODED_OP &op) {
+    REGS.V[0xF] = (((REGS.V[op.x] + REGS.V[op.y]) > 255) ? 1 : 0);
+    REGS.V[op.x] += REGS.V[op.y];
+    return false;
+}
+
+/**
+ * 8xy5 - SUB Vx, Vy, subtract Vy from Vx, store borrow bit into VF.
+ */
+bool CHIP8CORE::op_sub(const DECODED_OP &op) {
+    REGS.V[0xF] = ((REGS.V[op.x] > REGS.V[op.y]) ? 1 : 0);
+    REGS.V[op.x] -= REGS.V[op.y];
+    return false;
+}
+
+/**
+ * 8xy6 - SHR Vx, VF gets LSB of Vx, Vx gets bitshifted to the right by 1.
+ * With QUIRK_SHIFT_VY Vx gets Vy shifted instead and VF its LSB.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_shr(const DECODED_OP &op) {
+    if constexpr ((Q & QUIRK_SHIFT_VY) != 0) {
+        uint8_t source = REGS.V[op.y];
+        REGS.V[op.x] = source >> 1;
+        REGS.V[0xF] = source & 0x1;
+        return false;
+    }
+    REGS.V[0xF] = ((REGS.V[op.x] & 0x1) != 0 ? 1 : 0);
+    REGS.V[op.x] = (REGS.V[op.x] >> 1);
+    return false;
+}
+
+/**
+ * 8xy7 - SUBN Vx, Vy, Vx gets Vy - Vx, store borrow bit into VF.
+ */
+bool CHIP8CORE::op_subn(const DECODED_OP &op) {
+    REGS.V[0xF] = ((REGS.V[op.y] > REGS.V[op.x]) ? 1 : 0);
+    REGS.V[op.x] = REGS.V[op.y] - REGS.V[op.x];
+    return false;
+}
+
+/**
+ * 8xyE - SHL Vx, VF gets MSB of Vx, Vx gets bitshifted to the left by 1.
+ * With QUIRK_SHIFT_VY Vx gets Vy shifted instead and VF its MSB.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_shl(const DECODED_OP &op) {
+    if constexpr ((Q & QUIRK_SHIFT_VY) != 0) {
+        uint8_t source = REGS.V[op.y];
+        REGS.V[op.x] = source << 1;
+        REGS.V[0xF] = source >> 7;
+        return false;
+    }
+    REGS.V[0xF] = ((REGS.V[op.x] & 0x80) != 0 ? 1 : 0);
+    REGS.V[op.x] = (REGS.V[op.x] << 1);
+    return false;
+}
+
+/**
+ * 9xy0 - SNE Vx, Vy, skip next instruction if Vx != Vy.
+ */
+bool CHIP8CORE::op_sne_vx_vy(const DECODED_OP &op) {
+    REGS.PC = ((REGS.V[op.x] != REGS.V[op.y]) ? REGS.PC + 2 : REGS.PC);
+    return false;
+}
+
+/**
+ * Annn - LD I, addr, I gets lower 12 bits of opcode.
+ */
+bool CHIP8CORE::op_ld_i(const DECODED_OP &op) {
+    REGS.I = op.nnn;
+    return false;
+}
+
+/**
+ * Bnnn - JP V0, addr, PC gets V0 + lower 12 bits of opcode.  With
+ * QUIRK_JUMP_VX this is Bxnn, PC gets Vx + lower 12 bits.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_jp_v0(const DECODED_OP &op) {
+    if constexpr ((Q & QUIRK_JUMP_VX) != 0) {
+        REGS.PC = REGS.V[op.x] + op.nnn;
+    } else {
+        REGS.PC = REGS.V[0] + op.nnn;
+    }
+    return false;
+}
+
+/**
+ * Cxkk - RND Vx, byte, Vx gets a random number ANDed with kk.
+ */
+bool CHIP8CORE::op_rnd(const DECODED_OP &op) {
+    REGS.V[op.x] = next_random() & op.kk;
+    return false;
+}
+
+/**
+ * Dxyn - DRW Vx, Vy, nibble, draw sprite at coordinate Vx, Vy that is
+ * nibble-lines long.  Clipped at the screen edges unless QUIRK_WRAP.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_drw(const DECODED_OP &op) {
+    if constexpr ((Q & QUIRK_WRAP) != 0) {
+        return wrap_sprite(REGS.V[op.x], REGS.V[op.y], op.kk & 0x0F);
+    }
+    return draw_sprite(REGS.V[op.x], REGS.V[op.y], op.kk & 0x0F);
+}
+
+/**
+ * Ex9E - SKP Vx, skip next instruction if key Vx is pressed.
+ */
+bool CHIP8CORE::op_skp(const DECODED_OP &op) {
+    if (get_key_status(REGS.V[op.x])) {
+        REGS.PC += 2;
+    }
+    return false;
+}
+
+/**
+ * ExA1 - SKNP Vx, skip next instruction if key Vx is not pressed.
+ */
+bool CHIP8CORE::op_sknp(const DECODED_OP &op) {
+    if (!get_key_status(REGS.V[op.x])) {
+        REGS.PC += 2;
+    }
+    return false;
+}
+
+/**
+ * Fx07 - LD Vx, DT, Vx gets Delay Timer value.
+ */
+bool CHIP8CORE::op_ld_vx_dt(const DECODED_OP &op) {
+    REGS.V[op.x] = REGS.DT;
+    return false;
+}
+
+/**
+ * Fx0A - LD Vx, K, Vx gets the first pressed key, otherwise re-execute this
+ * instruction until the host reports a key press.
+ */
+bool CHIP8CORE::op_ld_vx_k(const DECODED_OP &op) {
+    REGS.PC -= 2;
+    for (uint8_t key = 0; key < NUM_KEYS; key++) {
+        if (REGS.KEYS[key]) {
+            REGS.V[op.x] = key;
+            REGS.PC += 2;
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * Fx15 - LD DT, Vx, Delay Timer gets Vx.
+ */
+bool CHIP8CORE::op_ld_dt_vx(const DECODED_OP &op) {
+    REGS.DT = REGS.V[op.x];
+    return false;
+}
+
+/**
+ * Fx18 - LD ST, Vx, Sound Timer gets Vx.
+ */
+bool CHIP8CORE::op_ld_st_vx(const DECODED_OP &op) {
+    REGS.ST = REGS.V[op.x];
+    return false;
+}
+
+/**
+ * Fx1E - ADD I, Vx, I gets incremented by Vx.
+ */
+bool CHIP8CORE::op_add_i_vx(const DECODED_OP &op) {
+    REGS.I += REGS.V[op.x];
+    return false;
+}
+
+/**
+ * Fx29 - LD F, Vx, I gets address of sprite corresponding to value in Vx.
+ */
+bool CHIP8CORE::op_ld_f_vx(const DECODED_OP &op) {
+    REGS.I = 5 * REGS.V[op.x];
+    return false;
+}
+
+/**
+ * Fx33 - LD B, Vx, store BCD representation of Vx in I, I+1, I+2.
+ */
+bool CHIP8CORE::op_ld_b_vx(const DECODED_OP &op) {
+    MEM[REGS.I] = REGS.V[op.x] / 100;
+    MEM[REGS.I + 1] = (REGS.V[op.x] % 100) / 10;
+    MEM[REGS.I + 2] = (REGS.V[op.x] % 10);
+    invalidate_code(REGS.I, 3);
+    return false;
+}
+
+/**
+ * Fx55 - LD [I], Vx, store V0 through Vx starting at memory I.  I ends past
+ * Vx with QUIRK_MEM_INC_I.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_ld_mem_vx(const DECODED_OP &op) {
+    for (int i = 0; i <= op.x; i++) {
+        MEM[REGS.I + i] = REGS.V[i];
+    }
+    invalidate_code(REGS.I, op.x + 1);
+    if constexpr ((Q & QUIRK_MEM_INC_I) != 0) {
+        REGS.I += op.x + 1;
+    }
+    return false;
+}
+
+/**
+ * Fx65 - LD Vx, [I], load V0 through Vx with values starting at memory I.  I
+ * ends past Vx with QUIRK_MEM_INC_I.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::op_ld_vx_mem(const DECODED_OP &op) {
+    for (int i = 0; i <= op.x; i++) {
+        REGS.V[i] = MEM[REGS.I + i];
+    }
+    if constexpr ((Q & QUIRK_MEM_INC_I) != 0) {
+        REGS.I += op.x + 1;
+    }
+    return false;
+}
+
+/**
+ * Calls the handler for the instruction class of a decoded opcode, with the
+ * quirks of a profile compiled in.
+ * @param op The decoded opcode to execute, PC must already point past it
+ * @return Boolean indicating if the screen needs to be redrawn.
+ */
+template <uint16_t Q>
+__attribute__((always_inline)) inline bool CHIP8CORE::dispatch(
+        const DECODED_OP &op) {
+    switch (op.op) {
+        case OP_NOP:
+            return op_nop(op);
+        case OP_CLS:
+            return op_cls(op);
+        case OP_RET:
+            return op_ret(op);
+        case OP_JP:
+            return op_jp(op);
+        case OP_CALL:
+            return op_call(op);
+        case OP_SE_VX_KK:
+            return op_se_vx_kk(op);
+        case OP_SNE_VX_KK:
+            return op_sne_vx_kk(op);
+        case OP_SE_VX_VY:
+            return op_se_vx_vy(op);
+        case OP_LD_VX_KK:
+            return op_ld_vx_kk(op);
+        case OP_ADD_VX_KK:
+            return op_add_vx_kk(op);
+        case OP_LD_VX_VY:
+            return op_ld_vx_vy(op);
+        case OP_OR:
+            return op_or<Q>(op);
+        case OP_AND:
+            return op_and<Q>(op);
+        case OP_XOR:
+            return op_xor<Q>(op);
+        case OP_ADD_VX_VY:
+            return op_add_vx_vy(op);
+        case OP_SUB:
+            return op_sub(op);
+        case OP_SHR:
+            return op_shr<Q>(op);
+        case OP_SUBN:
+            return op_subn(op);
+        case OP_SHL:
+            return op_shl<Q>(op);
+        case OP_SNE_VX_VY:
+            return op_sne_vx_vy(op);
+        case OP_LD_I:
+            return op_ld_i(op);
+        case OP_JP_V0:
+            return op_jp_v0<Q>(op);
+        case OP_RND:
+            return op_rnd(op);
+        case OP_DRW:
+            return op_drw<Q>(op);
+        case OP_SKP:
+            return op_skp(op);
+        case OP_SKNP:
+            return op_sknp(op);
+        case OP_LD_VX_DT:
+            return op_ld_vx_dt(op);
+        case OP_LD_VX_K:
+            return op_ld_vx_k(op);
+        case OP_LD_DT_VX:
+            return op_ld_dt_vx(op);
+        case OP_LD_ST_VX:
+            return op_ld_st_vx(op);
+        case OP_ADD_I_VX:
+            return op_add_i_vx(op);
+        case OP_LD_F_VX:
+            return op_ld_f_vx(op);
+        case OP_LD_B_VX:
+            return op_ld_b_vx(op);
+        case OP_LD_MEM_VX:
+            return op_ld_mem_vx<Q>(op);
+        case OP_LD_VX_MEM:
+            return op_ld_vx_mem<Q>(op);
+    }
+    return false;
+}
+
+/**
+ * Grabs the opcode from the memory location indicated by PC and executes it.
+ * Once PC has escaped memory nothing is executed, as run stops there.
+ * @return Boolean indicating if the screen needs to be redrawn.
+ */
+bool CHIP8CORE::step() {
+    // No whole opcode left to fetch
+    if (REGS.PC >= MEM_SIZE - 1) {
+        return false;
+    }
+
+    // Fetch the predecoded opcode from the block cache
+    if (BLOCK_LEN[REGS.PC] != 0) {
+        STATS.hits++;
+    } else {
+        decode_block(REGS.PC);
+    }
+    return exec_decoded(BLOCK_OPS[REGS.PC]);
+}
+
+/**
+ * Executes up to max_steps instructions in a tight loop by replaying
+ * predecoded blocks, stopping early if PC escapes memory.  Idle loops are
+ * fast-forwarded, their skipped instructions count as executed.  Runs the
+ * core of the quirk profile selected by set_quirks.
+ * @param max_steps Maximum number of instructions to execute
+ * @return Number of instructions executed
+ */
+uint32_t CHIP8CORE::run(uint32_t max_steps) {
+    return (this->*CORE.run)(max_steps);
+}
+
+/**
+ * Body of run for one quirk profile.
+ * @param max_steps Maximum number of instructions to execute
+ * @return Number of instructions executed
+ */
+template <uint16_t Q>
+uint32_t CHIP8CORE::run_quirks(uint32_t max_steps) {
+    uint32_t steps = 0;
+    uint64_t hits = 0;
+    while (steps < max_steps && REGS.PC < MEM_SIZE - 1) {
+        uint32_t length = BLOCK_LEN[REGS.PC];
+        if (length != 0) {
+            hits++;
+        } else {
+            length = decode_block(REGS.PC);
+        }
+        if (length > max_steps - steps) {
+            length = max_steps - steps;
+        }
+
+        // Loops polling the timers or keys repeat until the host changes
+        // them, so their remaining iterations are skipped
+        uint8_t head = BLOCK_OPS[REGS.PC].op;
+        if (head == OP_JP || head == OP_LD_VX_DT || head == OP_SKP ||
+            head == OP_SKNP) {
+            uint32_t skipped = skip_idle_loop(max_steps - steps);
+            if (skipped != 0) {
+                steps += skipped;
+                continue;
+            }
+        }
+
+        // Only the last opcode of a block can branch, so PC simply advances
+        const DECODED_OP *op = &BLOCK_OPS[REGS.PC];
+        for (uint32_t i = 0; i < length; i++, op += 2) {
+            REGS.PC += 2;
+            dispatch<Q>(*op);
+        }
+        steps += length;
+    }
+    STATS.hits += hits;
+    return steps;
+}
+
+/**
+ * Executes one 60Hz frame: the frame's instruction budget in a tight loop,
+ * followed by a single tick of the delay and sound timers.
+ * @param steps_per_frame Instructions to execute per frame
+ * @return Number of instructions executed
+ */
+uint32_t CHIP8CORE::run_frame(uint32_t steps_per_frame) {
+    uint32_t steps = run(steps_per_frame);
+    tick_timers();
+    return steps;
+}
+
+/**
+ * Executes the current opcode and updates internal registers
+ * @param opcode The 16-bit opcode to execute
+ * @return Boolean indicating if the screen needs to be redrawn.
+ */
+bool CHIP8CORE::exec_op(uint16_t opcode) {
+    return exec_decoded(decode_op(opcode));
+}
+
+/**
+ * Executes an opcode that was already split into its class and operands.
+ * @param op The decoded opcode to execute
+ * @return Boolean indicating if the screen needs to be redrawn.
+ */
+bool CHIP8CORE::exec_decoded(const DECODED_OP &op) {
+    return (this->*CORE.exec)(op);
+}
+
+/**
+ * Body of exec_decoded for one quirk profile.
+ * @param op The decoded opcode to execute
+ * @return Boolean indicating if the screen needs to be redrawn.
+ */
+template <uint16_t Q>
+bool CHIP8CORE::exec_quirks(const DECODED_OP &op) {
+    // Increment PC
+    REGS.PC += 2;
+
+    return dispatch<Q>(op);
+}
+
+#define QUIRK_CORE_OF(q) \
+    { &CHIP8CORE::run_quirks<q>, &CHIP8CORE::exec_quirks<q> }
+
+/**
+ * Cores of every quirk profile, each instantiated with its quirks as
+ * constants so no handler tests a quirk at run time.
+ */
+const CHIP8CORE::QUIRK_CORE CHIP8CORE::QUIRK_CORES[NUM_QUIRK_PROFILES] = {
+        QUIRK_CORE_OF(0),  QUIRK_CORE_OF(1),  QUIRK_CORE_OF(2),
+        QUIRK_CORE_OF(3),  QUIRK_CORE_OF(4),  QUIRK_CORE_OF(5),
+        QUIRK_CORE_OF(6),  QUIRK_CORE_OF(7),  QUIRK_CORE_OF(8),
+        QUIRK_CORE_OF(9),  QUIRK_CORE_OF(10), QUIRK_CORE_OF(11),
+        QUIRK_CORE_OF(12), QUIRK_CORE_OF(13), QUIRK_CORE_OF(14),
+        QUIRK_CORE_OF(15), QUIRK_CORE_OF(16), QUIRK_CORE_OF(17),
+        QUIRK_CORE_OF(18), QUIRK_CORE_OF(19), QUIRK_CORE_OF(20),
+        QUIRK_CORE_OF(21), QUIRK_CORE_OF(22), QUIRK_CORE_OF(23),
+        QUIRK_CORE_OF(24), QUIRK_CORE_OF(25), QUIRK_CORE_OF(26),
+        QUIRK_CORE_OF(27), QUIRK_CORE_OF(28), QUIRK_CORE_OF(29),
+        QUIRK_CORE_OF(30), QUIRK_CORE_OF(31)};
+
+static_assert(NUM_QUIRK_PROFILES == 32, "Every profile needs a core");
+
+// Debugging functions
+/**
+ * Debugging function for printing memory contents in CHIP 8
+ */
+void CHIP8CORE::print_mem_contents() {
+    for (int i = PC_START; i < MEM_SIZE; i += 2) {
+        printf("%x: %x%x\n", i, MEM[i], MEM[i + 1]);
+    }
+}
+
+/**
+ * Debugging function for printing system contents in CHIP 8
+ */
+void CHIP8CORE::print_sys_contents() {
+    printf("PC: %02x  INSTR: %02x%02x  SP: %02x  I: %x  I POINTS AT: %x\n",
+           REGS.PC, MEM[REGS.PC], MEM[REGS.PC + 1], REGS.SP, REGS.I,
+           MEM[REGS.I]);
+    for (int i = 0; i < REG_SIZE; i++) {
+        printf("V%d: %d,%x  ", i, REGS.V[i], REGS.V[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * Getter function for obtaining the program counter.
+ * @return CHIP 8 program counter
+ */
+uint16_t CHIP8CORE::get_pc() { return REGS.PC; }
+
+/**
+ * Getter function for obtaining the stack pointer.
+ * @return CHIP 8 stack pointer
+ */
+uint8_t CHIP8CORE::get_sp() { return REGS.SP; }
+
+/**
+ * Getter function for obtaining the pointer to stack memory.
+ * @return Pointer to stack memory used in CHIP 8
+ */
+uint16_t *CHIP8CORE::get_stack() { return REGS.STACK; }
+
+/**
+ * Getter function for obtaining the pointer to CHIP 8 memory contents.
+ * Memory is written through write_mem, so cached code follows the writes.
+ * @return Pointer to memory of CHIP 8
+ */
+const uint8_t *CHIP8CORE::get_mem() { return MEM; }
+
+/**
+ * Getter function for obtaining the pointer to internal CHIP 8 registers.
+ * @return Pointer to registers of CHIP 8
+ */
+uint8_t *CHIP8CORE::get_reg_file() { return REGS.V; }
+
+/**
+ * Getter function for obtaining the contents of the index register.
+ * @return CHIP 8 index register
+ */
+uint16_t CHIP8CORE::get_index_reg() { return REGS.I; }
+
+/**
+ * Getter function for obtaining the delay timer.
+ * @return CHIP 8 delay timer
+ */
+uint8_t CHIP8CORE::get_delay_timer() { return REGS.DT; }
+
+/**
+ * Getter function for obtaining the sound timer.
+ * @return CHIP 8 sound timer
+ */
+uint8_t CHIP8CORE::get_sound_timer() { return REGS.ST; }
+
+/**
+ * Getter function for obtaining the framebuffer of CHIP 8.
+ * @return Pointer to the rows of the framebuffer, read with frame_pixel
+ */
+const uint64_t *CHIP8CORE::get_frame_buffer() { return FRAME; }
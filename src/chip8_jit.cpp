@@ -0,0 +1,964 @@
+#include "chip8_jit.h"
+
+#include <string.h>
+
+#if defined(CHIP8_JIT) && defined(__x86_64__) && defined(__linux__)
+#define JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * x86-64 general purpose register numbers as used in instruction encodings.
+ */
+enum HOST_REG {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/**
+ * Condition codes for jcc and setcc.
+ */
+enum HOST_CC { CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7 };
+
+/**
+ * Bytes of a block exit: mov dword [rdi + disp32], imm32 recording the exit
+ * followed by ret, until it gets patched into jmp rel32.
+ */
+#define EXIT_SIZE 11
+
+/**
+ * Host registers handed out to CHIP 8 registers, caller-saved ones first so
+ * that small blocks do not need to save anything.  RDI holds the address of
+ * the core and RAX is scratch.
+ */
+static const uint8_t HOST_POOL[] = {RCX, RDX, RSI, R8,  R9,  R10, R11,
+                                    RBX, RBP, R12, R13, R14, R15};
+#define NUM_HOST_REGS (sizeof(HOST_POOL) / sizeof(HOST_POOL[0]))
+#define FIRST_CALLEE_SAVED 7  // Index of RBX in HOST_POOL
+
+/**
+ * Minimal x86-64 instruction encoder covering what the translator emits.
+ * Memory operands are always [RDI + disp32], the address of a core member.
+ */
+struct EMITTER {
+    std::vector<uint8_t> buf;
+
+    void byte(uint8_t b) { buf.push_back(b); }
+
+    void imm16(uint16_t v) {
+        byte(v & 0xFF);
+        byte(v >> 8);
+    }
+
+    void imm32(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            byte((v >> (8 * i)) & 0xFF);
+        }
+    }
+
+    // REX prefix, byte registers always get one so 4-7 mean SPL-DIL
+    void rex(uint8_t reg, uint8_t rm, bool force) {
+        uint8_t prefix = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+        if (force || prefix != 0x40) {
+            byte(prefix);
+        }
+    }
+
+    void modrm_reg(uint8_t reg, uint8_t rm) {
+        byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void modrm_mem(uint8_t reg, int32_t disp) {
+        byte(0x80 | ((reg & 7) << 3) | RDI);
+        imm32((uint32_t) disp);
+    }
+
+    // mov r8, [rdi + disp]
+    void load8(uint8_t dst, int32_t disp) {
+        rex(dst, RDI, true);
+        byte(0x8A);
+        modrm_mem(dst, disp);
+    }
+
+    // mov [rdi + disp], r8
+    void store8(int32_t disp, uint8_t src) {
+        rex(src, RDI, true);
+        byte(0x88);
+        modrm_mem(src, disp);
+    }
+
+    // movzx r32, byte [rdi + disp]
+    void load8zx(uint8_t dst, int32_t disp) {
+        rex(dst, RDI, false);
+        byte(0x0F);
+        byte(0xB6);
+        modrm_mem(dst, disp);
+    }
+
+    // dec byte [rdi + disp]
+    void dec8_mem(int32_t disp) {
+        byte(0xFE);
+        modrm_mem(1, disp);
+    }
+
+    // movzx eax, word [rdi + rax * 2 + disp]
+    void load16_indexed(int32_t disp) {
+        byte(0x0F);
+        byte(0xB7);
+        byte(0x84);
+        byte(0x47);
+        imm32((uint32_t) disp);
+    }
+
+    // mov word [rdi + rax * 2 + disp], imm16
+    void store16_imm_indexed(int32_t disp, uint16_t value) {
+        byte(0x66);
+        byte(0xC7);
+        byte(0x84);
+        byte(0x47);
+        imm32((uint32_t) disp);
+        imm16(value);
+    }
+
+    // movzx r32, word [rdi + disp]
+    void load16(uint8_t dst, int32_t disp) {
+        rex(dst, RDI, false);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_mem(dst, disp);
+    }
+
+    // mov [rdi + disp], r16
+    void store16(int32_t disp, uint8_t src) {
+        byte(0x66);
+        rex(src, RDI, false);
+        byte(0x89);
+        modrm_mem(src, disp);
+    }
+
+    // mov word [rdi + disp], imm16, always 9 bytes long
+    void store16_imm(int32_t disp, uint16_t value) {
+        byte(0x66);
+        byte(0xC7);
+        modrm_mem(0, disp);
+        imm16(value);
+    }
+
+    // mov eax, dword [addr]
+    void load32_abs(const void *addr) {
+        byte(0xA1);
+        imm32((uint32_t)(uintptr_t) addr);
+        imm32((uint32_t)((uintptr_t) addr >> 32));
+    }
+
+    // cmp dword [rdi + disp], r32
+    void cmp32_mem(int32_t disp, uint8_t src) {
+        rex(src, RDI, false);
+        byte(0x39);
+        modrm_mem(src, disp);
+    }
+
+    // cmp word [rdi + disp], imm16
+    void cmp16_mem_imm(int32_t disp, uint16_t value) {
+        byte(0x66);
+        byte(0x81);
+        modrm_mem(7, disp);
+        imm16(value);
+    }
+
+    // add/sub/cmp dword [rdi + disp], imm32 selected by the ModRM extension
+    void alu32_mem_imm(uint8_t ext, int32_t disp, uint32_t value) {
+        byte(0x81);
+        modrm_mem(ext, disp);
+        imm32(value);
+    }
+
+    // mov dword [rdi + disp], imm32, always 10 bytes long
+    void store32_imm(int32_t disp, uint32_t value) {
+        byte(0xC7);
+        modrm_mem(0, disp);
+        imm32(value);
+    }
+
+    // mov r8, imm8
+    void mov8_imm(uint8_t dst, uint8_t value) {
+        rex(0, dst, true);
+        byte(0xB0 + (dst & 7));
+        byte(value);
+    }
+
+    // add/or/and/sub/xor/cmp/mov r/m8, r8 selected by opcode
+    void alu8(uint8_t opcode, uint8_t dst, uint8_t src) {
+        rex(src, dst, true);
+        byte(opcode);
+        modrm_reg(src, dst);
+    }
+
+    // add/cmp r8, imm8 selected by the ModRM extension
+    void alu8_imm(uint8_t ext, uint8_t dst, uint8_t value) {
+        rex(0, dst, true);
+        byte(0x80);
+        modrm_reg(ext, dst);
+        byte(value);
+    }
+
+    // test r8, imm8
+    void test8_imm(uint8_t dst, uint8_t value) {
+        rex(0, dst, true);
+        byte(0xF6);
+        modrm_reg(0, dst);
+        byte(value);
+    }
+
+    // shl/shr r8, 1 selected by the ModRM extension
+    void shift8(uint8_t ext, uint8_t dst) {
+        rex(0, dst, true);
+        byte(0xD0);
+        modrm_reg(ext, dst);
+    }
+
+    // setcc r8
+    void setcc(uint8_t cc, uint8_t dst) {
+        rex(0, dst, true);
+        byte(0x0F);
+        byte(0x90 + cc);
+        modrm_reg(0, dst);
+    }
+
+    // jcc rel8
+    void jcc8(uint8_t cc, int8_t rel) {
+        byte(0x70 + cc);
+        byte((uint8_t) rel);
+    }
+
+    // mov r32, imm32
+    void mov32_imm(uint8_t dst, uint32_t value) {
+        rex(0, dst, false);
+        byte(0xB8 + (dst & 7));
+        imm32(value);
+    }
+
+    // mov r32, r32
+    void mov32(uint8_t dst, uint8_t src) {
+        rex(src, dst, false);
+        byte(0x89);
+        modrm_reg(src, dst);
+    }
+
+    // add r32, r32
+    void add32(uint8_t dst, uint8_t src) {
+        rex(src, dst, false);
+        byte(0x01);
+        modrm_reg(src, dst);
+    }
+
+    // movzx r32, r8
+    void movzx8(uint8_t dst, uint8_t src) {
+        rex(dst, src, true);
+        byte(0x0F);
+        byte(0xB6);
+        modrm_reg(dst, src);
+    }
+
+    // movzx r32, r16
+    void movzx16(uint8_t dst, uint8_t src) {
+        rex(dst, src, false);
+        byte(0x0F);
+        byte(0xB7);
+        modrm_reg(dst, src);
+    }
+
+    // lea eax, [rax + rax * 4]
+    void times5_rax() {
+        byte(0x8D);
+        byte(0x04);
+        byte(0x80);
+    }
+
+    void push(uint8_t reg) {
+        rex(0, reg, false);
+        byte(0x50 + (reg & 7));
+    }
+
+    void pop(uint8_t reg) {
+        rex(0, reg, false);
+        byte(0x58 + (reg & 7));
+    }
+
+    void ret() { byte(0xC3); }
+};
+
+/**
+ * Lists the CHIP 8 registers an instruction needs in host registers, if the
+ * translator supports the instruction at all.
+ * @param op The decoded instruction
+ * @param regs Filled with the V registers used
+ * @param num_regs Filled with the number of V registers used
+ * @param uses_i Set if the instruction reads or writes I
+ * @param ends Set if the instruction changes PC and must end the block
+ * @return Boolean indicating if the instruction can be translated
+ */
+static bool translatable(const DECODED_OP &op, uint8_t *regs, int *num_regs,
+                         bool *uses_i, bool *ends) {
+    *num_regs = 0;
+    *uses_i = false;
+    *ends = false;
+    switch (op.op) {
+        case OP_NOP:
+            return true;
+        case OP_JP:
+        case OP_CALL:
+        case OP_RET:
+            *ends = true;
+            return true;
+        case OP_SE_VX_KK:
+        case OP_SNE_VX_KK:
+            *ends = true;
+            regs[(*num_regs)++] = op.x;
+            return true;
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+            *ends = true;
+            regs[(*num_regs)++] = op.x;
+            regs[(*num_regs)++] = op.y;
+            return true;
+        case OP_LD_VX_KK:
+        case OP_ADD_VX_KK:
+        case OP_LD_VX_DT:
+        case OP_LD_DT_VX:
+        case OP_LD_ST_VX:
+            regs[(*num_regs)++] = op.x;
+            return true;
+        case OP_LD_VX_VY:
+        case OP_OR:
+        case OP_AND:
+        case OP_XOR:
+            regs[(*num_regs)++] = op.x;
+            regs[(*num_regs)++] = op.y;
+            return true;
+        case OP_ADD_VX_VY:
+        case OP_SUB:
+        case OP_SUBN:
+            regs[(*num_regs)++] = op.x;
+            regs[(*num_regs)++] = op.y;
+            regs[(*num_regs)++] = 0xF;
+            return true;
+        case OP_SHR:
+        case OP_SHL:
+            regs[(*num_regs)++] = op.x;
+            regs[(*num_regs)++] = 0xF;
+            return true;
+        case OP_LD_I:
+            *uses_i = true;
+            return true;
+        case OP_ADD_I_VX:
+        case OP_LD_F_VX:
+            *uses_i = true;
+            regs[(*num_regs)++] = op.x;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Main constructor for CHIP8JIT, reserves executable memory when the host
+ * supports the JIT. The interpreter engine is selected by default.
+ */
+CHIP8JIT::CHIP8JIT()
+    : engine(ENGINE_INTERPRETER),
+      code(nullptr),
+      code_rw(nullptr),
+      code_used(0),
+      native(MEM_SIZE),
+      jit_stats{0, 0, 0, 0},
+      jit_budget(0),
+      jit_exit(NO_EXIT) {
+#ifdef JIT_SUPPORTED
+    // Map the code memory twice, writable and executable, so translating a
+    // block does not need to change page protections
+    int fd = memfd_create("chip8_jit", 0);
+    if (fd >= 0 && ftruncate(fd, JIT_CODE_SIZE) == 0) {
+        void *rw = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+        void *rx = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_EXEC,
+                        MAP_SHARED, fd, 0);
+        if (rw != MAP_FAILED && rx != MAP_FAILED) {
+            code_rw = (uint8_t *) rw;
+            code = (uint8_t *) rx;
+        } else {
+            // LCOV_EXCL_START
+            if (rw != MAP_FAILED) {
+                munmap(rw, JIT_CODE_SIZE);
+            }
+            if (rx != MAP_FAILED) {
+                munmap(rx, JIT_CODE_SIZE);
+            }
+            // LCOV_EXCL_STOP
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // LCOV_EXCL_START
+    // Otherwise flip the protection of a single mapping around each write
+    if (code == nullptr) {
+        void *mem = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            std::cout << "Unable to reserve memory for the JIT." << std::endl;
+        } else {
+            code = (uint8_t *) mem;
+            code_rw = code;
+        }
+    }
+    // LCOV_EXCL_STOP
+#endif
+    flush_native();
+}
+
+/**
+ * Main destructor for CHIP8JIT, releases the executable memory.
+ */
+CHIP8JIT::~CHIP8JIT() {
+#ifdef JIT_SUPPORTED
+    if (code_rw != nullptr && code_rw != code) {
+        munmap(code_rw, JIT_CODE_SIZE);
+    }
+    if (code != nullptr) {
+        munmap(code, JIT_CODE_SIZE);
+    }
+#endif
+}
+
+/**
+ * Copies the machine state of another core, translated code is kept for the
+ * memory pages whose contents did not change.
+ * @param core Core whose state is copied
+ * @return This JIT
+ */
+CHIP8JIT &CHIP8JIT::operator=(const CHIP8CORE &core) {
+    uint8_t old_mem[MEM_SIZE];
+    uint32_t old_version[NUM_CODE_PAGES];
+    memcpy(old_mem, MEM, sizeof(old_mem));
+    memcpy(old_version, PAGE_VERSION, sizeof(old_version));
+
+    CHIP8CORE::operator=(core);
+
+    // Translations of pages with the same contents stay usable, every other
+    // page gets a version no translation was made from
+    for (int page = 0; page < NUM_CODE_PAGES; page++) {
+        int offset = page * CODE_PAGE_SIZE;
+        bool same = memcmp(old_mem + offset, MEM + offset, CODE_PAGE_SIZE) == 0;
+        PAGE_VERSION[page] = same ? old_version[page] : old_version[page] + 1;
+    }
+    return *this;
+}
+
+/**
+ * Reports if the JIT engine was built for this host.
+ * @return Boolean indicating if ENGINE_JIT can be selected
+ */
+bool CHIP8JIT::jit_supported() {
+#ifdef JIT_SUPPORTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Selects the engine used by run.
+ * @param engine Engine to select
+ * @return Boolean indicating if the engine is available, the interpreter stays
+ * selected otherwise
+ */
+bool CHIP8JIT::set_engine(ENGINE engine) {
+    if (engine == ENGINE_JIT && code == nullptr) {
+        this->engine = ENGINE_INTERPRETER;
+        return false;
+    }
+    this->engine = engine;
+    return true;
+}
+
+/**
+ * Returns the engine used by run
+ * @return The selected engine
+ */
+ENGINE CHIP8JIT::get_engine() { return engine; }
+
+/**
+ * Returns the JIT counters
+ * @return Translated block and executed instruction counts
+ */
+JIT_STATS CHIP8JIT::get_jit_stats() { return jit_stats; }
+
+/**
+ * Discards all translated code and reclaims the executable memory.
+ */
+void CHIP8JIT::flush_native() {
+    code_used = 0;
+    for (NATIVE_BLOCK &block : native) {
+        block = NATIVE_BLOCK{nullptr, nullptr, 0, 0, 0, false, false};
+    }
+    jit_exit = NO_EXIT;
+}
+
+/**
+ * Checks that the translation at an address was made from the current
+ * contents of memory.
+ * @param addr Address of the first instruction of the block
+ * @return Boolean indicating if the translation can be used
+ */
+bool CHIP8JIT::native_valid(uint16_t addr) {
+    const NATIVE_BLOCK &block = native[addr];
+    uint16_t last = addr + (block.length != 0 ? 2 * block.length : 2) - 1;
+    return block.compiled &&
+           block.first_version == PAGE_VERSION[addr / CODE_PAGE_SIZE] &&
+           block.last_version == PAGE_VERSION[last / CODE_PAGE_SIZE];
+}
+
+/**
+ * Recognizes translated blocks that may be idle loops: a jump to itself or
+ * Fx07 followed by 3xkk or 4xkk, which polls the delay timer when a jump
+ * back follows.  Run fast-forwards idle loops, so these blocks are never
+ * entered through a linked exit.
+ * @param ops The translated instructions
+ * @param length Number of translated instructions
+ * @param addr Address of the block
+ * @return Boolean indicating if the block may be an idle loop
+ */
+static bool may_idle(const DECODED_OP *ops, uint8_t length, uint16_t addr) {
+    if (ops[0].op == OP_JP) {
+        return ops[0].nnn == addr;
+    }
+    return ops[0].op == OP_LD_VX_DT && length == 2 && ops[1].x == ops[0].x &&
+           (ops[1].op == OP_SE_VX_KK || ops[1].op == OP_SNE_VX_KK);
+}
+
+/**
+ * Translates the longest run of supported instructions starting at an address
+ * into native code. The run ends after a jump or skip, before an unsupported
+ * instruction or when the host runs out of registers.
+ * @param addr Address of the first instruction, below MEM_SIZE - 1
+ */
+void CHIP8JIT::compile(uint16_t addr) {
+    // Writes elsewhere in the pages of a translation leave it usable, it
+    // only expects the new page versions from now on
+    NATIVE_BLOCK &old = native[addr];
+    if (old.length != 0 &&
+        memcmp(MEM + addr, old.source, 2 * old.length) == 0) {
+        uint16_t last = addr + 2 * old.length - 1;
+        old.first_version = PAGE_VERSION[addr / CODE_PAGE_SIZE];
+        old.last_version = PAGE_VERSION[last / CODE_PAGE_SIZE];
+        return;
+    }
+
+    // Exits linked to the old translation still jump to it and would find
+    // the versions of the new one in native, so its entry bails from now on
+    if (old.fn != nullptr) {
+        uint8_t bail = 0xC3;
+        patch_code((uint8_t *) old.fn - code, &bail, sizeof(bail));
+    }
+    native[addr] = NATIVE_BLOCK{nullptr, nullptr, 0, 0, 0, true, false};
+
+#ifdef JIT_SUPPORTED
+    // Select instructions and assign host registers
+    DECODED_OP ops[MAX_BLOCK_LENGTH];
+    int8_t host[REG_SIZE];
+    bool dirty[REG_SIZE];
+    memset(host, -1, sizeof(host));
+    memset(dirty, 0, sizeof(dirty));
+    int8_t i_host = -1;
+    bool i_dirty = false;
+    unsigned int hosts_used = 0;
+
+    uint8_t length = 0;
+    bool ends = false;
+    for (uint16_t pc = addr; !ends && length < MAX_BLOCK_LENGTH &&
+                             pc < MEM_SIZE - 1;
+         pc += 2) {
+        DECODED_OP op = decode_op((uint16_t) MEM[pc] << 8 | MEM[pc + 1]);
+        uint8_t regs[3];
+        int num_regs;
+        bool uses_i;
+        if (!translatable(op, regs, &num_regs, &uses_i, &ends)) {
+            break;
+        }
+
+        unsigned int needed = (uses_i && i_host < 0) ? 1 : 0;
+        for (int r = 0; r < num_regs; r++) {
+            bool seen = host[regs[r]] >= 0;
+            for (int q = 0; q < r; q++) {
+                seen = seen || regs[q] == regs[r];
+            }
+            needed += seen ? 0 : 1;
+        }
+        if (hosts_used + needed > NUM_HOST_REGS) {
+            break;
+        }
+        for (int r = 0; r < num_regs; r++) {
+            if (host[regs[r]] < 0) {
+                host[regs[r]] = HOST_POOL[hosts_used++];
+            }
+        }
+        if (uses_i && i_host < 0) {
+            i_host = HOST_POOL[hosts_used++];
+        }
+        ops[length++] = op;
+    }
+
+    NATIVE_BLOCK block = {nullptr, nullptr, PAGE_VERSION[addr / CODE_PAGE_SIZE],
+                          0, length, true, false};
+    block.last_version =
+            PAGE_VERSION[(addr + (length != 0 ? 2 * length : 2) - 1) /
+                         CODE_PAGE_SIZE];
+    if (length == 0 || code == nullptr) {
+        block.length = 0;
+        native[addr] = block;
+        return;
+    }
+
+    uint8_t *base = reinterpret_cast<uint8_t *>(static_cast<CHIP8CORE *>(this));
+    int32_t v_off = (int32_t)(REGS.V - base);
+    int32_t i_off = (int32_t)((uint8_t *) &REGS.I - base);
+    int32_t pc_off = (int32_t)((uint8_t *) &REGS.PC - base);
+    int32_t sp_off = (int32_t)(&REGS.SP - base);
+    int32_t stack_off = (int32_t)((uint8_t *) REGS.STACK - base);
+    int32_t dt_off = (int32_t)(&REGS.DT - base);
+    int32_t st_off = (int32_t)(&REGS.ST - base);
+    int32_t version_off = (int32_t)((uint8_t *) PAGE_VERSION - base);
+    int32_t budget_off = (int32_t)((uint8_t *) &jit_budget - base);
+    int32_t exit_off = (int32_t)((uint8_t *) &jit_exit - base);
+
+    // Entry checks, a block reached through a linked exit returns to run
+    // without executing anything if its pages were written since or the
+    // budget does not cover it.  The versions are read from native, so a
+    // translation found unchanged is renewed without touching its code, one
+    // that is replaced has its entry patched into a ret.  The ret in front of
+    // the entry is the way out
+    EMITTER e;
+    e.ret();
+    auto bail_if = [&](uint8_t cc) {
+        e.jcc8(cc, (int8_t)(-(int) e.buf.size() - 2));
+    };
+    uint16_t first_page = addr / CODE_PAGE_SIZE;
+    uint16_t last_page = (addr + 2 * length - 1) / CODE_PAGE_SIZE;
+    e.load32_abs(&native[addr].first_version);
+    e.cmp32_mem(version_off + 4 * first_page, RAX);
+    bail_if(CC_NE);
+    if (last_page != first_page) {
+        e.load32_abs(&native[addr].last_version);
+        e.cmp32_mem(version_off + 4 * last_page, RAX);
+        bail_if(CC_NE);
+    }
+    e.alu32_mem_imm(7, budget_off, length);
+    bail_if(CC_B);
+    e.alu32_mem_imm(5, budget_off, length);
+
+    // Prologue, save callee-saved registers and load the guest registers
+    for (unsigned int h = FIRST_CALLEE_SAVED; h < hosts_used; h++) {
+        e.push(HOST_POOL[h]);
+    }
+    for (int r = 0; r < REG_SIZE; r++) {
+        if (host[r] >= 0) {
+            e.load8(host[r], v_off + r);
+        }
+    }
+    if (i_host >= 0) {
+        e.load16(i_host, i_off);
+    }
+
+    // Body, mirrors the opcode handlers of CHIP8CORE
+    bool pc_written = false;
+    for (uint8_t n = 0; n < length; n++) {
+        const DECODED_OP &op = ops[n];
+        uint16_t next = addr + 2 * (n + 1);
+        uint8_t hx = host[op.x];
+        uint8_t hy = host[op.y];
+        uint8_t hf = host[0xF];
+        switch (op.op) {
+            case OP_NOP:
+                break;
+            case OP_JP:
+                e.store16_imm(pc_off, op.nnn);
+                pc_written = true;
+                break;
+            case OP_CALL:
+                e.load8zx(RAX, sp_off);
+                e.alu8_imm(0, RAX, 1);
+                e.store8(sp_off, RAX);
+                e.store16_imm_indexed(stack_off, next);
+                e.store16_imm(pc_off, op.nnn);
+                pc_written = true;
+                break;
+            case OP_RET:
+                e.load8zx(RAX, sp_off);
+                e.load16_indexed(stack_off);
+                e.store16(pc_off, RAX);
+                e.dec8_mem(sp_off);
+                pc_written = true;
+                break;
+            case OP_SE_VX_KK:
+            case OP_SNE_VX_KK:
+            case OP_SE_VX_VY:
+            case OP_SNE_VX_VY:
+                e.store16_imm(pc_off, next);
+                if (op.op == OP_SE_VX_KK || op.op == OP_SNE_VX_KK) {
+                    e.alu8_imm(7, hx, op.kk);
+                } else {
+                    e.alu8(0x38, hx, hy);
+                }
+                e.jcc8((op.op == OP_SE_VX_KK || op.op == OP_SE_VX_VY) ? CC_NE
+                                                                      : CC_E,
+                       9);
+                e.store16_imm(pc_off, next + 2);
+                pc_written = true;
+                break;
+            case OP_LD_VX_KK:
+                e.mov8_imm(hx, op.kk);
+                dirty[op.x] = true;
+                break;
+            case OP_ADD_VX_KK:
+                e.alu8_imm(0, hx, op.kk);
+                dirty[op.x] = true;
+                break;
+            case OP_LD_VX_VY:
+                e.alu8(0x88, hx, hy);
+                dirty[op.x] = true;
+                break;
+            case OP_OR:
+                e.alu8(0x08, hx, hy);
+                dirty[op.x] = true;
+                break;
+            case OP_AND:
+                e.alu8(0x20, hx, hy);
+                dirty[op.x] = true;
+                break;
+            case OP_XOR:
+                e.alu8(0x30, hx, hy);
+                dirty[op.x] = true;
+                break;
+            case OP_ADD_VX_VY:
+                e.alu8(0x88, RAX, hx);
+                e.alu8(0x00, RAX, hy);
+                e.setcc(CC_B, hf);
+                e.alu8(0x00, hx, hy);
+                dirty[op.x] = dirty[0xF] = true;
+                break;
+            case OP_SUB:
+                e.alu8(0x38, hx, hy);
+                e.setcc(CC_A, hf);
+                e.alu8(0x28, hx, hy);
+                dirty[op.x] = dirty[0xF] = true;
+                break;
+            case OP_SUBN:
+                e.alu8(0x38, hy, hx);
+                e.setcc(CC_A, hf);
+                e.alu8(0x88, RAX, hy);
+                e.alu8(0x28, RAX, hx);
+                e.alu8(0x88, hx, RAX);
+                dirty[op.x] = dirty[0xF] = true;
+                break;
+            case OP_SHR:
+                e.test8_imm(hx, 0x01);
+                e.setcc(CC_NE, hf);
+                e.shift8(5, hx);
+                dirty[op.x] = dirty[0xF] = true;
+                break;
+            case OP_SHL:
+                e.test8_imm(hx, 0x80);
+                e.setcc(CC_NE, hf);
+                e.shift8(4, hx);
+                dirty[op.x] = dirty[0xF] = true;
+                break;
+            case OP_LD_I:
+                e.mov32_imm(i_host, op.nnn);
+                i_dirty = true;
+                break;
+            case OP_ADD_I_VX:
+                e.movzx8(RAX, hx);
+                e.add32(i_host, RAX);
+                e.movzx16(i_host, i_host);
+                i_dirty = true;
+                break;
+            case OP_LD_F_VX:
+                e.movzx8(RAX, hx);
+                e.times5_rax();
+                e.mov32(i_host, RAX);
+                i_dirty = true;
+                break;
+            case OP_LD_VX_DT:
+                e.load8(hx, dt_off);
+                dirty[op.x] = true;
+                break;
+            case OP_LD_DT_VX:
+                e.store8(dt_off, hx);
+                break;
+            case OP_LD_ST_VX:
+                e.store8(st_off, hx);
+                break;
+        }
+    }
+    if (!pc_written) {
+        e.store16_imm(pc_off, addr + 2 * length);
+    }
+
+    // Epilogue, write back the guest registers that changed
+    for (int r = 0; r < REG_SIZE; r++) {
+        if (dirty[r]) {
+            e.store8(v_off + r, host[r]);
+        }
+    }
+    if (i_dirty) {
+        e.store16(i_off, i_host);
+    }
+    for (unsigned int h = hosts_used; h > FIRST_CALLEE_SAVED; h--) {
+        e.pop(HOST_POOL[h - 1]);
+    }
+
+    // Exits, one per target so run can link each to the block it leads to.
+    // Returns go wherever the stack says and always leave through run
+    std::vector<size_t> exits;
+    auto add_exit = [&]() {
+        exits.push_back(e.buf.size());
+        e.store32_imm(exit_off, 0);
+        e.ret();
+    };
+    switch (ops[length - 1].op) {
+        case OP_RET:
+            e.ret();
+            break;
+        case OP_SE_VX_KK:
+        case OP_SNE_VX_KK:
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+            e.cmp16_mem_imm(pc_off, addr + 2 * length);
+            e.jcc8(CC_NE, EXIT_SIZE);
+            add_exit();
+            add_exit();
+            break;
+        default:
+            add_exit();
+            break;
+    }
+
+    // The instructions the block was translated from follow its code
+    size_t source = e.buf.size();
+    e.buf.insert(e.buf.end(), MEM + addr, MEM + addr + 2 * length);
+
+    // Copy the code into executable memory, starting over when it is full.
+    // Exits record their offset in that memory
+    if (code_used + e.buf.size() > JIT_CODE_SIZE) {
+        flush_native();
+    }
+    for (size_t offset : exits) {
+        uint32_t value = (uint32_t)(code_used + offset);
+        memcpy(&e.buf[offset + 6], &value, sizeof(value));
+    }
+    patch_code(code_used, e.buf.data(), e.buf.size());
+    block.fn = (NATIVE_FN)(code + code_used + 1);
+    block.source = code + code_used + source;
+    block.linkable = !may_idle(ops, length, addr);
+    code_used += e.buf.size();
+    native[addr] = block;
+    jit_stats.compiled_blocks++;
+#endif
+}
+
+/**
+ * Patches a block exit into a jump straight to the block it led to, so it no
+ * longer returns to run.  Blocks entered this way check their pages and the
+ * budget themselves, see compile.
+ * @param exit Offset of the exit in the executable memory
+ * @param block The translated block the exit led to
+ */
+void CHIP8JIT::link(uint32_t exit, const NATIVE_BLOCK &block) {
+#ifdef JIT_SUPPORTED
+    // jmp rel32 over the start of the exit
+    uint8_t jump[5] = {0xE9};
+    int32_t rel = (int32_t)((uint8_t *) block.fn - (code + exit + 5));
+    memcpy(jump + 1, &rel, sizeof(rel));
+    patch_code(exit, jump, sizeof(jump));
+    jit_stats.linked_exits++;
+#endif
+}
+
+/**
+ * Writes bytes into the executable memory.
+ * @param offset Offset of the first byte in the executable memory
+ * @param bytes Bytes to write
+ * @param size Number of bytes
+ */
+void CHIP8JIT::patch_code(size_t offset, const void *bytes, size_t size) {
+#ifdef JIT_SUPPORTED
+    if (code_rw == code) {
+        mprotect(code, JIT_CODE_SIZE, PROT_READ | PROT_WRITE);
+    }
+    memcpy(code_rw + offset, bytes, size);
+    if (code_rw == code) {
+        mprotect(code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC);
+    }
+#endif
+}
+
+/**
+ * Executes up to max_steps instructions on the selected engine. The JIT engine
+ * runs translated blocks natively and hands everything else to the
+ * interpreter one instruction at a time.  Translated blocks run on from one
+ * to the next through linked exits until the batch runs out, returning here
+ * for idle loops, returns and anything not translated yet.  Translations
+ * follow the default quirk profile, other profiles run on the interpreter.
+ * @param max_steps Maximum number of instructions to execute
+ * @return Number of instructions executed
+ */
+uint32_t CHIP8JIT::run(uint32_t max_steps) {
+    if (engine != ENGINE_JIT || QUIRKS != QUIRKS_DEFAULT) {
+        return CHIP8CORE::run(max_steps);
+    }
+
+    uint8_t *base = reinterpret_cast<uint8_t *>(static_cast<CHIP8CORE *>(this));
+    uint32_t steps = 0;
+    uint64_t native_steps = 0;
+    while (steps < max_steps && REGS.PC < MEM_SIZE - 1) {
+        // Idle loops start with 1nnn, Ex9E / ExA1 or Fx07
+        uint8_t group = MEM[REGS.PC] >> 4;
+        if (group == 0x1 || group == 0xE || group == 0xF) {
+            uint32_t skipped = skip_idle_loop(max_steps - steps);
+            if (skipped != 0) {
+                steps += skipped;
+                jit_exit = NO_EXIT;
+                continue;
+            }
+        }
+
+        if (!native_valid(REGS.PC)) {
+            compile(REGS.PC);
+        }
+
+        const NATIVE_BLOCK &block = native[REGS.PC];
+        if (block.length != 0 && block.length <= max_steps - steps) {
+            // The exit that led here jumps straight to the block from now on
+            if (jit_exit != NO_EXIT && block.linkable) {
+                link(jit_exit, block);
+            }
+            jit_exit = NO_EXIT;
+            jit_budget = max_steps - steps;
+            block.fn(base);
+            uint32_t executed = max_steps - steps - jit_budget;
+            steps += executed;
+            native_steps += executed;
+        } else {
+            // A single instruction is not worth decoding a block for
+            exec_op((uint16_t) MEM[REGS.PC] << 8 | MEM[REGS.PC + 1]);
+            steps++;
+            jit_stats.fallback_steps++;
+            jit_exit = NO_EXIT;
+        }
+    }
+    jit_stats.native_steps += native_steps;
+    return steps;
+}
@@ -0,0 +1,573 @@
+#include "chip8_lockstep.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+extern uint8_t SPRITE_MAP[MAP_LENGTH];
+
+/**
+ * Selects value in the lanes of the group and old in the others with bit
+ * operations, which keeps the lane loops free of branches.
+ */
+template <typename T>
+static inline T blend(uint8_t mask, T value, T old) {
+    T select = (T) 0 - (T)(mask & 1);
+    return (T)((value & select) | (old & ~select));
+}
+
+// Loops over every lane.  Iterations only touch their own lane, so the loops
+// carry no dependencies and are vectorized even when register rows alias.
+// The lane count is read into a local first, byte stores could alias stride.
+#define FOR_EACH_LANE(l) \
+    _Pragma("GCC ivdep") for (uint32_t l = 0; l < width; l++)
+
+/**
+ * Main constructor for CHIP8LOCKSTEP, every lane starts in the state of a
+ * new CHIP8CORE.
+ * @param lanes Number of instances to run
+ */
+CHIP8LOCKSTEP::CHIP8LOCKSTEP(uint32_t lanes)
+    : lanes(lanes),
+      stride((lanes + LANE_ALIGN - 1) / LANE_ALIGN * LANE_ALIGN),
+      PC(stride, PC_START),
+      SP(stride, 0xFF),
+      STACK(STACK_SIZE * stride, 0),
+      V(REG_SIZE * stride, 0),
+      I(stride, 0),
+      DT(stride, 0),
+      ST(stride, 0),
+      KEYS(stride, 0),
+      RNG(stride, rng_seed_state(DEFAULT_RNG_SEED)),
+      MEM(stride * MEM_SIZE, 0),
+      FRAME(stride * SCREEN_HEIGHT, 0),
+      PRISTINE(MEM_SIZE, 0),
+      PAGE_WRITTEN(stride * NUM_CODE_PAGES, 0),
+      DIRTY_LANES(NUM_CODE_PAGES, 0),
+      LEFT(stride, 0),
+      MASK(stride, 0),
+      STATS{0, 0, 0} {
+    memcpy(PRISTINE.data(), SPRITE_MAP, MAP_LENGTH);
+    for (uint32_t lane = 0; lane < stride; lane++) {
+        memcpy(&MEM[lane * MEM_SIZE], PRISTINE.data(), MEM_SIZE);
+    }
+}
+
+/**
+ * Stores a program into memory starting at address 0x200 in every lane, the
+ * rest of the program area is cleared.
+ * @param data The program bytes
+ * @param size Number of program bytes
+ * @return Boolean indicating if load was successful
+ */
+bool CHIP8LOCKSTEP::load_program_data(const uint8_t *data, size_t size) {
+    if (size > MAX_PROG_SIZE) {
+        std::cout << "Program too large.\n" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < MAX_PROG_SIZE; i++) {
+        PRISTINE[PC_START + i] = (i < size) ? data[i] : 0x00;
+    }
+    for (uint32_t lane = 0; lane < stride; lane++) {
+        memcpy(&MEM[lane * MEM_SIZE], PRISTINE.data(), MEM_SIZE);
+    }
+
+    // Every lane holds the pristine image again
+    memset(PAGE_WRITTEN.data(), 0, PAGE_WRITTEN.size());
+    memset(DIRTY_LANES.data(), 0, DIRTY_LANES.size() * sizeof(uint32_t));
+    return true;
+}
+
+/**
+ * Records that a lane wrote memory, so instructions fetched from the written
+ * pages are compared lane by lane instead of read from the pristine image.
+ * @param lane The lane that wrote
+ * @param addr First address written
+ * @param length Number of bytes written
+ */
+void CHIP8LOCKSTEP::mark_written(uint32_t lane, uint16_t addr,
+                                 uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        uint32_t page = (addr + i) % MEM_SIZE / CODE_PAGE_SIZE;
+        uint8_t &written = PAGE_WRITTEN[lane * NUM_CODE_PAGES + page];
+        if (!written) {
+            written = 1;
+            DIRTY_LANES[page]++;
+        }
+    }
+}
+
+/**
+ * Fetches the instruction at an address when it is the same in every lane,
+ * which holds while no lane wrote the pages it lies in.
+ * @param addr Address of the instruction
+ * @param op Set to the decoded instruction
+ * @return Boolean indicating if the instruction is shared by every lane
+ */
+bool CHIP8LOCKSTEP::fetch_shared(uint16_t addr, DECODED_OP &op) {
+    if (addr >= MEM_SIZE - 1 || DIRTY_LANES[addr / CODE_PAGE_SIZE] != 0 ||
+        DIRTY_LANES[(addr + 1) / CODE_PAGE_SIZE] != 0) {
+        return false;
+    }
+    op = decode_op((uint16_t) PRISTINE[addr] << 8 | PRISTINE[addr + 1]);
+    return true;
+}
+
+/**
+ * Picks the group that executes next: the lanes with steps left at the lowest
+ * PC, which lets groups that split at a branch merge again, and that hold the
+ * same opcode there.
+ * @param pc Set to the PC of the group
+ * @param op Set to the decoded instruction of the group
+ * @param budget Set to at most the fewest steps left of a lane in the group
+ * @return Boolean indicating if any lane has steps left
+ */
+bool CHIP8LOCKSTEP::select_group(uint16_t &pc, DECODED_OP &op,
+                                 uint32_t &budget) {
+    const uint32_t width = stride;
+    const uint16_t *pcs = PC.data();
+    const uint32_t *left = LEFT.data();
+    uint8_t *mask = MASK.data();
+
+    uint16_t lowest = 0xFFFF;
+    FOR_EACH_LANE(l) {
+        uint16_t candidate = pcs[l] | (uint16_t) - (uint16_t)(left[l] == 0);
+        lowest = std::min(lowest, candidate);
+    }
+    if (lowest == 0xFFFF) {
+        return false;
+    }
+    uint32_t fewest = UINT32_MAX;
+    FOR_EACH_LANE(l) {
+        uint8_t in_group = (pcs[l] == lowest) & (left[l] != 0) ? 0xFF : 0;
+        mask[l] = in_group;
+        fewest = std::min(fewest,
+                          blend<uint32_t>(in_group, left[l], UINT32_MAX));
+    }
+    pc = lowest;
+    budget = fewest;
+
+    if (fetch_shared(pc, op)) {
+        return true;
+    }
+
+    // Otherwise the first lane's opcode goes, the others wait their turn
+    int32_t leader = -1;
+    uint16_t opcode = 0;
+    for (uint32_t l = 0; l < width; l++) {
+        if (!mask[l]) {
+            continue;
+        }
+        const uint8_t *mem = &MEM[l * MEM_SIZE];
+        uint16_t lane_opcode = (uint16_t) mem[pc] << 8 | mem[pc + 1];
+        if (leader < 0) {
+            leader = l;
+            opcode = lane_opcode;
+        } else if (lane_opcode != opcode) {
+            mask[l] = 0;
+        }
+    }
+    op = decode_op(opcode);
+    return true;
+}
+
+/**
+ * Executes up to max_steps instructions in every lane, stopping lanes whose
+ * PC escapes memory.  Each lane ends in the state CHIP8CORE::run(max_steps)
+ * would leave it in and counts the same number of instructions.
+ * @param max_steps Maximum number of instructions per lane
+ * @return Number of instructions executed summed over the lanes
+ */
+uint64_t CHIP8LOCKSTEP::run(uint32_t max_steps) {
+    const uint32_t width = stride;
+    uint32_t *left = LEFT.data();
+    const uint16_t *pcs = PC.data();
+    const uint8_t *mask = MASK.data();
+    FOR_EACH_LANE(l) {
+        left[l] = (l < lanes && pcs[l] < MEM_SIZE - 1) ? max_steps : 0;
+    }
+
+    uint64_t steps = 0;
+    uint16_t pc;
+    DECODED_OP op;
+    uint32_t budget;
+    while (select_group(pc, op, budget)) {
+        // Lanes that jumped to themselves spend their remaining steps there,
+        // as CHIP8CORE::run fast-forwards them
+        if (op.op == OP_JP && op.nnn == pc) {
+            FOR_EACH_LANE(l) {
+                steps += blend<uint32_t>(mask[l], left[l], 0);
+                left[l] = blend<uint32_t>(mask[l], 0, left[l]);
+            }
+            STATS.issues++;
+            continue;
+        }
+
+        uint32_t length = execute_block(pc, op, budget);
+
+        // Lanes that left memory are done
+        uint32_t group = 0;
+        FOR_EACH_LANE(l) {
+            group += mask[l] & 1;
+            uint32_t remaining = left[l] - blend<uint32_t>(mask[l], length, 0);
+            left[l] = pcs[l] < MEM_SIZE - 1 ? remaining : 0;
+        }
+        STATS.issues += length;
+        steps += (uint64_t) group * length;
+    }
+    STATS.lane_steps += steps;
+    return steps;
+}
+
+/**
+ * Executes the straight-line code starting at the group's PC for the lanes
+ * in MASK, up to and including the first instruction that may branch or
+ * write memory.  The instructions in between do not read PC, so PC is
+ * advanced once for the whole block.
+ * @param pc Address of the first instruction
+ * @param op The decoded first instruction
+ * @param budget Maximum number of instructions, at least 1
+ * @return Number of instructions executed
+ */
+uint32_t CHIP8LOCKSTEP::execute_block(uint16_t pc, DECODED_OP op,
+                                      uint32_t budget) {
+    const uint32_t width = stride;
+    const uint8_t *mask = MASK.data();
+    uint16_t *pcs = PC.data();
+
+    uint32_t length = 1;
+    DECODED_OP next;
+    while (!ends_block(op.op) && length < budget &&
+           fetch_shared(pc + 2 * length, next)) {
+        execute(op);
+        op = next;
+        length++;
+    }
+
+    // The last instruction may read PC, which must point past it
+    uint16_t advance = 2 * length;
+    FOR_EACH_LANE(l) { pcs[l] += blend<uint16_t>(mask[l], advance, 0); }
+    execute(op);
+    return length;
+}
+
+/**
+ * Executes an instruction for the lanes in MASK.  Register, timer, branch,
+ * stack, key and Cxkk instructions run as loops over all lanes that only
+ * update masked lanes, the rest is handed to execute_scalar.
+ * @param op The decoded instruction, PC already points past it for
+ * instructions that read it
+ */
+void CHIP8LOCKSTEP::execute(const DECODED_OP &op) {
+    const uint32_t width = stride;
+    const uint8_t *m = MASK.data();
+    uint8_t *vx = &V[op.x * stride];
+    uint8_t *vy = &V[op.y * stride];
+    uint8_t *vf = &V[0xF * stride];
+    uint8_t *v0 = V.data();
+    uint16_t *pc = PC.data();
+    uint8_t *sp = SP.data();
+    uint16_t *stack = STACK.data();
+    const uint16_t *keys = KEYS.data();
+    uint64_t *rng = RNG.data();
+    uint16_t *index = I.data();
+    uint8_t *dt = DT.data();
+    uint8_t *st = ST.data();
+    uint8_t kk = op.kk;
+    uint16_t nnn = op.nnn;
+
+    // Instructions that write VF write it before the result, as CHIP8CORE
+    // does, which matters when x or y is F
+    switch (op.op) {
+        case OP_NOP:
+            break;
+        case OP_RET:
+            FOR_EACH_LANE(l) {
+                uint16_t ret = stack[(sp[l] % STACK_SIZE) * width + l];
+                pc[l] = blend<uint16_t>(m[l], ret, pc[l]);
+                sp[l] -= m[l] & 1;
+            }
+            break;
+        case OP_JP:
+            FOR_EACH_LANE(l) { pc[l] = blend<uint16_t>(m[l], nnn, pc[l]); }
+            break;
+        case OP_CALL:
+            FOR_EACH_LANE(l) { sp[l] += m[l] & 1; }
+            FOR_EACH_LANE(l) {
+                uint16_t &entry = stack[(sp[l] % STACK_SIZE) * width + l];
+                entry = blend<uint16_t>(m[l], pc[l], entry);
+                pc[l] = blend<uint16_t>(m[l], nnn, pc[l]);
+            }
+            break;
+        case OP_SE_VX_KK:
+            FOR_EACH_LANE(l) { pc[l] += (m[l] & (vx[l] == kk ? 2 : 0)); }
+            break;
+        case OP_SNE_VX_KK:
+            FOR_EACH_LANE(l) { pc[l] += (m[l] & (vx[l] != kk ? 2 : 0)); }
+            break;
+        case OP_SE_VX_VY:
+            FOR_EACH_LANE(l) { pc[l] += (m[l] & (vx[l] == vy[l] ? 2 : 0)); }
+            break;
+        case OP_SNE_VX_VY:
+            FOR_EACH_LANE(l) { pc[l] += (m[l] & (vx[l] != vy[l] ? 2 : 0)); }
+            break;
+        case OP_LD_VX_KK:
+            FOR_EACH_LANE(l) { vx[l] = blend<uint8_t>(m[l], kk, vx[l]); }
+            break;
+        case OP_ADD_VX_KK:
+            FOR_EACH_LANE(l) { vx[l] += m[l] & kk; }
+            break;
+        case OP_LD_VX_VY:
+            FOR_EACH_LANE(l) { vx[l] = blend<uint8_t>(m[l], vy[l], vx[l]); }
+            break;
+        case OP_OR:
+            FOR_EACH_LANE(l) { vx[l] |= m[l] & vy[l]; }
+            break;
+        case OP_AND:
+            FOR_EACH_LANE(l) { vx[l] &= ~m[l] | vy[l]; }
+            break;
+        case OP_XOR:
+            FOR_EACH_LANE(l) { vx[l] ^= m[l] & vy[l]; }
+            break;
+        case OP_ADD_VX_VY:
+            FOR_EACH_LANE(l) {
+                uint8_t carry = (vx[l] + vy[l]) > 255 ? 1 : 0;
+                vf[l] = blend<uint8_t>(m[l], carry, vf[l]);
+            }
+            FOR_EACH_LANE(l) { vx[l] += m[l] & vy[l]; }
+            break;
+        case OP_SUB:
+            FOR_EACH_LANE(l) {
+                uint8_t borrow = vx[l] > vy[l] ? 1 : 0;
+                vf[l] = blend<uint8_t>(m[l], borrow, vf[l]);
+            }
+            FOR_EACH_LANE(l) { vx[l] -= m[l] & vy[l]; }
+            break;
+        case OP_SHR:
+            FOR_EACH_LANE(l) {
+                vf[l] = blend<uint8_t>(m[l], vx[l] & 0x1, vf[l]);
+            }
+            FOR_EACH_LANE(l) {
+                vx[l] = blend<uint8_t>(m[l], vx[l] >> 1, vx[l]);
+            }
+            break;
+        case OP_SUBN:
+            FOR_EACH_LANE(l) {
+                uint8_t borrow = vy[l] > vx[l] ? 1 : 0;
+                vf[l] = blend<uint8_t>(m[l], borrow, vf[l]);
+            }
+            FOR_EACH_LANE(l) {
+                uint8_t result = vy[l] - vx[l];
+                vx[l] = blend<uint8_t>(m[l], result, vx[l]);
+            }
+            break;
+        case OP_SHL:
+            FOR_EACH_LANE(l) {
+                vf[l] = blend<uint8_t>(m[l], (vx[l] & 0x80) >> 7, vf[l]);
+            }
+            FOR_EACH_LANE(l) {
+                uint8_t result = vx[l] << 1;
+                vx[l] = blend<uint8_t>(m[l], result, vx[l]);
+            }
+            break;
+        case OP_LD_I:
+            FOR_EACH_LANE(l) {
+                index[l] = blend<uint16_t>(m[l], nnn, index[l]);
+            }
+            break;
+        case OP_JP_V0:
+            FOR_EACH_LANE(l) {
+                pc[l] = blend<uint16_t>(m[l], v0[l] + nnn, pc[l]);
+            }
+            break;
+        case OP_RND:
+            // Only the generators of masked lanes advance
+            FOR_EACH_LANE(l) {
+                uint64_t state = rng[l];
+                uint8_t byte = rng_next(state) & kk;
+                rng[l] = blend<uint64_t>(m[l], state, rng[l]);
+                vx[l] = blend<uint8_t>(m[l], byte, vx[l]);
+            }
+            break;
+        case OP_SKP:
+            FOR_EACH_LANE(l) {
+                uint8_t pressed = (vx[l] < NUM_KEYS) & keys[l] >> (vx[l] & 0xF);
+                pc[l] += m[l] & (pressed & 1) << 1;
+            }
+            break;
+        case OP_SKNP:
+            FOR_EACH_LANE(l) {
+                uint8_t pressed = (vx[l] < NUM_KEYS) & keys[l] >> (vx[l] & 0xF);
+                pc[l] += m[l] & (~pressed & 1) << 1;
+            }
+            break;
+        case OP_LD_VX_DT:
+            FOR_EACH_LANE(l) { vx[l] = blend<uint8_t>(m[l], dt[l], vx[l]); }
+            break;
+        case OP_LD_DT_VX:
+            FOR_EACH_LANE(l) { dt[l] = blend<uint8_t>(m[l], vx[l], dt[l]); }
+            break;
+        case OP_LD_ST_VX:
+            FOR_EACH_LANE(l) { st[l] = blend<uint8_t>(m[l], vx[l], st[l]); }
+            break;
+        case OP_ADD_I_VX:
+            FOR_EACH_LANE(l) { index[l] += blend<uint16_t>(m[l], vx[l], 0); }
+            break;
+        case OP_LD_F_VX:
+            FOR_EACH_LANE(l) {
+                index[l] = blend<uint16_t>(m[l], 5 * vx[l], index[l]);
+            }
+            break;
+        default:
+            execute_scalar(op);
+            break;
+    }
+}
+
+/**
+ * Executes the instructions that access memory or the framebuffer at lane
+ * dependent addresses, one masked lane at a time.
+ * @param op The decoded instruction, PC already points past it
+ */
+void CHIP8LOCKSTEP::execute_scalar(const DECODED_OP &op) {
+    for (uint32_t l = 0; l < stride; l++) {
+        if (!MASK[l]) {
+            continue;
+        }
+        STATS.scalar_lane_steps++;
+
+        uint8_t *mem = &MEM[l * MEM_SIZE];
+        uint8_t &vx = V[op.x * stride + l];
+        uint16_t &index = I[l];
+        uint16_t &pc = PC[l];
+        switch (op.op) {
+            case OP_CLS:
+                memset(&FRAME[l * SCREEN_HEIGHT], 0,
+                       SCREEN_HEIGHT * sizeof(uint64_t));
+                break;
+            case OP_DRW:
+                draw_sprite(l, vx, V[op.y * stride + l], op.kk & 0x0F);
+                break;
+            case OP_LD_VX_K:
+                // Lowest pressed key, otherwise re-execute this instruction
+                if (KEYS[l] != 0) {
+                    vx = __builtin_ctz(KEYS[l]);
+                } else {
+                    pc -= 2;
+                }
+                break;
+            case OP_LD_B_VX:
+                mem[index % MEM_SIZE] = vx / 100;
+                mem[(index + 1) % MEM_SIZE] = (vx % 100) / 10;
+                mem[(index + 2) % MEM_SIZE] = vx % 10;
+                mark_written(l, index % MEM_SIZE, 3);
+                break;
+            case OP_LD_MEM_VX:
+                for (int i = 0; i <= op.x; i++) {
+                    mem[(index + i) % MEM_SIZE] = V[i * stride + l];
+                }
+                mark_written(l, index % MEM_SIZE, op.x + 1);
+                break;
+            case OP_LD_VX_MEM:
+                for (int i = 0; i <= op.x; i++) {
+                    V[i * stride + l] = mem[(index + i) % MEM_SIZE];
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Draws a sprite into the framebuffer of a lane a row at a time, like
+ * CHIP8CORE::draw_sprite, VF reports collisions.
+ * @param lane The lane drawing
+ * @param x x coordinate to start drawing the sprite at
+ * @param y y coordinate to start drawing the sprite at
+ * @param nibble Number of bytes that make up the sprite
+ */
+void CHIP8LOCKSTEP::draw_sprite(uint32_t lane, uint8_t x, uint8_t y,
+                                uint8_t nibble) {
+    const uint8_t *mem = &MEM[lane * MEM_SIZE];
+    uint64_t *frame = &FRAME[lane * SCREEN_HEIGHT];
+    uint64_t collision = 0;
+    for (int line = 0;
+         x < SCREEN_WIDTH && line < nibble && y + line < SCREEN_HEIGHT;
+         line++) {
+        uint64_t bits = (uint64_t) mem[(I[lane] + line) % MEM_SIZE] << 56 >> x;
+        collision |= frame[y + line] & bits;
+        frame[y + line] ^= bits;
+    }
+    V[0xF * stride + lane] = (collision != 0) ? 1 : 0;
+}
+
+/**
+ * Decrements the delay and sound timers of every lane, must be called at
+ * 60Hz.
+ */
+void CHIP8LOCKSTEP::tick_timers() {
+    const uint32_t width = stride;
+    uint8_t *dt = DT.data();
+    uint8_t *st = ST.data();
+    FOR_EACH_LANE(l) {
+        dt[l] -= dt[l] != 0;
+        st[l] -= st[l] != 0;
+    }
+}
+
+/**
+ * Updates the pressed state of a key of one lane.
+ * @param lane The lane
+ * @param key The hex key to update
+ * @param pressed Boolean indicating if the key is pressed (true) or not
+ */
+void CHIP8LOCKSTEP::set_key_status(uint32_t lane, uint8_t key, bool pressed) {
+    if (lane < lanes && key < NUM_KEYS) {
+        uint16_t bit = 1 << key;
+        KEYS[lane] = pressed ? (KEYS[lane] | bit) : (KEYS[lane] & ~bit);
+    }
+}
+
+/**
+ * Seeds the Cxkk generator of one lane, equal to CHIP8CORE::seed_rng.
+ * @param lane The lane
+ * @param seed Any 64-bit value
+ */
+void CHIP8LOCKSTEP::seed_rng(uint32_t lane, uint64_t seed) {
+    if (lane < lanes) {
+        RNG[lane] = rng_seed_state(seed);
+    }
+}
+
+/**
+ * Getter function for the number of lanes.
+ * @return Number of instances
+ */
+uint32_t CHIP8LOCKSTEP::get_lanes() { return lanes; }
+
+/**
+ * Getter functions for the state of a lane.
+ */
+uint16_t CHIP8LOCKSTEP::get_pc(uint32_t lane) { return PC[lane]; }
+uint8_t CHIP8LOCKSTEP::get_sp(uint32_t lane) { return SP[lane]; }
+uint16_t CHIP8LOCKSTEP::get_stack(uint32_t lane, uint8_t entry) {
+    return STACK[(entry % STACK_SIZE) * stride + lane];
+}
+uint8_t CHIP8LOCKSTEP::get_reg(uint32_t lane, uint8_t reg) {
+    return V[(reg % REG_SIZE) * stride + lane];
+}
+uint16_t CHIP8LOCKSTEP::get_index_reg(uint32_t lane) { return I[lane]; }
+uint8_t CHIP8LOCKSTEP::get_delay_timer(uint32_t lane) { return DT[lane]; }
+uint8_t CHIP8LOCKSTEP::get_sound_timer(uint32_t lane) { return ST[lane]; }
+uint8_t *CHIP8LOCKSTEP::get_mem(uint32_t lane) {
+    return &MEM[lane * MEM_SIZE];
+}
+const uint64_t *CHIP8LOCKSTEP::get_frame_buffer(uint32_t lane) {
+    return &FRAME[lane * SCREEN_HEIGHT];
+}
+
+/**
+ * Returns the lane utilization counters
+ * @return Counters of issued instructions and lane steps
+ */
+LOCKSTEP_STATS CHIP8LOCKSTEP::get_lockstep_stats() { return STATS; }
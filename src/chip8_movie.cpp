@@ -0,0 +1,404 @@
+#include "chip8_movie.h"
+
+#include <string.h>
+
+#include <memory>
+
+#include "chip8_batch.h"
+
+#define MOVIE_HEADER_SIZE 56  // Bytes before the keyframe index
+#define MOVIE_INDEX_ENTRY 16  // Bytes per keyframe in the index
+#define MOVIE_EVENT_SIZE 14   // Bytes per event
+
+/**
+ * Appends a little endian value to a buffer.
+ * @param out The buffer
+ * @param value The value
+ * @param bytes Number of bytes to append
+ */
+static void put_le(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+/**
+ * Reads a little endian value from a buffer.
+ * @param in The buffer
+ * @param pos Offset of the value, advanced past it
+ * @param bytes Number of bytes to read
+ * @return The value
+ */
+static uint64_t get_le(const std::vector<uint8_t> &in, size_t &pos,
+                       int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t) in[pos++] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Main constructor for CHIP8MOVIE, the movie starts empty.
+ */
+CHIP8MOVIE::CHIP8MOVIE() {
+    recording = false;
+    desynced = false;
+    seed = 0;
+    spf = 1;
+    interval = DEFAULT_MOVIE_KEYFRAME_INTERVAL;
+    frames = 0;
+    steps = 0;
+    final_hash = 0;
+    frame = 0;
+    step = 0;
+    next_event = 0;
+}
+
+/**
+ * Starts a recording, discarding what the movie held.  The core is seeded
+ * and its state becomes the first keyframe.
+ * @param core Core that just loaded its ROM
+ * @param rng_seed Seed of Cxkk's generator
+ * @param steps_per_frame Instructions executed per frame
+ * @param keyframe_interval Frames between stored states, at least 1
+ */
+void CHIP8MOVIE::record(CHIP8CORE &core, uint64_t rng_seed,
+                        uint32_t steps_per_frame, uint32_t keyframe_interval) {
+    seed = rng_seed;
+    spf = steps_per_frame;
+    interval = (keyframe_interval != 0) ? keyframe_interval : 1;
+    recording = true;
+    desynced = false;
+    frames = 0;
+    steps = 0;
+    frame = 0;
+    step = 0;
+    next_event = 0;
+    EVENTS.clear();
+    KEYFRAMES.clear();
+
+    core.seed_rng(seed);
+    add_keyframe(core);
+}
+
+/**
+ * Stores the state of a core as the keyframe of the current frame.
+ * @param core The recorded core
+ */
+void CHIP8MOVIE::add_keyframe(CHIP8CORE &core) {
+    KEYFRAMES.emplace_back();
+    MOVIE_KEYFRAME &keyframe = KEYFRAMES.back();
+    keyframe.frame = frame;
+    keyframe.event = EVENTS.size();
+    keyframe.step = step;
+    keyframe.state.resize(SERIALIZED_STATE_SIZE);
+    core.serialize(keyframe.state.data(), keyframe.state.size());
+}
+
+/**
+ * Presses or releases a key of the recorded core, recording the transition
+ * if the key changed.  Fx0A reads the same key state, so waiting for a key
+ * replays as well.
+ * @param core The recorded core
+ * @param key The hex key
+ * @param pressed Boolean indicating if the key is pressed
+ */
+void CHIP8MOVIE::key_event(CHIP8CORE &core, uint8_t key, bool pressed) {
+    if (key >= NUM_KEYS || core.get_key_status(key) == pressed) {
+        return;
+    }
+    core.set_key_status(key, pressed);
+    if (recording) {
+        EVENTS.push_back(MOVIE_EVENT{frame, step, key, pressed});
+    }
+}
+
+/**
+ * Ends a recording, the movie is then ready to be saved or played.
+ * @param core The recorded core
+ */
+void CHIP8MOVIE::stop(CHIP8CORE &core) {
+    if (recording) {
+        frames = frame;
+        steps = step;
+        final_hash = hash_frame_buffer(core.get_frame_buffer());
+        recording = false;
+    }
+}
+
+/**
+ * Starts a replay from the first frame.
+ * @param core The core to replay on, its state is replaced
+ * @return Boolean indicating if the movie holds a recording
+ */
+bool CHIP8MOVIE::play(CHIP8CORE &core) { return seek(core, 0); }
+
+/**
+ * Moves a replay to a frame.  The core restores the last keyframe at or
+ * before the frame and replays the frames after it at full speed.
+ * @param core The core to replay on, its state is replaced
+ * @param target Frames completed when the seek returns
+ * @return Boolean indicating if the movie reaches the frame, the core is
+ * unchanged otherwise
+ */
+bool CHIP8MOVIE::seek(CHIP8CORE &core, uint32_t target) {
+    if (recording || KEYFRAMES.empty() || target > frames) {
+        return false;
+    }
+
+    // Keyframes are sorted by frame, find the last one not after the target
+    size_t low = 0, high = KEYFRAMES.size();
+    while (high - low > 1) {
+        size_t mid = (low + high) / 2;
+        if (KEYFRAMES[mid].frame <= target) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    const MOVIE_KEYFRAME &keyframe = KEYFRAMES[low];
+    if (!core.deserialize(keyframe.state.data(), keyframe.state.size())) {
+        return false;
+    }
+    frame = keyframe.frame;
+    step = keyframe.step;
+    next_event = keyframe.event;
+    desynced = false;
+
+    while (frame < target) {
+        run_frame(core);
+    }
+    return true;
+}
+
+/**
+ * Runs one frame.  A recording takes a keyframe when one is due, a replay
+ * first applies the key transitions recorded before the frame.
+ * @param core The core being recorded or replayed
+ * @return Instructions executed, 0 once a replay reached the end
+ */
+uint32_t CHIP8MOVIE::run_frame(CHIP8CORE &core) {
+    if (!recording) {
+        if (frame >= frames) {
+            return 0;
+        }
+        for (; next_event < EVENTS.size() && EVENTS[next_event].frame == frame;
+             next_event++) {
+            const MOVIE_EVENT &event = EVENTS[next_event];
+            desynced |= event.step != step;
+            core.set_key_status(event.key, event.pressed);
+        }
+    }
+
+    uint32_t executed = core.run_frame(spf);
+    frame++;
+    step += executed;
+
+    if (recording && frame % interval == 0) {
+        add_keyframe(core);
+    }
+    return executed;
+}
+
+/**
+ * Writes the movie to a file: a header, the keyframe index, the events and
+ * the keyframe states as written by CHIP8CORE::serialize, little endian.
+ * @param path Path of the movie file
+ * @return Boolean indicating if the movie was written
+ */
+bool CHIP8MOVIE::save(const char *path) {
+    std::vector<uint8_t> data;
+    data.insert(data.end(), {'C', '8', 'M', 'V'});
+    put_le(data, MOVIE_VERSION, 4);
+    put_le(data, SERIALIZED_STATE_SIZE, 4);
+    put_le(data, seed, 8);
+    put_le(data, spf, 4);
+    put_le(data, interval, 4);
+    put_le(data, frames, 4);
+    put_le(data, steps, 8);
+    put_le(data, final_hash, 8);
+    put_le(data, EVENTS.size(), 4);
+    put_le(data, KEYFRAMES.size(), 4);
+
+    for (const MOVIE_KEYFRAME &keyframe : KEYFRAMES) {
+        put_le(data, keyframe.frame, 4);
+        put_le(data, keyframe.event, 4);
+        put_le(data, keyframe.step, 8);
+    }
+    for (const MOVIE_EVENT &event : EVENTS) {
+        put_le(data, event.frame, 4);
+        put_le(data, event.step, 8);
+        put_le(data, event.key, 1);
+        put_le(data, event.pressed, 1);
+    }
+    for (const MOVIE_KEYFRAME &keyframe : KEYFRAMES) {
+        data.insert(data.end(), keyframe.state.begin(), keyframe.state.end());
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        std::cout << "Unable to open movie " << path << std::endl;
+        return false;
+    }
+    size_t written = fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    return written == data.size();
+}
+
+/**
+ * Reads a movie file written by save, ready to be played.  Every keyframe
+ * must deserialize, so a replay never starts from an invalid machine.
+ * @param path Path of the movie file
+ * @return Boolean indicating if the file holds a movie of this version
+ */
+bool CHIP8MOVIE::load(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        std::cout << "Unable to open movie " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        data.insert(data.end(), buffer, buffer + count);
+    }
+    fclose(file);
+
+    size_t pos = 4;
+    if (data.size() < MOVIE_HEADER_SIZE ||
+        memcmp(data.data(), "C8MV", 4) != 0 ||
+        get_le(data, pos, 4) != MOVIE_VERSION ||
+        get_le(data, pos, 4) != SERIALIZED_STATE_SIZE) {
+        std::cout << "Not a movie of this version: " << path << std::endl;
+        return false;
+    }
+    seed = get_le(data, pos, 8);
+    spf = get_le(data, pos, 4);
+    interval = get_le(data, pos, 4);
+    frames = get_le(data, pos, 4);
+    steps = get_le(data, pos, 8);
+    final_hash = get_le(data, pos, 8);
+    uint64_t num_events = get_le(data, pos, 4);
+    uint64_t num_keyframes = get_le(data, pos, 4);
+    uint64_t expected = MOVIE_HEADER_SIZE + num_events * MOVIE_EVENT_SIZE +
+                        num_keyframes *
+                                (MOVIE_INDEX_ENTRY + SERIALIZED_STATE_SIZE);
+    if (data.size() != expected || num_keyframes == 0) {
+        std::cout << "Truncated movie: " << path << std::endl;
+        frames = 0;
+        EVENTS.clear();
+        KEYFRAMES.clear();
+        return false;
+    }
+
+    KEYFRAMES.resize(num_keyframes);
+    for (MOVIE_KEYFRAME &keyframe : KEYFRAMES) {
+        keyframe.frame = get_le(data, pos, 4);
+        keyframe.event = get_le(data, pos, 4);
+        keyframe.step = get_le(data, pos, 8);
+    }
+    EVENTS.resize(num_events);
+    for (MOVIE_EVENT &event : EVENTS) {
+        event.frame = get_le(data, pos, 4);
+        event.step = get_le(data, pos, 8);
+        event.key = get_le(data, pos, 1);
+        event.pressed = get_le(data, pos, 1) != 0;
+    }
+    std::unique_ptr<CHIP8CORE> check(new CHIP8CORE());
+    for (MOVIE_KEYFRAME &keyframe : KEYFRAMES) {
+        keyframe.state.assign(data.begin() + pos,
+                              data.begin() + pos + SERIALIZED_STATE_SIZE);
+        pos += SERIALIZED_STATE_SIZE;
+        if (!check->deserialize(keyframe.state.data(), keyframe.state.size())) {
+            std::cout << "Invalid keyframe in movie: " << path << std::endl;
+            frames = 0;
+            EVENTS.clear();
+            KEYFRAMES.clear();
+            return false;
+        }
+    }
+
+    recording = false;
+    desynced = false;
+    frame = 0;
+    step = 0;
+    next_event = 0;
+    return true;
+}
+
+/**
+ * Getter function for the recording flag.
+ * @return Boolean indicating if frames are being recorded
+ */
+bool CHIP8MOVIE::is_recording() { return recording; }
+
+/**
+ * Getter function for the end of a replay.
+ * @return Boolean indicating if every recorded frame was replayed
+ */
+bool CHIP8MOVIE::is_finished() { return !recording && frame >= frames; }
+
+/**
+ * Getter function for the desync flag.
+ * @return Boolean indicating if a replayed key transition came after another
+ * number of instructions than it was recorded at
+ */
+bool CHIP8MOVIE::is_desynced() { return desynced; }
+
+/**
+ * Getter function for the frames completed by the recording or replay.
+ * @return Frame counter
+ */
+uint32_t CHIP8MOVIE::get_frame() { return frame; }
+
+/**
+ * Getter function for the instructions executed by the recording or replay.
+ * @return Instruction counter, including skipped idle loop iterations
+ */
+uint64_t CHIP8MOVIE::get_steps() { return step; }
+
+/**
+ * Getter function for the length of the movie.
+ * @return Frames recorded
+ */
+uint32_t CHIP8MOVIE::get_frames() { return frames; }
+
+/**
+ * Getter function for the instructions of the whole movie.
+ * @return Instructions executed by the recording
+ */
+uint64_t CHIP8MOVIE::get_total_steps() { return steps; }
+
+/**
+ * Getter function for the framebuffer hash the recording ended with.
+ * @return Hash of the final framebuffer, see hash_frame_buffer
+ */
+uint64_t CHIP8MOVIE::get_final_hash() { return final_hash; }
+
+/**
+ * Getter function for the seed of Cxkk's generator.
+ * @return Seed the recording started with
+ */
+uint64_t CHIP8MOVIE::get_seed() { return seed; }
+
+/**
+ * Getter function for the emulation speed of the movie.
+ * @return Instructions per frame
+ */
+uint32_t CHIP8MOVIE::get_steps_per_frame() { return spf; }
+
+/**
+ * Getter function for the recorded key transitions.
+ * @return Events in the order they happened
+ */
+const std::vector<MOVIE_EVENT> &CHIP8MOVIE::get_events() { return EVENTS; }
+
+/**
+ * Getter function for the stored states.
+ * @return Keyframes in order of frame
+ */
+const std::vector<MOVIE_KEYFRAME> &CHIP8MOVIE::get_keyframes() {
+    return KEYFRAMES;
+}
@@ -0,0 +1,210 @@
+#include "chip8_rewind.h"
+
+#include <string.h>
+
+/**
+ * Reference keyframes are compressed against, all bytes zero.
+ */
+static const uint8_t ZERO_STATE[SERIALIZED_STATE_SIZE] = {};
+
+/**
+ * Main constructor for CHIP8REWIND.
+ * @param capacity Bytes of compressed history to keep
+ * @param keyframe_interval Frames from one keyframe to the next, at least 1
+ */
+CHIP8REWIND::CHIP8REWIND(size_t capacity, uint32_t keyframe_interval)
+    : RING(capacity), head(0) {
+    interval = (keyframe_interval != 0) ? keyframe_interval : 1;
+
+    // Runs of unchanged bytes take two bytes, changed bytes one
+    ENCODED.resize(SERIALIZED_STATE_SIZE * 2);
+    KEYFRAME.resize(SERIALIZED_STATE_SIZE);
+    SCRATCH.resize(SERIALIZED_STATE_SIZE);
+}
+
+/**
+ * Compresses the XOR of a serialized state with a reference.  Changed bytes
+ * are stored as their non-zero XOR, runs of up to 256 unchanged bytes as a
+ * zero byte followed by the run length minus one.  Serialized states hold
+ * only defined bytes, unlike the padding of MACHINE_STATE.
+ * @param state Serialized state to compress
+ * @param reference Serialized state the changes are taken against
+ * @param out Receives at most twice the size of the state
+ * @return Compressed bytes
+ */
+uint32_t CHIP8REWIND::encode(const uint8_t *state, const uint8_t *reference,
+                             uint8_t *out) {
+    const uint8_t *a = state;
+    const uint8_t *b = reference;
+    const uint32_t size = SERIALIZED_STATE_SIZE;
+
+    uint32_t length = 0;
+    uint32_t i = 0;
+    while (i < size) {
+        if (a[i] != b[i]) {
+            out[length++] = a[i] ^ b[i];
+            i++;
+            continue;
+        }
+
+        // Skip unchanged bytes eight at a time where possible
+        uint32_t run = 1;
+        while (run + 8 <= 256 && i + run + 8 <= size &&
+               memcmp(a + i + run, b + i + run, 8) == 0) {
+            run += 8;
+        }
+        while (run < 256 && i + run < size && a[i + run] == b[i + run]) {
+            run++;
+        }
+        out[length++] = 0;
+        out[length++] = (uint8_t)(run - 1);
+        i += run;
+    }
+    return length;
+}
+
+/**
+ * XORs a frame compressed by encode into a state.
+ * @param in Compressed frame
+ * @param length Compressed bytes
+ * @param out The serialized reference state, receives the frame
+ */
+void CHIP8REWIND::decode(const uint8_t *in, uint32_t length, uint8_t *out) {
+    uint32_t i = 0;
+    for (uint32_t p = 0; p < length; p++) {
+        if (in[p] != 0) {
+            out[i++] ^= in[p];
+        } else {
+            i += in[++p] + 1u;
+        }
+    }
+}
+
+/**
+ * Drops the oldest keyframe together with the frames stored against it.
+ */
+void CHIP8REWIND::drop_oldest() {
+    ENTRIES.pop_front();
+    while (!ENTRIES.empty() && ENTRIES.front().distance != 0) {
+        ENTRIES.pop_front();
+    }
+    if (ENTRIES.empty()) {
+        head = 0;
+    }
+}
+
+/**
+ * Frees length contiguous bytes at the head of the ring by dropping the
+ * oldest frames, wrapping to the start of the ring when the end is reached.
+ * @param length Bytes needed
+ * @return Boolean indicating if the ring is large enough
+ */
+bool CHIP8REWIND::make_room(uint32_t length) {
+    if (length > RING.size()) {
+        return false;
+    }
+
+    // Frames past the head are the oldest ones, the ring restarts before them
+    if (head + length > RING.size()) {
+        while (!ENTRIES.empty() && ENTRIES.front().offset >= head) {
+            drop_oldest();
+        }
+        head = 0;
+    }
+    while (!ENTRIES.empty() && ENTRIES.front().offset >= head &&
+           ENTRIES.front().offset < head + length) {
+        drop_oldest();
+    }
+    return true;
+}
+
+/**
+ * Records the state of a core, must be called once per frame.
+ * @param core The core after running a frame
+ * @return Boolean indicating if the frame fits in the ring
+ */
+bool CHIP8REWIND::push(CHIP8CORE &core) {
+    core.serialize(SCRATCH.data(), SCRATCH.size());
+    const uint8_t *state = SCRATCH.data();
+    bool keyframe = ENTRIES.empty() || ENTRIES.back().distance + 1 >= interval;
+    uint32_t length = encode(state, keyframe ? ZERO_STATE : KEYFRAME.data(),
+                             ENCODED.data());
+    if (!make_room(length)) {
+        return false;
+    }
+
+    // Dropping old frames took the keyframe of this one with it
+    if (!keyframe && ENTRIES.empty()) {
+        keyframe = true;
+        length = encode(state, ZERO_STATE, ENCODED.data());
+        if (!make_room(length)) {
+            return false;
+        }
+    }
+
+    uint32_t distance = keyframe ? 0 : ENTRIES.back().distance + 1;
+    memcpy(RING.data() + head, ENCODED.data(), length);
+    ENTRIES.push_back(REWIND_ENTRY{head, length, distance});
+    head += length;
+    if (keyframe) {
+        KEYFRAME = SCRATCH;
+    }
+    return true;
+}
+
+/**
+ * Steps back one frame: drops the newest frame and restores the one before
+ * it, which stays recorded so stepping back can continue from there.
+ * @param core The core to restore the frame into
+ * @return Boolean indicating if an older frame was recorded
+ */
+bool CHIP8REWIND::step_back(CHIP8CORE &core) {
+    if (ENTRIES.size() < 2) {
+        return false;
+    }
+
+    REWIND_ENTRY newest = ENTRIES.back();
+    ENTRIES.pop_back();
+    head = newest.offset;
+
+    // The keyframe before the dropped one becomes the newest
+    if (newest.distance == 0) {
+        const REWIND_ENTRY &key =
+                ENTRIES[ENTRIES.size() - 1 - ENTRIES.back().distance];
+        memset(KEYFRAME.data(), 0, KEYFRAME.size());
+        decode(RING.data() + key.offset, key.length, KEYFRAME.data());
+    }
+
+    const REWIND_ENTRY &frame = ENTRIES.back();
+    SCRATCH = KEYFRAME;
+    if (frame.distance != 0) {
+        decode(RING.data() + frame.offset, frame.length, SCRATCH.data());
+    }
+    return core.deserialize(SCRATCH.data(), SCRATCH.size());
+}
+
+/**
+ * Drops every recorded frame.
+ */
+void CHIP8REWIND::clear() {
+    ENTRIES.clear();
+    head = 0;
+}
+
+/**
+ * Getter function for the number of recorded frames.
+ * @return Frames that can be stepped back through, plus the oldest one
+ */
+size_t CHIP8REWIND::get_frames() { return ENTRIES.size(); }
+
+/**
+ * Getter function for the ring bytes held by recorded frames.
+ * @return Sum of the compressed sizes of the frames
+ */
+size_t CHIP8REWIND::get_used_bytes() {
+    size_t bytes = 0;
+    for (const REWIND_ENTRY &entry : ENTRIES) {
+        bytes += entry.length;
+    }
+    return bytes;
+}
@@ -0,0 +1,275 @@
+#include "chip8_rom_cache.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "chip8_bundle.h"
+
+/**
+ * Hashes bytes with 64-bit FNV-1a.
+ * @param data The bytes
+ * @param size Number of bytes
+ * @return The hash
+ */
+uint64_t hash_bytes(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Maps a whole file read-only.  The mapping stays valid once the descriptor
+ * is closed, and an empty file maps to null.
+ * @param path Path of the file
+ * @param max_size Largest file accepted
+ * @param data Set to the start of the mapping
+ * @param size Set to the bytes of the file
+ * @return Boolean indicating if the file was mapped
+ */
+bool map_file(const char *path, size_t max_size, const uint8_t *&data,
+              size_t &size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Unable to open file " << path << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    // LCOV_EXCL_START
+    if (fstat(fd, &info) != 0) {
+        std::cout << "Unable to stat file " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    // LCOV_EXCL_STOP
+    if ((uint64_t) info.st_size > max_size) {
+        std::cout << "File too large: " << path << std::endl;
+        close(fd);
+        return false;
+    }
+
+    data = nullptr;
+    size = (size_t) info.st_size;
+    if (size != 0) {
+        void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // LCOV_EXCL_START
+        if (addr == MAP_FAILED) {
+            std::cout << "Unable to map file " << path << std::endl;
+            close(fd);
+            return false;
+        }
+        // LCOV_EXCL_STOP
+        data = static_cast<const uint8_t *>(addr);
+    }
+    close(fd);
+    return true;
+}
+
+/**
+ * Unmaps a file mapped by map_file.
+ * @param data Start of the mapping
+ * @param size Bytes of the file
+ */
+void unmap_file(const uint8_t *data, size_t size) {
+    if (data != nullptr) {
+        munmap(const_cast<uint8_t *>(data), size);
+    }
+}
+
+/**
+ * Splits a reference to a ROM of a bundle, "bundle.pak#name".
+ * @param ref The reference
+ * @param bundle Set to the path of the bundle
+ * @param name Set to the name of the ROM
+ * @return Boolean indicating if the reference names a ROM of a bundle
+ */
+bool split_bundle_ref(const char *ref, std::string &bundle,
+                      std::string &name) {
+    const char *split = strstr(ref, ".pak#");
+    if (split == nullptr) {
+        return false;
+    }
+    bundle.assign(ref, split + 4);
+    name.assign(split + 5);
+    return true;
+}
+
+/**
+ * Main constructor for MAPPED_ROM, the ROM is empty until opened.
+ */
+MAPPED_ROM::MAPPED_ROM()
+    : data(nullptr),
+      size(0),
+      hash(hash_bytes(nullptr, 0)),
+      quirks(0),
+      mapped(false) {}
+
+/**
+ * Main destructor for MAPPED_ROM, unmaps the file if one is mapped.
+ */
+MAPPED_ROM::~MAPPED_ROM() { close(); }
+
+/**
+ * Maps a ROM file read-only, or opens the bundle of a "bundle.pak#name"
+ * reference and views the ROM in it.  Only read permission is needed, and
+ * an empty file opens as an empty ROM.
+ * @param path Path of the ROM or reference to a ROM of a bundle
+ * @return Boolean indicating if the ROM was found and fits the program area
+ */
+bool MAPPED_ROM::open(const char *path) {
+    close();
+    std::string bundle_path, name;
+    if (split_bundle_ref(path, bundle_path, name)) {
+        std::shared_ptr<ROM_BUNDLE> bundle = std::make_shared<ROM_BUNDLE>();
+        return bundle->open(bundle_path.c_str()) && open(bundle, name.c_str());
+    }
+
+    if (!map_file(path, MAX_PROG_SIZE, data, size)) {
+        return false;
+    }
+    mapped = true;
+    hash = hash_bytes(data, size);
+    return true;
+}
+
+/**
+ * Views a ROM of a bundle, keeping the bundle mapped while the ROM is open.
+ * The hash and quirk profile come from the bundle's index.
+ * @param bundle The bundle
+ * @param name Name of the ROM in the bundle
+ * @return Boolean indicating if the bundle holds the ROM
+ */
+bool MAPPED_ROM::open(const std::shared_ptr<const ROM_BUNDLE> &bundle,
+                      const char *name) {
+    close();
+    const BUNDLE_ENTRY *entry = bundle->find(name);
+    if (entry == nullptr) {
+        std::cout << "No ROM named " << name << " in bundle" << std::endl;
+        return false;
+    }
+    this->bundle = bundle;
+    data = bundle->get_data(*entry);
+    size = entry->size;
+    hash = entry->hash;
+    quirks = entry->quirks;
+    return true;
+}
+
+/**
+ * Unmaps the file or releases the bundle, leaving an empty ROM.
+ */
+void MAPPED_ROM::close() {
+    if (mapped) {
+        unmap_file(data, size);
+    }
+    bundle.reset();
+    data = nullptr;
+    size = 0;
+    hash = hash_bytes(nullptr, 0);
+    quirks = 0;
+    mapped = false;
+}
+
+/**
+ * Getter function for the contents of the ROM.
+ * @return Pointer to the mapped bytes, null for an empty ROM
+ */
+const uint8_t *MAPPED_ROM::get_data() const { return data; }
+
+/**
+ * Getter function for the size of the ROM.
+ * @return Bytes of the ROM
+ */
+size_t MAPPED_ROM::get_size() const { return size; }
+
+/**
+ * Getter function for the hash of the ROM.
+ * @return FNV-1a hash of the contents, see hash_bytes
+ */
+uint64_t MAPPED_ROM::get_hash() const { return hash; }
+
+/**
+ * Getter function for the quirk profile of the ROM.
+ * @return Profile stored with the ROM in its bundle, 0 for plain files
+ */
+uint16_t MAPPED_ROM::get_quirks() const { return quirks; }
+
+/**
+ * Main constructor for ROM_CACHE, nothing is mapped yet.
+ */
+ROM_CACHE::ROM_CACHE() : hits(0) {}
+
+/**
+ * Gets the ROM of a path.  A path seen before returns its mapping straight
+ * away, a new path is mapped and shares the mapping of a ROM already cached
+ * with the same contents.  A bundle is opened on the first reference to one
+ * of its ROMs and kept open for the others.  Safe to call from any thread.
+ * @param path Path of the ROM or reference to a ROM of a bundle
+ * @return The shared ROM, or null if it could not be mapped
+ */
+std::shared_ptr<const MAPPED_ROM> ROM_CACHE::load(const char *path) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto known = paths.find(path);
+    if (known != paths.end()) {
+        hits++;
+        return known->second;
+    }
+
+    std::shared_ptr<MAPPED_ROM> rom = std::make_shared<MAPPED_ROM>();
+    std::string bundle_path, name;
+    if (split_bundle_ref(path, bundle_path, name)) {
+        std::shared_ptr<const ROM_BUNDLE> &bundle = bundles[bundle_path];
+        if (bundle == nullptr) {
+            std::shared_ptr<ROM_BUNDLE> opened = std::make_shared<ROM_BUNDLE>();
+            if (!opened->open(bundle_path.c_str())) {
+                bundles.erase(bundle_path);
+                return nullptr;
+            }
+            bundle = opened;
+        }
+        if (!rom->open(bundle, name.c_str())) {
+            return nullptr;
+        }
+    } else if (!rom->open(path)) {
+        return nullptr;
+    }
+
+    // Hashes only find candidates, the bytes and quirk profile decide
+    auto same = contents.find(rom->get_hash());
+    if (same != contents.end() &&
+        same->second->get_quirks() == rom->get_quirks() &&
+        same->second->get_size() == rom->get_size() &&
+        (rom->get_size() == 0 ||
+         memcmp(same->second->get_data(), rom->get_data(), rom->get_size()) ==
+                 0)) {
+        hits++;
+        paths[path] = same->second;
+        return same->second;
+    }
+    contents[rom->get_hash()] = rom;
+    paths[path] = rom;
+    return rom;
+}
+
+/**
+ * Getter function for the number of mapped ROMs.
+ * @return Distinct ROM contents held by the cache
+ */
+size_t ROM_CACHE::get_mappings() {
+    std::lock_guard<std::mutex> guard(lock);
+    return contents.size();
+}
+
+/**
+ * Getter function for the number of cache hits.
+ * @return Loads that reused a mapping, by path or by contents
+ */
+uint64_t ROM_CACHE::get_hits() {
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
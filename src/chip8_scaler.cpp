@@ -0,0 +1,115 @@
+#include "chip8_scaler.h"
+
+#include <string.h>
+
+/**
+ * Fills one scanline with a row of CHIP 8 pixel colors, each repeated over
+ * its width.  The fills are plain loops the compiler turns into vector
+ * stores, see ENABLE_AVX2.
+ * @param colors Colors of the row's SCREEN_WIDTH pixels
+ * @param line First pixel of the scanline
+ * @param pixel_width Target pixels per CHIP 8 pixel
+ */
+static void scale_line(const uint32_t *colors, uint32_t *line,
+                       int pixel_width) {
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        uint32_t color = colors[x];
+        uint32_t *out = line + x * pixel_width;
+        for (int i = 0; i < pixel_width; i++) {
+            out[i] = color;
+        }
+    }
+}
+
+/**
+ * Upscales the rows of a CHIP 8 screen by nearest neighbour.  Each row is
+ * expanded into its first scanline once and copied into the others, the
+ * rows are independent bands spread over the pool for large targets.
+ * @param expand Function filling the SCREEN_WIDTH colors of a row
+ * @param pixels First pixel of the target
+ * @param width Width of the target in pixels
+ * @param height Height of the target in pixels
+ * @param pitch Bytes from one row of the target to the next
+ * @param pool Workers for large targets, or null to scale on this thread
+ */
+template <typename EXPAND>
+static void scale_rows(const EXPAND &expand, uint32_t *pixels, int width,
+                       int height, int pitch, WORK_STEALING_POOL *pool) {
+    int pixel_width = width / SCREEN_WIDTH;
+    int pixel_height = height / SCREEN_HEIGHT;
+    if (pixel_width == 0 || pixel_height == 0) {
+        return;
+    }
+
+    size_t line_size = (size_t) SCREEN_WIDTH * pixel_width * sizeof(uint32_t);
+    auto band = [&](size_t y) {
+        uint32_t colors[SCREEN_WIDTH];
+        expand(y, colors);
+        uint8_t *first = (uint8_t *) pixels + y * pixel_height * (size_t) pitch;
+        scale_line(colors, (uint32_t *) first, pixel_width);
+        for (int line = 1; line < pixel_height; line++) {
+            memcpy(first + line * (size_t) pitch, first, line_size);
+        }
+    };
+
+    if (pool != nullptr && (int64_t) width * height >= SCALE_THREADED_PIXELS) {
+        pool->run(SCREEN_HEIGHT, band);
+    } else {
+        for (size_t y = 0; y < SCREEN_HEIGHT; y++) {
+            band(y);
+        }
+    }
+}
+
+/**
+ * Upscales rows of CHIP 8 palette indices, e.g. the pixel map of the SDL
+ * frontend, by nearest neighbour.  Every CHIP 8 pixel becomes a block of
+ * width / SCREEN_WIDTH by height / SCREEN_HEIGHT pixels from the top left,
+ * the border the blocks do not cover is left as it is.
+ * @param indices SCREEN_HEIGHT rows of SCREEN_WIDTH palette indices
+ * @param palette Color of each index
+ * @param pixels First pixel of the target
+ * @param width Width of the target in pixels
+ * @param height Height of the target in pixels
+ * @param pitch Bytes from one row of the target to the next
+ * @param pool Workers for targets of SCALE_THREADED_PIXELS and more, or null
+ * to scale on this thread
+ */
+void scale_pixels(const uint8_t (*indices)[SCREEN_WIDTH],
+                  const uint32_t *palette, uint32_t *pixels, int width,
+                  int height, int pitch, WORK_STEALING_POOL *pool) {
+    scale_rows(
+            [=](size_t y, uint32_t *row) {
+                for (int x = 0; x < SCREEN_WIDTH; x++) {
+                    row[x] = palette[indices[y][x]];
+                }
+            },
+            pixels, width, height, pitch, pool);
+}
+
+/**
+ * Upscales a CHIP 8 framebuffer by nearest neighbour, e.g. for capturing
+ * frames headless.  Pixels are laid out as by scale_pixels.
+ * @param frame Rows of the framebuffer, see frame_pixel
+ * @param background Color of unlit pixels
+ * @param foreground Color of lit pixels
+ * @param pixels First pixel of the target
+ * @param width Width of the target in pixels
+ * @param height Height of the target in pixels
+ * @param pitch Bytes from one row of the target to the next
+ * @param pool Workers for targets of SCALE_THREADED_PIXELS and more, or null
+ * to scale on this thread
+ */
+void scale_frame(const uint64_t *frame, uint32_t background,
+                 uint32_t foreground, uint32_t *pixels, int width, int height,
+                 int pitch, WORK_STEALING_POOL *pool) {
+    scale_rows(
+            [=](size_t y, uint32_t *row) {
+                for (int x = 0; x < SCREEN_WIDTH; x++) {
+                    row[x] = (frame[y] >> (SCREEN_WIDTH - 1 - x)) & 1
+                                     ? foreground
+                                     : background;
+                }
+            },
+            pixels, width, height, pitch, pool);
+}
@@ -0,0 +1,412 @@
+#include "chip8_state_file.h"
+
+#include <string.h>
+
+#include <array>
+
+/**
+ * Builds the table of the reflected CRC-32 polynomial 0xEDB88320.
+ * @return Remainder of every byte value
+ */
+static constexpr std::array<uint32_t, 256> build_crc_table() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+        table[byte] = crc;
+    }
+    return table;
+}
+
+/**
+ * CRC-32 remainder table, built at compile time.
+ */
+static constexpr std::array<uint32_t, 256> CRC_TABLE = build_crc_table();
+
+/**
+ * Writes a little endian value into a buffer.
+ * @param out The buffer
+ * @param value Value to write
+ * @param bytes Number of bytes to write
+ */
+static void put_le(uint8_t *out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * Reads a little endian value from a buffer.
+ * @param in The buffer
+ * @param bytes Number of bytes to read
+ * @return The value
+ */
+static uint32_t get_le(const uint8_t *in, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint32_t) in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Computes the CRC-32 (IEEE 802.3, as used by zip and png) of a buffer.
+ * @param data The buffer
+ * @param size Bytes in the buffer
+ * @return The checksum
+ */
+uint32_t state_crc32(const uint8_t *data, size_t size) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+/**
+ * Writes a length that did not fit its 4-bit token field as a run of 255
+ * bytes ended by a smaller one.
+ * @param out Output buffer
+ * @param pos Offset to write at, advanced past the length
+ * @param out_size Bytes available in the output buffer
+ * @param length Length minus the 15 the token holds
+ * @return Boolean indicating if the length fit the buffer
+ */
+static bool put_length(uint8_t *out, size_t &pos, size_t out_size,
+                       size_t length) {
+    for (; length >= 255; length -= 255) {
+        if (pos >= out_size) {
+            return false;
+        }
+        out[pos++] = 255;
+    }
+    if (pos >= out_size) {
+        return false;
+    }
+    out[pos++] = (uint8_t) length;
+    return true;
+}
+
+/**
+ * Reads a length written by put_length.
+ * @param in Input buffer
+ * @param pos Offset to read at, advanced past the length
+ * @param size Bytes in the input buffer
+ * @param length Receives the extra length
+ * @return Boolean indicating if the length was complete
+ */
+static bool get_length(const uint8_t *in, size_t &pos, size_t size,
+                       size_t &length) {
+    uint8_t byte;
+    length = 0;
+    do {
+        if (pos >= size) {
+            return false;
+        }
+        byte = in[pos++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * Writes one sequence, literals followed by a match.  A token holds the
+ * literal count in its high nibble and the match length minus 4 in its low
+ * nibble, 15 in either meaning more length bytes follow.  The match offset
+ * is 16-bit little endian.  The last sequence has literals only.
+ * @param out Output buffer
+ * @param pos Offset to write at, advanced past the sequence
+ * @param out_size Bytes available in the output buffer
+ * @param literals The literal bytes
+ * @param num_literals Number of literal bytes
+ * @param offset Distance back to the match, 0 for the last sequence
+ * @param length Bytes of the match, at least 4 unless last
+ * @return Boolean indicating if the sequence fit the buffer
+ */
+static bool put_sequence(uint8_t *out, size_t &pos, size_t out_size,
+                         const uint8_t *literals, size_t num_literals,
+                         size_t offset, size_t length) {
+    size_t match = (offset != 0) ? length - 4 : 0;
+    if (pos >= out_size) {
+        return false;
+    }
+    out[pos++] = (uint8_t)((num_literals < 15 ? num_literals : 15) << 4 |
+                           (match < 15 ? match : 15));
+    if (num_literals >= 15 &&
+        !put_length(out, pos, out_size, num_literals - 15)) {
+        return false;
+    }
+    if (num_literals > out_size - pos) {
+        return false;
+    }
+    memcpy(out + pos, literals, num_literals);
+    pos += num_literals;
+    if (offset == 0) {
+        return true;
+    }
+
+    if (out_size - pos < 2) {
+        return false;
+    }
+    put_le(out + pos, (uint32_t) offset, 2);
+    pos += 2;
+    return match < 15 || put_length(out, pos, out_size, match - 15);
+}
+
+/**
+ * Compresses a buffer with a byte oriented LZ77 codec in the block layout
+ * of LZ4.  Matches of at least 4 bytes up to 64kB back are found through a
+ * hash table of the last position of every 4 byte sequence, which makes
+ * runs of zeroes and repeated sprites cost a few bytes.
+ * @param in Data to compress
+ * @param size Bytes of data
+ * @param out Buffer receiving the compressed data
+ * @param out_size Bytes available, LZ_MAX_COMPRESSED_SIZE(size) always fits
+ * @return Compressed bytes, or 0 if the buffer is too small
+ */
+size_t lz_compress(const uint8_t *in, size_t size, uint8_t *out,
+                   size_t out_size) {
+    uint32_t table[1 << LZ_HASH_BITS] = {};
+    size_t pos = 0, anchor = 0, written = 0;
+    while (size >= 4 && pos <= size - 4) {
+        uint32_t sequence = get_le(in + pos, 4);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        size_t candidate = table[hash];
+        table[hash] = (uint32_t) pos;
+        if (candidate >= pos || pos - candidate > 0xFFFF ||
+            get_le(in + candidate, 4) != sequence) {
+            pos++;
+            continue;
+        }
+
+        size_t length = 4;
+        while (pos + length < size &&
+               in[candidate + length] == in[pos + length]) {
+            length++;
+        }
+        if (!put_sequence(out, written, out_size, in + anchor, pos - anchor,
+                          pos - candidate, length)) {
+            return 0;
+        }
+        pos += length;
+        anchor = pos;
+    }
+    if (!put_sequence(out, written, out_size, in + anchor, size - anchor, 0,
+                      0)) {
+        return 0;
+    }
+    return written;
+}
+
+/**
+ * Decompresses a buffer written by lz_compress.  Every length and offset is
+ * checked, so corrupt data is rejected rather than read or written out of
+ * bounds.
+ * @param in Compressed data
+ * @param size Bytes of compressed data
+ * @param out Buffer receiving the data
+ * @param out_size Bytes available in the buffer
+ * @return Decompressed bytes, or 0 if the data is corrupt or does not fit
+ */
+size_t lz_decompress(const uint8_t *in, size_t size, uint8_t *out,
+                     size_t out_size) {
+    size_t pos = 0, written = 0;
+    while (pos < size) {
+        uint8_t token = in[pos++];
+        size_t num_literals = token >> 4, extra;
+        if (num_literals == 15) {
+            if (!get_length(in, pos, size, extra)) {
+                return 0;
+            }
+            num_literals += extra;
+        }
+        if (num_literals > size - pos || num_literals > out_size - written) {
+            return 0;
+        }
+        memcpy(out + written, in + pos, num_literals);
+        pos += num_literals;
+        written += num_literals;
+        if (pos == size) {
+            break;  // The last sequence has no match
+        }
+
+        if (size - pos < 2) {
+            return 0;
+        }
+        size_t offset = get_le(in + pos, 2);
+        pos += 2;
+        size_t length = (token & 0x0F) + 4;
+        if ((token & 0x0F) == 15) {
+            if (!get_length(in, pos, size, extra)) {
+                return 0;
+            }
+            length += extra;
+        }
+        if (offset == 0 || offset > written || length > out_size - written) {
+            return 0;
+        }
+
+        // Matches may overlap the bytes they produce, copy bytewise
+        const uint8_t *match = out + written - offset;
+        for (size_t i = 0; i < length; i++) {
+            out[written + i] = match[i];
+        }
+        written += length;
+    }
+    return written;
+}
+
+/**
+ * Packs a state written by serialize into the compact state file layout.
+ * The file holds a header (magic "C8SZ", 16-bit version, 16-bit header
+ * size, 32-bit body size, CRC-32 of the body) and a body of the palette,
+ * the serialize header and registers, the framebuffer as one bit per pixel
+ * and memory compressed with lz_compress, all little endian.
+ * @param state The SERIALIZED_STATE_SIZE bytes written by serialize
+ * @param palette Colors the framebuffer is shown in
+ * @param out Buffer receiving the file
+ * @param out_size Bytes available, STATE_FILE_MAX_SIZE always fits
+ * @return Bytes of the file, or 0 if the buffer is too small
+ */
+size_t pack_state(const uint8_t *state, const STATE_PALETTE &palette,
+                  uint8_t *out, size_t out_size) {
+    const size_t fixed = STATE_FILE_HEADER_SIZE + STATE_PALETTE_SIZE +
+                         STATE_HEADER_SIZE + STATE_REGS_USED + FRAME_BITS_SIZE;
+    if (out_size < fixed) {
+        return 0;
+    }
+    uint8_t *body = out + STATE_FILE_HEADER_SIZE;
+    put_le(body, palette.background, 4);
+    put_le(body + 4, palette.foreground, 4);
+    uint8_t *regs = body + STATE_PALETTE_SIZE;
+    memcpy(regs, state, STATE_HEADER_SIZE + STATE_REGS_USED);
+
+    // Pixels are 0 or 1, eight of them go into a byte, leftmost in bit 7
+    const uint8_t *mem = state + STATE_HEADER_SIZE + STATE_REGS_SIZE;
+    const uint8_t *frame = mem + MEM_SIZE;
+    uint8_t *bits = regs + STATE_HEADER_SIZE + STATE_REGS_USED;
+    for (int i = 0; i < FRAME_BITS_SIZE; i++) {
+        uint8_t byte = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            byte = (uint8_t)(byte << 1 | (frame[8 * i + bit] != 0));
+        }
+        bits[i] = byte;
+    }
+
+    size_t compressed =
+            lz_compress(mem, MEM_SIZE, out + fixed, out_size - fixed);
+    if (compressed == 0) {
+        return 0;
+    }
+    size_t body_size = fixed - STATE_FILE_HEADER_SIZE + compressed;
+    memcpy(out, "C8SZ", 4);
+    put_le(out + 4, STATE_FILE_VERSION, 2);
+    put_le(out + 6, STATE_FILE_HEADER_SIZE, 2);
+    put_le(out + 8, (uint32_t) body_size, 4);
+    put_le(out + 12, state_crc32(body, body_size), 4);
+    return STATE_FILE_HEADER_SIZE + body_size;
+}
+
+/**
+ * Unpacks a compact state file back into the layout serialize writes, so it
+ * can be handed to deserialize.
+ * @param data The file
+ * @param size Bytes of the file
+ * @param state Receives the SERIALIZED_STATE_SIZE bytes of the state
+ * @param palette Receives the colors the framebuffer was shown in
+ * @return Boolean indicating if the file is a compact state of this version
+ * with an intact checksum
+ */
+bool unpack_state(const uint8_t *data, size_t size, uint8_t *state,
+                  STATE_PALETTE &palette) {
+    const size_t fixed = STATE_PALETTE_SIZE + STATE_HEADER_SIZE +
+                         STATE_REGS_USED + FRAME_BITS_SIZE;
+    if (size < STATE_FILE_HEADER_SIZE + fixed ||
+        memcmp(data, "C8SZ", 4) != 0 ||
+        get_le(data + 4, 2) != STATE_FILE_VERSION ||
+        get_le(data + 6, 2) != STATE_FILE_HEADER_SIZE ||
+        get_le(data + 8, 4) != size - STATE_FILE_HEADER_SIZE) {
+        return false;
+    }
+    const uint8_t *body = data + STATE_FILE_HEADER_SIZE;
+    size_t body_size = size - STATE_FILE_HEADER_SIZE;
+    if (get_le(data + 12, 4) != state_crc32(body, body_size)) {
+        return false;
+    }
+
+    uint8_t *mem = state + STATE_HEADER_SIZE + STATE_REGS_SIZE;
+    if (lz_decompress(body + fixed, body_size - fixed, mem, MEM_SIZE) !=
+        MEM_SIZE) {
+        return false;
+    }
+    palette.background = get_le(body, 4);
+    palette.foreground = get_le(body + 4, 4);
+    const uint8_t *regs = body + STATE_PALETTE_SIZE;
+    memcpy(state, regs, STATE_HEADER_SIZE + STATE_REGS_USED);
+    memset(state + STATE_HEADER_SIZE + STATE_REGS_USED, 0,
+           STATE_REGS_SIZE - STATE_REGS_USED);
+
+    const uint8_t *bits = regs + STATE_HEADER_SIZE + STATE_REGS_USED;
+    uint8_t *frame = mem + MEM_SIZE;
+    for (int i = 0; i < FRAME_BITS_SIZE; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            frame[8 * i + bit] = (bits[i] >> (7 - bit)) & 1;
+        }
+    }
+    return true;
+}
+
+/**
+ * Converts a state file of the fixed layout the frontend wrote before states
+ * were serialized.  Those files store big endian registers, memory and every
+ * pixel as its 32-bit color, and neither keys nor the Cxkk generator, which
+ * are reset.
+ * @param data The file
+ * @param size Bytes of the file
+ * @param foreground Color lit pixels were drawn in, any other color is unlit
+ * @param state Receives the machine state
+ * @param palette Receives the foreground and the first other color found
+ * @return Boolean indicating if the file has the legacy layout
+ */
+bool convert_legacy_state(const uint8_t *data, size_t size,
+                          uint32_t foreground, MACHINE_STATE &state,
+                          STATE_PALETTE &palette) {
+    // SP is 0xFF while the stack is empty
+    if (size != LEGACY_STATE_SIZE ||
+        (data[2] >= STACK_SIZE && data[2] != 0xFF)) {
+        return false;
+    }
+
+    state = MACHINE_STATE{};
+    state.REGS.PC = (uint16_t)(data[0] << 8 | data[1]);
+    state.REGS.SP = data[2];
+    state.REGS.I = (uint16_t)(data[3] << 8 | data[4]);
+    state.REGS.ST = data[5];
+    state.REGS.DT = data[6];
+    memcpy(state.REGS.V, data + LEGACY_V_OFFSET, REG_SIZE);
+    for (int i = 0; i < STACK_SIZE; i++) {
+        const uint8_t *entry = data + LEGACY_STACK_OFFSET + 2 * i;
+        state.REGS.STACK[i] = (uint16_t)(entry[0] << 8 | entry[1]);
+    }
+    memcpy(state.MEM, data + LEGACY_MEM_OFFSET, MEM_SIZE);
+    state.REGS.RNG = rng_seed_state(DEFAULT_RNG_SEED);
+
+    palette.foreground = foreground;
+    palette.background = 0;
+    bool found_background = false;
+    const uint8_t *pixel = data + LEGACY_PIX_OFFSET;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++, pixel += 4) {
+            uint32_t color = (uint32_t) pixel[0] << 24 | pixel[1] << 16 |
+                             pixel[2] << 8 | pixel[3];
+            state.FRAME[y] = state.FRAME[y] << 1 | (color == foreground);
+            if (color != foreground && !found_background) {
+                palette.background = color;
+                found_background = true;
+            }
+        }
+    }
+    return true;
+}
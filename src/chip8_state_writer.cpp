@@ -0,0 +1,198 @@
+#include "chip8_state_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Writes a file so that a crash or power loss leaves either the old or the
+ * new contents.  The data goes into a temporary file next to the target,
+ * which is synced to storage and then renamed over it.  The directory is
+ * synced last, so the rename itself survives a crash.
+ * @param path File to write
+ * @param data Contents of the file
+ * @param size Bytes of contents
+ * @param error Set to the reason the write failed
+ * @return Boolean indicating if the file was written
+ */
+bool write_file_durably(const char *path, const uint8_t *data, size_t size,
+                        std::string &error) {
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE *file = fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        error = "unable to open " + temp_path + ": " + strerror(errno);
+        return false;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size && fflush(file) == 0 &&
+                   fsync(fileno(file)) == 0;
+    int write_errno = errno;
+    if (fclose(file) != 0 && written) {
+        written = false;
+        write_errno = errno;
+    }
+    if (!written) {
+        error = "unable to write " + temp_path + ": " + strerror(write_errno);
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    if (rename(temp_path.c_str(), path) != 0) {
+        error = "unable to replace " + std::string(path) + ": " +
+                strerror(errno);
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    // The new entry of the directory is only durable once it is synced
+    std::string dir_path = path;
+    size_t slash = dir_path.rfind('/');
+    if (slash == std::string::npos) {
+        dir_path = ".";
+    } else {
+        dir_path.resize(slash != 0 ? slash : 1);
+    }
+    int dir = open(dir_path.c_str(), O_RDONLY | O_DIRECTORY);
+    bool synced = dir >= 0 && fsync(dir) == 0;
+    int sync_errno = errno;
+    if (dir >= 0) {
+        close(dir);
+    }
+    if (!synced) {
+        error = "unable to sync " + dir_path + ": " + strerror(sync_errno);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Main constructor for STATE_WRITER, starts the worker thread.
+ */
+STATE_WRITER::STATE_WRITER()
+    : busy(false), stopping(false), next_ticket(1), coalesced(0) {
+    worker = std::thread(&STATE_WRITER::work, this);
+}
+
+/**
+ * Main destructor for STATE_WRITER.  Writes that are queued still reach
+ * storage before the worker exits.
+ */
+STATE_WRITER::~STATE_WRITER() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+/**
+ * Queues the contents of a file for the worker.  If a write to the same file
+ * is queued and not yet started, its contents are replaced instead, so only
+ * the newest save of a burst is written.  Never waits for storage.
+ * @param path File to write
+ * @param data Contents of the file, moved into the queue
+ * @return Ticket of the save, reported by poll once written
+ */
+uint64_t STATE_WRITER::save(const char *path, std::vector<uint8_t> data) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t ticket = next_ticket++;
+    for (STATE_WRITE &queued : queue) {
+        if (queued.path == path) {
+            queued.data.swap(data);
+            queued.ticket = ticket;
+            queued.saves++;
+            coalesced++;
+            return ticket;
+        }
+    }
+    queue.push_back(STATE_WRITE{ticket, 1, path, std::move(data)});
+    wake.notify_one();
+    return ticket;
+}
+
+/**
+ * Takes the outcome of the oldest finished write that was not polled yet.
+ * @param result Set to the outcome
+ * @return Boolean indicating if a write had finished
+ */
+bool STATE_WRITER::poll(SAVE_RESULT &result) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (results.empty()) {
+        return false;
+    }
+    result = std::move(results.front());
+    results.pop_front();
+    return true;
+}
+
+/**
+ * Copies the newest contents queued or being written for a file, which are
+ * what the file will hold once the worker is done with it.
+ * @param path File to look up
+ * @param data Set to the contents
+ * @return Boolean indicating if a write to the file is outstanding
+ */
+bool STATE_WRITER::get_pending(const char *path, std::vector<uint8_t> &data) {
+    std::lock_guard<std::mutex> guard(lock);
+    for (const STATE_WRITE &queued : queue) {
+        if (queued.path == path) {
+            data = queued.data;
+            return true;
+        }
+    }
+    if (busy && writing.path == path) {
+        data = writing.data;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Waits until the worker wrote everything queued so far.
+ */
+void STATE_WRITER::flush() {
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this] { return queue.empty() && !busy; });
+}
+
+/**
+ * Getter function for the number of coalesced saves.
+ * @return Saves whose contents were replaced by a newer save before written
+ */
+uint64_t STATE_WRITER::get_coalesced() {
+    std::lock_guard<std::mutex> guard(lock);
+    return coalesced;
+}
+
+/**
+ * Takes queued writes in order and writes them with the lock released, so
+ * saves keep being queued while storage is slow.
+ */
+void STATE_WRITER::work() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this] { return !queue.empty() || stopping; });
+        if (queue.empty()) {
+            return;
+        }
+        writing = std::move(queue.front());
+        queue.pop_front();
+        busy = true;
+
+        // The emulation thread only reads writing while busy is set
+        guard.unlock();
+        SAVE_RESULT result{writing.ticket, writing.saves, writing.path, false,
+                           std::string()};
+        result.success =
+                write_file_durably(writing.path.c_str(), writing.data.data(),
+                                   writing.data.size(), result.error);
+        guard.lock();
+
+        results.push_back(std::move(result));
+        busy = false;
+        idle.notify_all();
+    }
+}
@@ -1,5 +1,7 @@
 #include "graphics.h"
 
+#include <string.h>
+
 /**
  * Checks the status code returned from initializing graphics in SDL.
  * @param init_code Status code returned from SDL
@@ -26,6 +28,37 @@ bool VideoInitChecker::check_sdl_create_window_code(SDL_Window *window_ptr) {
     return true;
 };
 
+/**
+ * Checks the SDL_Renderer pointer returned from creating a renderer in SDL.
+ * @param renderer_ptr Pointer to SDL_Renderer object used by the texture
+ * backend.
+ * @return Boolean specifying if creation was successful or not.
+ */
+bool VideoInitChecker::check_sdl_create_renderer_code(
+        SDL_Renderer *renderer_ptr) {
+    if (renderer_ptr == nullptr) {
+        printf("Renderer could not be created! SDL_Error: %s\n",
+               SDL_GetError());
+        return false;
+    }
+    return true;
+};
+
+/**
+ * Checks the SDL_Texture pointer returned from creating a texture in SDL.
+ * @param texture_ptr Pointer to SDL_Texture object holding the CHIP 8 screen.
+ * @return Boolean specifying if creation was successful or not.
+ */
+bool VideoInitChecker::check_sdl_create_texture_code(
+        SDL_Texture *texture_ptr) {
+    if (texture_ptr == nullptr) {
+        printf("Texture could not be created! SDL_Error: %s\n",
+               SDL_GetError());
+        return false;
+    }
+    return true;
+};
+
 /**
  * Main constructor for VIDEO object.  Sets the pixel width/height depending on
  * the size of the window
@@ -36,8 +69,20 @@ VIDEO::VIDEO() {
     pixel_height = WINDOW_HEIGHT / SCREEN_HEIGHT;
     gWidth = WINDOW_WIDTH;
     gHeight = WINDOW_HEIGHT;
-    background_color = BLACK;
-    foreground_color = WHITE;
+    palette[PALETTE_BACKGROUND] = BLACK;
+    palette[PALETTE_FOREGROUND] = WHITE;
+    color_rng.seed(time(nullptr));
+
+    // Nothing is created until init
+    gWindow = nullptr;
+    gSurface = nullptr;
+    gBackground = nullptr;
+    gRenderer = nullptr;
+    gTexture = nullptr;
+    vid_mem = nullptr;
+
+    // The first show updates the whole window
+    mark_all_dirty();
 }
 
 /**
@@ -49,10 +94,12 @@ VIDEO::~VIDEO() { close(); }
 /**
  * Initializes SDL library and creates window/surface objects for drawing
  * graphics.
+ * @param backend How the screen is presented, the texture backend draws no
+ * surface and keeps only the pixel map
  * @return Boolean value indicating whether all components were initialized
  * properly or not.
  */
-bool VIDEO::init() {
+bool VIDEO::init(VIDEO_BACKEND backend) {
     // Initialization flag
     bool success = true;
 
@@ -70,15 +117,43 @@ bool VIDEO::init() {
         if (success) {
             SDL_SetWindowMinimumSize(gWindow, SCREEN_WIDTH * 4,
                                      SCREEN_HEIGHT * 4);
-            // Get window surface
-            gSurface = SDL_GetWindowSurface(gWindow);
-            vid_mem = (uint32_t *) gSurface->pixels;
+            if (backend == VIDEO_TEXTURE) {
+                // A window with a renderer must not use its surface
+                success = init_renderer();
+            } else {
+                // Get window surface
+                gSurface = SDL_GetWindowSurface(gWindow);
+                vid_mem = (uint32_t *) gSurface->pixels;
+            }
             clear();
         }
     }
 
     return success;
 }
+
+/**
+ * Creates the renderer and the streaming texture of the texture backend.  An
+ * accelerated renderer is preferred, the software renderer is used on hosts
+ * without one.
+ * @return Boolean indicating if the renderer and texture were created
+ */
+bool VIDEO::init_renderer() {
+    gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
+    if (gRenderer == nullptr) {
+        gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_SOFTWARE);
+    }
+    if (!video_init_checker.check_sdl_create_renderer_code(gRenderer)) {
+        return false;
+    }
+
+    // Palette colors are 0xRRGGBB.  RGB888 has no alpha channel, so SDL
+    // copies the texture without blending whatever the top byte holds
+    gTexture = SDL_CreateTexture(gRenderer, SDL_PIXELFORMAT_RGB888,
+                                 SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH,
+                                 SCREEN_HEIGHT);
+    return video_init_checker.check_sdl_create_texture_code(gTexture);
+}
 // LCOV_EXCL_STOP
 
 /**
@@ -112,8 +187,14 @@ void VIDEO::handle_event(SDL_Event event) {
             case SDL_WINDOWEVENT_MINIMIZED:
                 while (!wait_for_focus()) {
                 }
+                mark_all_dirty();
                 show();
                 break;
+
+            // Contents of the window were lost, e.g. while covered
+            case SDL_WINDOWEVENT_EXPOSED:
+                mark_all_dirty();
+                break;
         }
     }
 }
@@ -125,11 +206,18 @@ void VIDEO::handle_event(SDL_Event event) {
  * resizing.
  */
 void VIDEO::switch_surface() {
+    // The renderer scales the texture to the new size by itself
+    if (gRenderer != nullptr) {
+        mark_all_dirty();
+        return;
+    }
+
     gSurface = SDL_GetWindowSurface(gWindow);  // Grab new window surface
     if (gSurface != nullptr) {
         vid_mem =
                 (uint32_t *) gSurface->pixels;  // Get new video memory pointer
         draw_pix_map();                         // Redraw the surface
+        mark_all_dirty();  // The new surface starts undefined
     }
 }
 // LCOV_EXCL_STOP
@@ -149,14 +237,38 @@ bool VIDEO::wait_for_focus() {
 // LCOV_EXCL_STOP
 
 /**
- * Function for redrawing the surface using pixel map
+ * Function for redrawing the surface using pixel map, scaled with
+ * scale_pixels.  Rows of the surface are gSurface->pitch bytes apart, which
+ * SDL may pad beyond the width.  Without a surface the next show only
+ * presents it again.
  */
 void VIDEO::draw_pix_map() {
+    if (vid_mem != nullptr) {
+        scale_pixels(pix_map, palette, vid_mem, gWidth, gHeight,
+                     gSurface->pitch, &scale_pool);
+    }
+    mark_all_dirty();
+}
+
+/**
+ * Function for updating the pixel map from a CHIP 8 framebuffer, only the
+ * pixels whose color changed are redrawn on the surface.  This is where
+ * pixels get their colors, the core only keeps bits.
+ * @param frame Rows of the CHIP 8 core's framebuffer, see frame_pixel
+ */
+void VIDEO::draw_frame(const uint64_t *frame) {
+    mtx.lock();
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
-            draw_pixel(x, y, pix_map[y][x]);
+            uint8_t index = frame_pixel(frame, x, y) ? PALETTE_FOREGROUND
+                                                     : PALETTE_BACKGROUND;
+            if (pix_map[y][x] != index) {
+                draw_pixel(x, y, palette[index]);
+                pix_map[y][x] = index;
+            }
         }
     }
+    mtx.unlock();
 }
 
 /**
@@ -187,19 +299,26 @@ int VIDEO::get_window_height() { return gHeight; }
  * Getter function for background color code.
  * @return Unsigned 32-bit integer representing color code.
  */
-uint32_t VIDEO::get_background_color() { return background_color; }
+uint32_t VIDEO::get_background_color() { return palette[PALETTE_BACKGROUND]; }
 
 /**
  * Getter function for foreground color code.
  * @return Unsigned 32-bit integer representing color code.
  */
-uint32_t VIDEO::get_foreground_color() { return foreground_color; }
+uint32_t VIDEO::get_foreground_color() { return palette[PALETTE_FOREGROUND]; }
 
 /**
  * Getter function for pixel map used to represent CHIP 8  screen internally.
- * @return Pointer to array of pixels.
+ * @return Pointer to array of pixels, each a PALETTE_BACKGROUND or
+ * PALETTE_FOREGROUND index.
+ */
+uint8_t (*VIDEO::get_pix_map())[SCREEN_WIDTH] { return pix_map; }
+
+/**
+ * Getter function for the colors the pixel map is shown in.
+ * @return Color of each palette index.
  */
-uint32_t (*VIDEO::get_pix_map())[SCREEN_WIDTH] { return pix_map; }
+const uint32_t *VIDEO::get_palette() { return palette; }
 
 /**
  * Getter function for video memory used by SDL window to display graphics.
@@ -211,38 +330,25 @@ uint32_t *VIDEO::get_vid_mem() { return vid_mem; }
  * Function for randomizing the color scheme of the Chip-8.
  */
 void VIDEO::rand_color_scheme() {
-    mtx.lock();
-    srand(time(nullptr));
-
     // Randomly select 32-bit values for color
-    uint32_t newforeground_color = rand() % INTMAX;
-    uint32_t newbackground_color = rand() % INTMAX;
-
-    // Iterate through each pixel and update with new color
-    uint32_t *pixel;
-    for (int i = 0; i < gWidth * gHeight; i++) {
-        pixel = (vid_mem + i);
-        if (*pixel == foreground_color) {
-            *pixel = newforeground_color;
-        } else {
-            *pixel = newbackground_color;
-        }
-    }
-
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            if (pix_map[y][x] == foreground_color) {
-                pix_map[y][x] = newforeground_color;
-            } else if (pix_map[y][x] == background_color) {
-                pix_map[y][x] = newbackground_color;
-            }
-        }
-    }
-
-    // Update the colors
-    foreground_color = newforeground_color;
-    background_color = newbackground_color;
+    uint32_t newforeground_color = color_rng() % INTMAX;
+    uint32_t newbackground_color = color_rng() % INTMAX;
+    set_color_scheme(newforeground_color, newbackground_color);
+}
 
+/**
+ * Function for changing the colors the Chip-8 display is drawn in.  The pixel
+ * map holds palette indices, so only the palette changes and the surface is
+ * redrawn from it once, the texture backend just presents it again.
+ * @param newforeground_color Color of lit pixels
+ * @param newbackground_color Color of unlit pixels
+ */
+void VIDEO::set_color_scheme(uint32_t newforeground_color,
+                             uint32_t newbackground_color) {
+    mtx.lock();
+    palette[PALETTE_FOREGROUND] = newforeground_color;
+    palette[PALETTE_BACKGROUND] = newbackground_color;
+    draw_pix_map();
     mtx.unlock();
 }
 
@@ -250,6 +356,8 @@ void VIDEO::rand_color_scheme() {
  * Function for drawing a pixel at a given (x, y) coordinate pair for the
  * CHIP8's display.  Because the SDL window is not a 1:1 pixel mapping, we need
  * to scale the amount of pixels colored in the window based on the window size.
+ * Without a surface, e.g. with the texture backend, the pixel is only marked
+ * for the next show.
  */
 void VIDEO::draw_pixel(uint8_t x, uint8_t y, uint32_t rgb) {
     // Do not draw pixels out of screen
@@ -257,13 +365,19 @@ void VIDEO::draw_pixel(uint8_t x, uint8_t y, uint32_t rgb) {
         return;
     }
 
-    // Get pointer to first pixel of surface
-    uint32_t *pixmem = vid_mem + x * pixel_width + y * pixel_height * gWidth;
+    mark_dirty(x, y);
+    if (vid_mem == nullptr) {
+        return;
+    }
+
+    // Get pointer to first pixel of surface, rows may be padded
+    int stride = gSurface->pitch / sizeof(uint32_t);
+    uint32_t *pixmem = vid_mem + x * pixel_width + y * pixel_height * stride;
 
     // Iterate through pixels that make up larger Chip-8 pixel and color
     for (int screen_y = 0; screen_y < (int) pixel_height; screen_y++) {
         for (int screen_x = 0; screen_x < (int) pixel_width; screen_x++) {
-            *(pixmem + screen_x + screen_y * gWidth) = rgb;
+            *(pixmem + screen_x + screen_y * stride) = rgb;
         }
     }
 }
@@ -279,33 +393,122 @@ bool VIDEO::xor_color(uint8_t x, uint8_t y) {
         return false;
     }
     mtx.lock();
-    // Grab the appropriate pixel color from the pixel map
-    uint32_t pix_color = pix_map[y][x];
-
-    // Flip foreground/background color
-    bool ret = true;
-    if (pix_color == background_color) {
-        draw_pixel(x, y, foreground_color);
-        pix_map[y][x] = foreground_color;
-        ret = false;  // Information not deleted
-    } else if (pix_color == foreground_color) {
-        draw_pixel(x, y, background_color);
-        pix_map[y][x] = background_color;
-        ret = true;  // Information deleted
-    }
+    // Flip the palette index, a lit pixel means information was deleted
+    uint8_t index = pix_map[y][x];
+    pix_map[y][x] = index ^ PALETTE_FOREGROUND;
+    draw_pixel(x, y, palette[pix_map[y][x]]);
+    bool ret = index == PALETTE_FOREGROUND;
 
     mtx.unlock();
     return ret;
 }
 
+/**
+ * Marks a CHIP 8 pixel as drawn, so the next show updates its area of the
+ * window.  Each row keeps the span of columns drawn since the last show.
+ * @param x CHIP 8 x coordinate of the pixel
+ * @param y CHIP 8 y coordinate of the pixel
+ */
+void VIDEO::mark_dirty(uint8_t x, uint8_t y) {
+    if (x >= SCREEN_WIDTH || y >= SCREEN_HEIGHT) {
+        return;
+    }
+    if (x < dirty_left[y]) {
+        dirty_left[y] = x;
+    }
+    if (x > dirty_right[y]) {
+        dirty_right[y] = x;
+    }
+}
+
+/**
+ * Marks the whole window, including the border the CHIP 8 pixels do not
+ * cover, to be updated by the next show.
+ */
+void VIDEO::mark_all_dirty() {
+    clear_dirty();
+    dirty_all = true;
+}
+
+/**
+ * Forgets what was drawn, after it was shown.
+ */
+void VIDEO::clear_dirty() {
+    dirty_all = false;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        dirty_left[y] = SCREEN_WIDTH;
+        dirty_right[y] = 0;
+    }
+}
+
+/**
+ * Gathers the areas of the window holding pixels drawn since the last show.
+ * Consecutive rows with the same span of columns share one rectangle.
+ * @param rects Receives up to SCREEN_HEIGHT rectangles in window pixels
+ * @return Number of rectangles
+ */
+int VIDEO::get_dirty_rects(SDL_Rect *rects) {
+    int count = 0;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        if (dirty_right[y] < dirty_left[y]) {
+            continue;
+        }
+        int columns = dirty_right[y] - dirty_left[y] + 1;
+        SDL_Rect rect = {(int)(dirty_left[y] * pixel_width),
+                         (int)(y * pixel_height),
+                         (int)(columns * pixel_width), (int) pixel_height};
+        if (count != 0 && rects[count - 1].x == rect.x &&
+            rects[count - 1].w == rect.w &&
+            rects[count - 1].y + rects[count - 1].h == rect.y) {
+            rects[count - 1].h += rect.h;
+        } else {
+            rects[count++] = rect;
+        }
+    }
+    return count;
+}
+
 // LCOV_EXCL_START
 /**
  * Function for updating the display window.  Must be called at 60Hz to emulate
- * CHIP8 display.
+ * CHIP8 display.  Only the areas drawn since the last call are pushed to the
+ * window, nothing is when the frame did not change.
  */
 void VIDEO::show() {
-    // Update the surface
-    SDL_UpdateWindowSurface(gWindow);
+    if (gRenderer != nullptr) {
+        show_texture();
+    } else if (dirty_all) {
+        SDL_UpdateWindowSurface(gWindow);
+    } else {
+        SDL_Rect rects[SCREEN_HEIGHT];
+        int count = get_dirty_rects(rects);
+        if (count != 0) {
+            SDL_UpdateWindowSurfaceRects(gWindow, rects, count);
+        }
+    }
+
+    // Start collecting the next frame
+    clear_dirty();
+}
+
+/**
+ * Function for presenting the pixel map with the texture backend.  The
+ * SCREEN_WIDTH x SCREEN_HEIGHT pixel map is colored by the palette, uploaded
+ * and stretched over the window by the renderer, so the cost does not grow
+ * with the window.  Frames without changes are not presented again.
+ */
+void VIDEO::show_texture() {
+    SDL_Rect rects[SCREEN_HEIGHT];
+    if (!dirty_all && get_dirty_rects(rects) == 0) {
+        return;
+    }
+    uint32_t pixels[SCREEN_HEIGHT][SCREEN_WIDTH];
+    scale_pixels(pix_map, palette, &pixels[0][0], SCREEN_WIDTH,
+                 SCREEN_HEIGHT, sizeof(pixels[0]));
+    SDL_UpdateTexture(gTexture, nullptr, pixels, sizeof(pixels[0]));
+    SDL_RenderClear(gRenderer);
+    SDL_RenderCopy(gRenderer, gTexture, nullptr, nullptr);
+    SDL_RenderPresent(gRenderer);
 }
 // LCOV_EXCL_STOP
 
@@ -313,28 +516,38 @@ void VIDEO::show() {
  * Helper function for clearing the game display.
  */
 void VIDEO::clear() {
-    // Clear the display
-    for (int y = 0; y < WINDOW_HEIGHT; y++) {
-        for (int x = 0; x < WINDOW_WIDTH; x++) {
-            *(vid_mem + y * WINDOW_WIDTH + x) = background_color;
+    // Clear the display, at its current size
+    for (int y = 0; vid_mem != nullptr && y < gHeight; y++) {
+        uint32_t *row = vid_mem + y * (gSurface->pitch / sizeof(uint32_t));
+        for (int x = 0; x < gWidth; x++) {
+            row[x] = palette[PALETTE_BACKGROUND];
         }
     }
 
     // Clear the pixel map
-    for (int y = 0; y < SCREEN_HEIGHT; y++) {
-        for (int x = 0; x < SCREEN_WIDTH; x++) {
-            pix_map[y][x] = background_color;
-        }
-    }
+    memset(pix_map, PALETTE_BACKGROUND, sizeof(pix_map));
+    mark_all_dirty();
 }
 
 /**
  * Helper function to terminate SDL window and free resources.
  */
 void VIDEO::close() {
-    // Destroy window
-    SDL_DestroyWindow(gWindow);
-    gWindow = nullptr;
+    // Destroy the texture backend before its window
+    if (gTexture != nullptr) {
+        SDL_DestroyTexture(gTexture);
+        gTexture = nullptr;
+    }
+    if (gRenderer != nullptr) {
+        SDL_DestroyRenderer(gRenderer);
+        gRenderer = nullptr;
+    }
+
+    // Destroy window, closing twice is harmless
+    if (gWindow != nullptr) {
+        SDL_DestroyWindow(gWindow);
+        gWindow = nullptr;
+    }
 
     // Quit SDL subsystems
     SDL_Quit();
@@ -348,5 +561,9 @@ void VIDEO::close() {
  * @return Unsigned 32-bit integer color code for SDL
  */
 uint32_t VIDEO::get_color(uint8_t r, uint8_t g, uint8_t b) {
+    // The texture backend has no surface, its texture is 0xRRGGBB
+    if (gSurface == nullptr) {
+        return (uint32_t) r << 16 | (uint32_t) g << 8 | b;
+    }
     return SDL_MapRGB(gSurface->format, r, g, b);
 }
\ No newline at end of file
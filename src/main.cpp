@@ -1,10 +1,28 @@
 #include "chip8.h"
 
+#include <string.h>
 #include <unistd.h>
 
-int main(int /*argc*/, char *argv[]) {
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: chip8 <rom> [instructions per frame] "
+                     "[movie to record]\n"
+                  << std::endl;
+        return -1;
+    }
+
     CHIP8 myChip8 = CHIP8();
 
+    // Optional emulation speed
+    if (argc > 2) {
+        myChip8.set_instructions_per_frame(strtoul(argv[2], nullptr, 10));
+    }
+
+    // Optional input recording
+    if (argc > 3) {
+        myChip8.record_movie(argv[3]);
+    }
+
     if (!myChip8.load_program(argv[1])) {
         std::cout << "Unable to load program.\n" << std::endl;
         return -1;
@@ -14,7 +32,14 @@ int main(int /*argc*/, char *argv[]) {
     // 	std::cout << "Unable to load config.txt.\n" << std::endl;
     // }
 
-    if (!myChip8.init_video()) {
+    // CHIP8_VIDEO=texture presents through an SDL renderer
+    const char *video = getenv("CHIP8_VIDEO");
+    VIDEO_BACKEND backend = VIDEO_SURFACE;
+    if (video != nullptr && strcmp(video, "texture") == 0) {
+        backend = VIDEO_TEXTURE;
+    }
+
+    if (!myChip8.init_video(backend)) {
         std::cout << "Unable to initialize chip video.\n" << std::endl;
         return -1;
     }
@@ -0,0 +1,100 @@
+#include "aot_test_aot.h"
+#include "aot_test_direct.h"
+#include "aot_test_opcode.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+/**
+ * Checks that two cores are in the same machine state.
+ */
+static void expect_same_state(CHIP8CORE &a, CHIP8CORE &b) {
+    ASSERT_EQ(a.get_pc(), b.get_pc());
+    ASSERT_EQ(a.get_sp(), b.get_sp());
+    ASSERT_EQ(a.get_index_reg(), b.get_index_reg());
+    ASSERT_EQ(a.get_delay_timer(), b.get_delay_timer());
+    ASSERT_EQ(a.get_sound_timer(), b.get_sound_timer());
+    for (int i = 0; i < STACK_SIZE; i++) {
+        ASSERT_EQ(a.get_stack()[i], b.get_stack()[i]) << "STACK " << i;
+    }
+    for (int i = 0; i < REG_SIZE; i++) {
+        ASSERT_EQ(a.get_reg_file()[i], b.get_reg_file()[i]) << "V" << i;
+    }
+    for (int i = 0; i < MEM_SIZE; i++) {
+        ASSERT_EQ(a.get_mem()[i], b.get_mem()[i]) << "MEM " << i;
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ASSERT_EQ(a.get_frame_buffer()[y], b.get_frame_buffer()[y])
+                << "row " << y;
+    }
+}
+
+/**
+ * Runs a recompiled rom next to the interpreter in uneven batches, which stop
+ * the recompiled code in the middle of blocks.
+ */
+static void expect_matches_interpreter(const AOT_MODULE &module) {
+    CHIP8CORE reference;
+    CHIP8AOT aot(module);
+    ASSERT_EQ(reference.load_program_data(module.rom, module.rom_size), true);
+    reference.set_key_status(0x5, true);
+    aot.set_key_status(0x5, true);
+
+    std::mt19937 gen(5);
+    for (int batch = 0; batch < 500; batch++) {
+        uint32_t steps = 1 + gen() % 60;
+        ASSERT_EQ(reference.run(steps), steps);
+        ASSERT_EQ(aot.run(steps), steps);
+        expect_same_state(reference, aot);
+        if (::testing::Test::HasFatalFailure()) {
+            FAIL() << module.name << " batch " << batch;
+        }
+        reference.tick_timers();
+        aot.tick_timers();
+    }
+
+    // Idle loops are fast-forwarded as on the interpreter, from their first
+    // iteration when a block ends at the loop
+    EXPECT_EQ(aot.get_idle_stats().fast_forwards != 0,
+              reference.get_idle_stats().fast_forwards != 0)
+            << module.name;
+    EXPECT_GE(aot.get_idle_stats().skipped_steps,
+              reference.get_idle_stats().skipped_steps)
+            << module.name;
+}
+
+TEST(CHIP8AotTests, TestModule) {
+    EXPECT_STREQ(AOT_test_opcode.name, "test_opcode");
+    CHIP8AOT aot(AOT_test_opcode);
+    for (int i = 0; i < AOT_test_opcode.rom_size; i++) {
+        ASSERT_EQ(aot.get_mem()[PC_START + i], AOT_test_opcode.rom[i]);
+    }
+    EXPECT_EQ(aot.get_pc(), PC_START);
+}
+
+TEST(CHIP8AotTests, TestMatchesInterpreter) {
+    expect_matches_interpreter(AOT_test_opcode);
+    expect_matches_interpreter(AOT_test_aot);
+
+    // Every jump of this rom is direct, it is generated without dispatch.
+    // It waits on the delay timer after every sprite, which is skipped
+    expect_matches_interpreter(AOT_test_direct);
+    CHIP8AOT aot(AOT_test_direct);
+    EXPECT_EQ(aot.run(1000), 1000u);
+    EXPECT_EQ(aot.get_idle_stats().fast_forwards, 1u);
+}
+
+TEST(CHIP8AotTests, TestFallback) {
+    CHIP8AOT aot(AOT_test_aot);
+    aot.set_key_status(0x5, true);
+
+    // The rom patches the subroutine at 0x270 and jumps through Bnnn, both
+    // run on the interpreter while the rest stays recompiled
+    aot.run(1000);
+    AOT_STATS stats = aot.get_aot_stats();
+    EXPECT_GT(stats.compiled_steps, stats.interpreted_steps);
+    EXPECT_GT(stats.interpreted_steps, 0u);
+    EXPECT_EQ(stats.compiled_steps + stats.interpreted_steps, 1000u);
+    EXPECT_EQ(aot.get_mem()[0x271], 0x03);
+}
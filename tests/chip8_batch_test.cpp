@@ -0,0 +1,114 @@
+#include "chip8_batch.h"
+
+#include <thread>
+
+#include "gtest/gtest.h"
+
+TEST(CHIP8BatchTests, TestPoolRunsEveryTask) {
+    WORK_STEALING_POOL pool(4);
+    EXPECT_EQ(pool.get_threads(), 4u);
+
+    // Every fourth task is slow, so the other workers run dry and steal
+    std::vector<std::atomic<int>> runs(64);
+    pool.run(runs.size(), [&](size_t i) {
+        if (i % 4 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        runs[i]++;
+    });
+    for (size_t i = 0; i < runs.size(); i++) {
+        EXPECT_EQ(runs[i], 1) << i;
+    }
+    EXPECT_GT(pool.get_steals(), 0u);
+
+    // The pool can be reused
+    std::atomic<int> total(0);
+    pool.run(10, [&](size_t i) { total += i; });
+    EXPECT_EQ(total, 45);
+
+    // Every run is served by the same threads, a new thread would start with
+    // its flag cleared
+    std::atomic<int> threads_seen(0);
+    for (int run = 0; run < 20; run++) {
+        pool.run(8, [&](size_t) {
+            thread_local bool seen = false;
+            if (!seen) {
+                seen = true;
+                threads_seen++;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        });
+    }
+    EXPECT_LE(threads_seen, 4);
+    EXPECT_GE(threads_seen, 1);
+}
+
+TEST(CHIP8BatchTests, TestLoadInputScript) {
+    std::vector<INPUT_EVENT> events;
+    ASSERT_EQ(load_input_script("test_input.txt", events), true);
+    ASSERT_EQ(events.size(), 3u);
+
+    // Events are sorted by frame
+    EXPECT_EQ(events[0].frame, 0u);
+    EXPECT_EQ(events[0].key, 0x1);
+    EXPECT_EQ(events[0].pressed, true);
+    EXPECT_EQ(events[1].frame, 10u);
+    EXPECT_EQ(events[1].key, 0xA);
+    EXPECT_EQ(events[2].frame, 30u);
+    EXPECT_EQ(events[2].pressed, false);
+
+    EXPECT_EQ(load_input_script("missing.txt", events), false);
+}
+
+TEST(CHIP8BatchTests, TestRunJobInput) {
+    // F00A - LD V0, K, F029 - LD F, V0, D005 - DRW V0, V0, 5, 1206 - JP 0x206
+    std::vector<uint8_t> rom = {0xF0, 0x0A, 0xF0, 0x29,
+                                0xD0, 0x05, 0x12, 0x06};
+    BATCH_OPTIONS options = BATCH_OPTIONS{100, 10};
+
+    BATCH_JOB idle = BATCH_JOB{"wait", 0, "", {}};
+    BATCH_RESULT waited = run_job(idle, rom.data(), rom.size(), options);
+    EXPECT_EQ(waited.loaded, true);
+    EXPECT_EQ(waited.halted, false);
+    EXPECT_EQ(waited.frames, 100u);
+    EXPECT_EQ(waited.steps, 1000u);
+
+    // Pressing 3 at frame 5 draws the 3 glyph, then the rom halts
+    BATCH_JOB pressed = BATCH_JOB{"wait", 0, "", {{5, 0x3, true}}};
+    BATCH_RESULT drawn = run_job(pressed, rom.data(), rom.size(), options);
+    EXPECT_EQ(drawn.halted, true);
+    EXPECT_EQ(drawn.frames, 6u);
+    EXPECT_NE(drawn.frame_hash, waited.frame_hash);
+
+    CHIP8CORE core;
+    core.load_program_data(rom.data(), rom.size());
+    core.set_key_status(0x3, true);
+    core.run(3);
+    EXPECT_EQ(drawn.frame_hash, hash_frame_buffer(core.get_frame_buffer()));
+}
+
+TEST(CHIP8BatchTests, TestRunBatch) {
+    std::vector<BATCH_JOB> jobs;
+    for (uint64_t seed = 0; seed < 8; seed++) {
+        jobs.push_back(BATCH_JOB{"test_opcode.ch8", seed, "", {}});
+    }
+    jobs.push_back(BATCH_JOB{"missing.ch8", 0, "", {}});
+    BATCH_OPTIONS options = BATCH_OPTIONS{600, 100};
+
+    // Results do not depend on how the jobs were spread over threads
+    WORK_STEALING_POOL serial(1), parallel(4);
+    std::vector<BATCH_RESULT> a = run_batch(jobs, options, serial);
+    std::vector<BATCH_RESULT> b = run_batch(jobs, options, parallel);
+    ASSERT_EQ(a.size(), jobs.size());
+    ASSERT_EQ(b.size(), jobs.size());
+    for (size_t i = 0; i + 1 < jobs.size(); i++) {
+        EXPECT_EQ(a[i].loaded, true);
+        EXPECT_EQ(a[i].halted, true);
+        EXPECT_LT(a[i].frames, 600u);
+        EXPECT_EQ(a[i].steps, b[i].steps);
+        EXPECT_EQ(a[i].frames, b[i].frames);
+        EXPECT_EQ(a[i].frame_hash, b[i].frame_hash);
+    }
+    EXPECT_EQ(a.back().loaded, false);
+    EXPECT_EQ(b.back().loaded, false);
+}
@@ -0,0 +1,104 @@
+#include "chip8_bundle.h"
+
+#include <fstream>
+#include <iterator>
+
+#include "chip8_batch.h"
+#include "gtest/gtest.h"
+
+/**
+ * Builds a bundle of three ROMs, two of which have the same contents.
+ */
+static std::vector<BUNDLE_ROM> bundle_roms() {
+    std::ifstream file("test_opcode.ch8", std::ios::binary);
+    std::vector<uint8_t> opcode((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+    std::vector<uint8_t> loop = {0x12, 0x00};
+    return {BUNDLE_ROM{"tests/opcode.ch8", 0, opcode},
+            BUNDLE_ROM{"loop.ch8", 2, loop},
+            BUNDLE_ROM{"copy of opcode.ch8", 0, opcode}};
+}
+
+TEST(CHIP8BundleTests, TestWriteAndFind) {
+    std::vector<BUNDLE_ROM> roms = bundle_roms();
+    ASSERT_EQ(write_bundle("test_bundle.pak", roms), true);
+
+    ROM_BUNDLE bundle;
+    ASSERT_EQ(bundle.open("test_bundle.pak"), true);
+    const std::vector<BUNDLE_ENTRY> &entries = bundle.get_entries();
+    ASSERT_EQ(entries.size(), 3u);
+    EXPECT_EQ(entries[0].name, "copy of opcode.ch8");
+    EXPECT_EQ(entries[1].name, "loop.ch8");
+    EXPECT_EQ(entries[2].name, "tests/opcode.ch8");
+
+    // Every ROM is found by name, equal images are stored once
+    for (const BUNDLE_ROM &rom : roms) {
+        const BUNDLE_ENTRY *entry = bundle.find(rom.name.c_str());
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->quirks, rom.quirks);
+        EXPECT_EQ(entry->hash, hash_bytes(rom.data.data(), rom.data.size()));
+        const uint8_t *data = bundle.get_data(*entry);
+        EXPECT_EQ(std::vector<uint8_t>(data, data + entry->size), rom.data);
+    }
+    EXPECT_EQ(entries[0].offset, entries[2].offset);
+    EXPECT_EQ(bundle.find("missing.ch8"), nullptr);
+    EXPECT_EQ(bundle.find("loop"), nullptr);
+
+    // Files that are not bundles, or are cut short, are rejected
+    EXPECT_EQ(bundle.open("test_opcode.ch8"), false);
+    EXPECT_EQ(bundle.get_entries().size(), 0u);
+    std::ifstream file("test_bundle.pak", std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                              std::istreambuf_iterator<char>());
+    data.resize(data.size() - 1);
+    std::ofstream("test_cut.pak", std::ios::binary)
+            .write((const char *) data.data(), data.size());
+    EXPECT_EQ(bundle.open("test_cut.pak"), false);
+    remove("test_cut.pak");
+    remove("test_bundle.pak");
+}
+
+TEST(CHIP8BundleTests, TestBundleReferences) {
+    std::vector<BUNDLE_ROM> roms = bundle_roms();
+    ASSERT_EQ(write_bundle("test_refs.pak", roms), true);
+
+    // Cores load "bundle.pak#name" like a file
+    CHIP8CORE core;
+    ASSERT_EQ(core.load_program("test_refs.pak#loop.ch8"), true);
+    EXPECT_EQ(core.get_mem()[PC_START], 0x12);
+    EXPECT_EQ(core.get_mem()[PC_START + 2], 0x00);
+    EXPECT_EQ(core.load_program("test_refs.pak#missing.ch8"), false);
+    EXPECT_EQ(core.load_program("missing.pak#loop.ch8"), false);
+
+    // The cache opens the bundle once and shares equal images
+    ROM_CACHE cache;
+    std::shared_ptr<const MAPPED_ROM> opcode =
+            cache.load("test_refs.pak#tests/opcode.ch8");
+    std::shared_ptr<const MAPPED_ROM> copy =
+            cache.load("test_refs.pak#copy of opcode.ch8");
+    std::shared_ptr<const MAPPED_ROM> loop =
+            cache.load("test_refs.pak#loop.ch8");
+    ASSERT_NE(opcode, nullptr);
+    ASSERT_NE(loop, nullptr);
+    EXPECT_EQ(opcode, copy);
+    EXPECT_EQ(loop->get_quirks(), 2);
+    EXPECT_EQ(loop->get_size(), 2u);
+    EXPECT_EQ(cache.load("missing.pak#loop.ch8"), nullptr);
+
+    // The batch runner takes references and matches running the file
+    std::vector<BATCH_JOB> jobs = {
+            BATCH_JOB{"test_refs.pak#tests/opcode.ch8", 0, "", {}},
+            BATCH_JOB{"test_opcode.ch8", 0, "", {}},
+            BATCH_JOB{"test_refs.pak#nothing", 0, "", {}}};
+    WORK_STEALING_POOL pool(2);
+    std::vector<BATCH_RESULT> results =
+            run_batch(jobs, BATCH_OPTIONS{30, 12}, pool);
+    EXPECT_EQ(results[0].loaded, true);
+    EXPECT_EQ(results[0].frame_hash, results[1].frame_hash);
+    EXPECT_EQ(results[0].steps, results[1].steps);
+    EXPECT_EQ(results[2].loaded, false);
+
+    // Views keep the bundle mapped after the file is gone
+    remove("test_refs.pak");
+    EXPECT_EQ(loop->get_data()[0], 0x12);
+}
@@ -0,0 +1,673 @@
+#include "chip8_core.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Serializes the machine state of a core, for comparing states by their
+ * defined fields only.
+ * @param core The core to serialize
+ * @return The serialized state
+ */
+static std::vector<uint8_t> serialized(CHIP8CORE &core) {
+    std::vector<uint8_t> data(SERIALIZED_STATE_SIZE);
+    data.resize(core.serialize(data.data(), data.size()));
+    return data;
+}
+
+/**
+ * Core exposing where its own members start behind the machine state.
+ */
+class LAYOUT_PROBE : public CHIP8CORE {
+   public:
+    size_t block_ops_offset() {
+        return (uint8_t *) BLOCK_OPS -
+               (uint8_t *) static_cast<MACHINE_STATE *>(this);
+    }
+};
+
+TEST(CHIP8CoreTests, TestConstructor) {
+    CHIP8CORE core = CHIP8CORE();
+
+    EXPECT_EQ(core.get_pc(), PC_START);
+    EXPECT_EQ(core.get_sp(), 0xFF);
+    EXPECT_EQ(core.get_index_reg(), 0);
+    EXPECT_EQ(core.get_delay_timer(), 0);
+    EXPECT_EQ(core.get_sound_timer(), 0);
+
+    const uint8_t *MEM = core.get_mem();
+    for (int i = 0; i < MEM_SIZE; i++) {
+        if (i < MAP_LENGTH) {
+            EXPECT_EQ(MEM[i], SPRITE_MAP[i]);
+        } else {
+            EXPECT_EQ(MEM[i], 0);
+        }
+    }
+
+    const uint64_t *frame = core.get_frame_buffer();
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            EXPECT_EQ(frame_pixel(frame, x, y), false);
+        }
+    }
+
+    for (uint8_t key = 0; key < NUM_KEYS; key++) {
+        EXPECT_EQ(core.get_key_status(key), false);
+    }
+}
+
+TEST(CHIP8CoreTests, TestLoadProgram) {
+    CHIP8CORE core = CHIP8CORE();
+    char bad_path[] = "";
+    EXPECT_EQ(core.load_program(bad_path), false);
+
+    char test_rom_path[] = "test_opcode.ch8";
+    EXPECT_EQ(core.load_program(test_rom_path), true);
+
+    // The first instruction of the test rom is a jump
+    const uint8_t *MEM = core.get_mem();
+    EXPECT_NE(MEM[PC_START] | MEM[PC_START + 1], 0);
+}
+
+TEST(CHIP8CoreTests, TestLoadProgramData) {
+    CHIP8CORE core = CHIP8CORE();
+    const uint8_t *MEM = core.get_mem();
+    const uint8_t stale[] = {0xAB};
+    EXPECT_EQ(core.write_mem(PC_START + 4, stale, sizeof(stale)), true);
+
+    uint8_t program[] = {0x61, 0x23, 0x12, 0x00};
+    EXPECT_EQ(core.load_program_data(program, sizeof(program)), true);
+    for (size_t i = 0; i < sizeof(program); i++) {
+        EXPECT_EQ(MEM[PC_START + i], program[i]);
+    }
+    EXPECT_EQ(MEM[PC_START + 4], 0);
+
+    std::vector<uint8_t> too_large(MAX_PROG_SIZE + 1, 0);
+    EXPECT_EQ(core.load_program_data(too_large.data(), too_large.size()),
+              false);
+}
+
+TEST(CHIP8CoreTests, TestStep) {
+    CHIP8CORE core = CHIP8CORE();
+
+    // 6123 - LD V1, 0x23 followed by 1200 - JP 0x200
+    const uint8_t program[] = {0x61, 0x23, 0x12, 0x00};
+    core.write_mem(PC_START, program, sizeof(program));
+
+    core.step();
+    EXPECT_EQ(core.get_reg_file()[1], 0x23);
+    EXPECT_EQ(core.get_pc(), PC_START + 2);
+
+    core.step();
+    EXPECT_EQ(core.get_pc(), PC_START);
+
+    // 1FFF - JP 0xFFF leaves half an opcode, which is not executed
+    core.exec_op(0x1FFF);
+    EXPECT_EQ(core.step(), false);
+    EXPECT_EQ(core.get_pc(), MEM_SIZE - 1);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_00E0) {
+    CHIP8CORE core = CHIP8CORE();
+    const uint64_t *frame = core.get_frame_buffer();
+    core.exec_op(0xA000);
+    core.draw_sprite(5, 3, 1);
+    EXPECT_EQ(frame_pixel(frame, 5, 3), true);
+
+    core.exec_op(0x00E0);
+    EXPECT_EQ(frame_pixel(frame, 5, 3), false);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_2nnn_00EE) {
+    CHIP8CORE core = CHIP8CORE();
+    uint16_t curr_pc = core.get_pc();
+    uint8_t curr_sp = core.get_sp();
+
+    core.exec_op(0x2123);
+    EXPECT_EQ(core.get_sp(), (uint8_t)(curr_sp + 1));
+    EXPECT_EQ(core.get_stack()[core.get_sp()], curr_pc + 2);
+    EXPECT_EQ(core.get_pc(), 0x123);
+
+    core.exec_op(0x00EE);
+    EXPECT_EQ(core.get_sp(), curr_sp);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_Skips) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+    v[1] = 0x23;
+    v[2] = 0x23;
+
+    uint16_t curr_pc = core.get_pc();
+    core.exec_op(0x3123);
+    EXPECT_EQ(core.get_pc(), curr_pc + 4);
+
+    curr_pc = core.get_pc();
+    core.exec_op(0x4123);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+
+    curr_pc = core.get_pc();
+    core.exec_op(0x5120);
+    EXPECT_EQ(core.get_pc(), curr_pc + 4);
+
+    curr_pc = core.get_pc();
+    core.exec_op(0x9120);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_8xy4_8xy5) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+
+    v[1] = 0xFF;
+    v[2] = 0x01;
+    core.exec_op(0x8124);
+    EXPECT_EQ(v[1], 0x00);
+    EXPECT_EQ(v[0xF], 1);
+
+    core.exec_op(0x8125);
+    EXPECT_EQ(v[1], 0xFF);
+    EXPECT_EQ(v[0xF], 0);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_Ex9E_ExA1) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+    v[1] = 0x5;
+
+    uint16_t curr_pc = core.get_pc();
+    core.exec_op(0xE19E);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+
+    core.set_key_status(v[1], true);
+    curr_pc = core.get_pc();
+    core.exec_op(0xE19E);
+    EXPECT_EQ(core.get_pc(), curr_pc + 4);
+
+    curr_pc = core.get_pc();
+    core.exec_op(0xE1A1);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_Fx0A) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+
+    // No key pressed, instruction repeats
+    uint16_t curr_pc = core.get_pc();
+    core.exec_op(0xF30A);
+    EXPECT_EQ(core.get_pc(), curr_pc);
+
+    core.set_key_status(0xB, true);
+    core.exec_op(0xF30A);
+    EXPECT_EQ(core.get_pc(), curr_pc + 2);
+    EXPECT_EQ(v[3], 0xB);
+}
+
+TEST(CHIP8CoreTests, TestExecOp_Fx33_Fx55_Fx65) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+    const uint8_t *mem = core.get_mem();
+
+    core.exec_op(0xA300);
+    v[1] = 123;
+    core.exec_op(0xF133);
+    EXPECT_EQ(mem[0x300], 1);
+    EXPECT_EQ(mem[0x301], 2);
+    EXPECT_EQ(mem[0x302], 3);
+
+    for (uint8_t i = 0; i < REG_SIZE; i++) {
+        v[i] = i;
+    }
+    core.exec_op(0xFF55);
+    for (uint8_t i = 0; i < REG_SIZE; i++) {
+        EXPECT_EQ(mem[0x300 + i], i);
+        v[i] = 0;
+    }
+
+    core.exec_op(0xFF65);
+    for (uint8_t i = 0; i < REG_SIZE; i++) {
+        EXPECT_EQ(v[i], i);
+    }
+}
+
+TEST(CHIP8CoreTests, TestDrawSprite) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+    const uint64_t *frame = core.get_frame_buffer();
+
+    // Draw hex digit 0 at (2, 1)
+    v[0] = 2;
+    v[1] = 1;
+    v[2] = 0;
+    core.exec_op(0xF229);
+    EXPECT_EQ(core.exec_op(0xD015), true);
+    EXPECT_EQ(v[0xF], 0);
+    for (int line = 0; line < 5; line++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint8_t lit = (SPRITE_MAP[line] >> (7 - bit)) & 0x1;
+            EXPECT_EQ(frame_pixel(frame, 2 + bit, 1 + line), lit);
+        }
+    }
+
+    // Drawing again erases the sprite and reports a collision
+    EXPECT_EQ(core.exec_op(0xD015), false);
+    EXPECT_EQ(v[0xF], 1);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            EXPECT_EQ(frame_pixel(frame, x, y), false);
+        }
+    }
+
+    // Pixels off screen are not drawn
+    v[0] = SCREEN_WIDTH - 2;
+    v[1] = SCREEN_HEIGHT - 2;
+    core.exec_op(0xD015);
+    EXPECT_EQ(frame_pixel(frame, SCREEN_WIDTH - 2, SCREEN_HEIGHT - 2), true);
+    EXPECT_EQ(frame_pixel(frame, 0, 0), false);
+}
+
+TEST(CHIP8CoreTests, TestTickTimers) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+    v[0] = 2;
+    core.exec_op(0xF015);
+    core.exec_op(0xF018);
+
+    core.tick_timers();
+    EXPECT_EQ(core.get_delay_timer(), 1);
+    EXPECT_EQ(core.get_sound_timer(), 1);
+
+    core.tick_timers();
+    core.tick_timers();
+    EXPECT_EQ(core.get_delay_timer(), 0);
+    EXPECT_EQ(core.get_sound_timer(), 0);
+}
+
+TEST(CHIP8CoreTests, TestDecodeOp) {
+    DECODED_OP op = decode_op(0xD12A);
+    EXPECT_EQ(op.op, OP_DRW);
+    EXPECT_EQ(op.x, 0x1);
+    EXPECT_EQ(op.y, 0x2);
+    EXPECT_EQ(op.kk & 0x0F, 0xA);
+    EXPECT_EQ(op.nnn, 0x12A);
+
+    EXPECT_EQ(decode_op(0x00E0).op, OP_CLS);
+    EXPECT_EQ(decode_op(0x00EE).op, OP_RET);
+    EXPECT_EQ(decode_op(0x0123).op, OP_NOP);
+    EXPECT_EQ(decode_op(0x812E).op, OP_SHL);
+    EXPECT_EQ(decode_op(0x8128).op, OP_NOP);
+    EXPECT_EQ(decode_op(0xE3A1).op, OP_SKNP);
+    EXPECT_EQ(decode_op(0xE3A2).op, OP_NOP);
+    EXPECT_EQ(decode_op(0xF365).op, OP_LD_VX_MEM);
+    EXPECT_EQ(decode_op(0xF366).op, OP_NOP);
+
+    // The table agrees with the classifier for every opcode
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++) {
+        ASSERT_EQ(OP_TABLE[opcode], op_class((uint16_t) opcode));
+    }
+}
+
+TEST(CHIP8CoreTests, TestBlockCache) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+
+    // 7A01 - ADD VA, 1 followed by 1200 - JP 0x200
+    const uint8_t program[] = {0x7A, 0x01, 0x12, 0x00};
+    core.write_mem(PC_START, program, sizeof(program));
+
+    // First pass decodes the block, later passes replay it
+    EXPECT_EQ(core.run(2), 2u);
+    EXPECT_EQ(core.get_cache_stats().misses, 1u);
+    EXPECT_EQ(core.get_cache_stats().hits, 0u);
+    EXPECT_EQ(core.run(10), 10u);
+    EXPECT_EQ(v[0xA], 6);
+    EXPECT_EQ(core.get_cache_stats().misses, 1u);
+    EXPECT_EQ(core.get_cache_stats().hits, 5u);
+
+    // Stopping in the middle of a block and stepping hits its tail
+    EXPECT_EQ(core.run(1), 1u);
+    EXPECT_EQ(core.get_pc(), PC_START + 2);
+    core.step();
+    EXPECT_EQ(core.get_pc(), PC_START);
+    EXPECT_EQ(core.get_cache_stats().misses, 1u);
+    EXPECT_EQ(core.get_cache_stats().hits, 7u);
+
+    core.reset_cache_stats();
+    EXPECT_EQ(core.get_cache_stats().hits, 0u);
+}
+
+TEST(CHIP8CoreTests, TestBlockCacheSelfModifyingCode) {
+    CHIP8CORE core = CHIP8CORE();
+    uint8_t *v = core.get_reg_file();
+
+    // 7A01 - ADD VA, 1 followed by 1200 - JP 0x200
+    const uint8_t program[] = {0x7A, 0x01, 0x12, 0x00};
+    core.write_mem(PC_START, program, sizeof(program));
+    core.run(2);
+    EXPECT_EQ(v[0xA], 1);
+
+    // Patch the add into 7A05 - ADD VA, 5 with Fx55
+    v[0] = 0x7A;
+    v[1] = 0x05;
+    core.exec_op(0xA200);
+    core.exec_op(0xF155);
+    EXPECT_EQ(core.get_cache_stats().invalidations, 1u);
+
+    // Writes outside cached code do not invalidate anything
+    core.exec_op(0xA300);
+    core.exec_op(0xF133);
+    EXPECT_EQ(core.get_cache_stats().invalidations, 1u);
+
+    // The exec_op calls advanced PC past the loop, jump back and rerun it
+    EXPECT_EQ(core.get_pc(), PC_START + 8);
+    const uint8_t jump[] = {0x12, 0x00};
+    core.write_mem(PC_START + 8, jump, sizeof(jump));
+    core.run(1);
+    EXPECT_EQ(core.get_pc(), PC_START);
+    core.run(2);
+    EXPECT_EQ(v[0xA], 6);
+}
+
+TEST(CHIP8CoreTests, TestIdleLoopFastForward) {
+    CHIP8CORE core, reference;
+    const uint16_t program[] = {
+            0xF307,  // LD V3, DT
+            0x3300,  // SE V3, 0
+            0x1200,  // JP 0x200
+            0x7401,  // ADD V4, 1
+            0xE19E,  // SKP V1
+            0x1208,  // JP 0x208
+            0x120C,  // JP 0x20C
+    };
+    uint8_t data[sizeof(program)];
+    for (size_t i = 0; i < sizeof(program) / 2; i++) {
+        data[2 * i] = program[i] >> 8;
+        data[2 * i + 1] = program[i] & 0xFF;
+    }
+    for (CHIP8CORE *c : {&core, &reference}) {
+        c->load_program_data(data, sizeof(data));
+        c->get_reg_file()[5] = 5;
+        c->get_reg_file()[1] = 1;
+        c->exec_op(0xF515);
+        c->exec_op(0x1200);
+    }
+
+    // Stepping one instruction at a time never fast-forwards
+    auto expect_same = [&]() {
+        EXPECT_EQ(core.get_pc(), reference.get_pc());
+        for (int i = 0; i < REG_SIZE; i++) {
+            EXPECT_EQ(core.get_reg_file()[i], reference.get_reg_file()[i]);
+        }
+    };
+    auto step_reference = [&](int steps) {
+        for (int i = 0; i < steps; i++) {
+            reference.step();
+        }
+    };
+
+    // Waiting for the delay timer
+    EXPECT_EQ(core.is_idle(), true);
+    EXPECT_EQ(core.run(1000), 1000u);
+    step_reference(1000);
+    expect_same();
+    IDLE_STATS stats = core.get_idle_stats();
+    EXPECT_EQ(stats.fast_forwards, 1u);
+    EXPECT_EQ(stats.skipped_steps, 999u);
+
+    // Waiting for key 1 once the timer expired
+    for (int i = 0; i < 5; i++) {
+        core.tick_timers();
+        reference.tick_timers();
+    }
+    EXPECT_EQ(core.run(501), 501u);
+    step_reference(501);
+    expect_same();
+    EXPECT_EQ(core.get_reg_file()[4], 1);
+    EXPECT_EQ(core.is_idle(), true);
+
+    // Jumping to itself after the key press
+    core.set_key_status(1, true);
+    reference.set_key_status(1, true);
+    EXPECT_EQ(core.run(100), 100u);
+    step_reference(100);
+    expect_same();
+    EXPECT_EQ(core.get_pc(), PC_START + 12);
+    EXPECT_EQ(core.is_idle(), true);
+    EXPECT_EQ(core.get_idle_stats().fast_forwards, 3u);
+
+    core.reset_idle_stats();
+    EXPECT_EQ(core.get_idle_stats().skipped_steps, 0u);
+}
+
+TEST(CHIP8CoreTests, TestRunFrame) {
+    CHIP8CORE core;
+    uint8_t *v = core.get_reg_file();
+
+    // 7A01 - ADD VA, 1 followed by 1200 - JP 0x200
+    const uint8_t program[] = {0x7A, 0x01, 0x12, 0x00};
+    core.load_program_data(program, sizeof(program));
+    v[0] = 3;
+    core.exec_op(0xF015);
+    core.exec_op(0xF018);
+    core.exec_op(0x1200);
+
+    // Each frame runs its budget, then ticks the timers once
+    EXPECT_EQ(core.run_frame(10), 10u);
+    EXPECT_EQ(v[0xA], 5);
+    EXPECT_EQ(core.get_delay_timer(), 2);
+    EXPECT_EQ(core.get_sound_timer(), 2);
+
+    core.run_frame(10);
+    core.run_frame(10);
+    core.run_frame(10);
+    EXPECT_EQ(v[0xA], 20);
+    EXPECT_EQ(core.get_delay_timer(), 0);
+    EXPECT_EQ(core.get_sound_timer(), 0);
+}
+
+TEST(CHIP8CoreTests, TestRandomNumberGenerator) {
+    CHIP8CORE a, b, c;
+    uint8_t *va = a.get_reg_file();
+    uint8_t *vb = b.get_reg_file();
+    uint8_t *vc = c.get_reg_file();
+
+    // Fresh cores start from the same default seed
+    EXPECT_EQ(a.get_rng_state(), b.get_rng_state());
+
+    a.seed_rng(1234);
+    b.seed_rng(1234);
+    c.seed_rng(5678);
+    EXPECT_NE(a.get_rng_state(), 0u);
+
+    // C0FF - RND V0, 0xFF: equal seeds replay the same bytes
+    int differences = 0;
+    int histogram[256] = {0};
+    for (int i = 0; i < 4096; i++) {
+        a.exec_op(0xC0FF);
+        b.exec_op(0xC0FF);
+        c.exec_op(0xC0FF);
+        EXPECT_EQ(va[0], vb[0]);
+        differences += (va[0] != vc[0]);
+        histogram[va[0]]++;
+    }
+    EXPECT_GT(differences, 4000);
+    for (int i = 0; i < 256; i++) {
+        EXPECT_GT(histogram[i], 0) << i;
+    }
+
+    // C10F - RND V1, 0x0F: the byte is masked with kk
+    for (int i = 0; i < 64; i++) {
+        a.exec_op(0xC10F);
+        EXPECT_EQ(va[1] & 0xF0, 0);
+    }
+}
+
+TEST(CHIP8CoreTests, TestCloneState) {
+    EXPECT_EQ(alignof(MACHINE_STATE), (size_t) CACHE_LINE_SIZE);
+    EXPECT_EQ(std::is_trivially_copyable<MACHINE_STATE>::value, true);
+
+    // Restoring a state assigns all of it, which must not reach the cache
+    LAYOUT_PROBE probe;
+    EXPECT_GE(probe.block_ops_offset(), sizeof(MACHINE_STATE));
+
+    // A207 - LD I, 0x207, C0FF - RND V0, 0xFF, F055 - LD [I], V0 rewrites the
+    // byte of 71FF - ADD V1, 0xFF before it runs, 1200 - JP 0x200
+    const uint8_t rom[] = {0xA2, 0x07, 0xC0, 0xFF, 0xF0, 0x55,
+                           0x71, 0xFF, 0x12, 0x00};
+    CHIP8CORE core, twin;
+    core.load_program_data(rom, sizeof(rom));
+    core.seed_rng(7);
+    core.set_key_status(0x3, true);
+    core.run(3);
+    core.tick_timers();
+
+    // Clones are plain copies, restoring one replays the same run.  The run
+    // ends with 71xx decoded in the cache
+    MACHINE_STATE clone;
+    memcpy(&clone, &core.get_state(), sizeof(clone));
+    core.run(101);
+    std::vector<uint8_t> after = serialized(core);
+
+    twin.set_state(clone);
+    EXPECT_EQ(twin.get_pc(), 0x206);
+    EXPECT_EQ(twin.get_key_status(0x3), true);
+    twin.run(101);
+    EXPECT_EQ(serialized(twin), after);
+
+    // The rewritten code is decoded again after restoring the clone
+    core.set_state(clone);
+    core.run(101);
+    EXPECT_EQ(serialized(core), after);
+    EXPECT_EQ(core.get_rng_state(), twin.get_rng_state());
+}
+
+TEST(CHIP8CoreTests, TestSerializeState) {
+    // Same program as TestCloneState
+    const uint8_t rom[] = {0xA2, 0x07, 0xC0, 0xFF, 0xF0, 0x55,
+                           0x71, 0xFF, 0x12, 0x00};
+    CHIP8CORE core, twin;
+    core.load_program_data(rom, sizeof(rom));
+    core.seed_rng(7);
+    core.set_key_status(0x3, true);
+    core.set_key_status(0xC, true);
+    core.exec_op(0x2300);
+    core.exec_op(0xA000);
+    core.draw_sprite(3, 4, 5);
+    core.exec_op(0xF315);
+    core.exec_op(0x1200);
+    core.run(3);
+
+    std::vector<uint8_t> data(SERIALIZED_STATE_SIZE + 1);
+    EXPECT_EQ(core.serialize(data.data(), SERIALIZED_STATE_SIZE - 1), 0u);
+    ASSERT_EQ(core.serialize(data.data(), data.size()),
+              (size_t) SERIALIZED_STATE_SIZE);
+    EXPECT_EQ(memcmp(data.data(), "C8ST", 4), 0);
+    EXPECT_EQ(data[4], STATE_VERSION);
+    data.resize(SERIALIZED_STATE_SIZE);
+
+    // The copy holds every register, the stack, keys, memory and screen, and
+    // writes the same bytes
+    ASSERT_EQ(twin.deserialize(data.data(), data.size()), true);
+    EXPECT_EQ(twin.get_pc(), core.get_pc());
+    EXPECT_EQ(twin.get_sp(), 0);
+    EXPECT_EQ(twin.get_stack()[0], core.get_stack()[0]);
+    EXPECT_EQ(twin.get_index_reg(), core.get_index_reg());
+    EXPECT_EQ(twin.get_delay_timer(), core.get_delay_timer());
+    EXPECT_EQ(twin.get_rng_state(), core.get_rng_state());
+    EXPECT_EQ(twin.get_key_status(0x3), true);
+    EXPECT_EQ(twin.get_key_status(0xC), true);
+    EXPECT_EQ(twin.get_key_status(0x4), false);
+    EXPECT_EQ(memcmp(twin.get_reg_file(), core.get_reg_file(), REG_SIZE), 0);
+    EXPECT_EQ(memcmp(twin.get_mem(), core.get_mem(), MEM_SIZE), 0);
+    EXPECT_EQ(memcmp(twin.get_frame_buffer(), core.get_frame_buffer(),
+                     SCREEN_HEIGHT * sizeof(uint64_t)),
+              0);
+    std::vector<uint8_t> copy(SERIALIZED_STATE_SIZE);
+    twin.serialize(copy.data(), copy.size());
+    EXPECT_EQ(copy, data);
+
+    // Both replay the same run, the rewritten code is decoded again
+    core.run(101);
+    twin.run(101);
+    core.serialize(data.data(), data.size());
+    twin.serialize(copy.data(), copy.size());
+    EXPECT_EQ(copy, data);
+
+    // Other data leaves the machine unchanged
+    uint16_t pc = twin.get_pc();
+    EXPECT_EQ(twin.deserialize(data.data(), data.size() - 1), false);
+    data[4] = STATE_VERSION + 1;
+    EXPECT_EQ(twin.deserialize(data.data(), data.size()), false);
+    data[4] = STATE_VERSION;
+    data[STATE_HEADER_SIZE + 20] = STACK_SIZE;
+    EXPECT_EQ(twin.deserialize(data.data(), data.size()), false);
+    EXPECT_EQ(twin.get_pc(), pc);
+}
+
+TEST(CHIP8CoreTests, TestSnapshotSharesPages) {
+    // Same program as TestCloneState, its only store F055 writes page 0x200
+    const uint8_t rom[] = {0xA2, 0x07, 0xC0, 0xFF, 0xF0, 0x55,
+                           0x71, 0xFF, 0x12, 0x00};
+    CHIP8CORE core, fork;
+    core.load_program_data(rom, sizeof(rom));
+    core.seed_rng(7);
+    core.run(3);
+    SNAPSHOT parent = core.snapshot();
+
+    // Snapshots share every page that was not written in between
+    core.run(101);
+    SNAPSHOT child = core.snapshot();
+    int shared = 0;
+    for (int page = 0; page < NUM_SNAPSHOT_PAGES; page++) {
+        shared += parent.PAGES[page] == child.PAGES[page];
+    }
+    EXPECT_EQ(shared, NUM_SNAPSHOT_PAGES - 1);
+    EXPECT_NE(parent.PAGES[PC_START / SNAPSHOT_PAGE_SIZE],
+              child.PAGES[PC_START / SNAPSHOT_PAGE_SIZE]);
+    EXPECT_EQ(parent.FRAME, child.FRAME);
+    EXPECT_EQ(core.snapshot().PAGES[PC_START / SNAPSHOT_PAGE_SIZE],
+              child.PAGES[PC_START / SNAPSHOT_PAGE_SIZE]);
+    std::vector<uint8_t> after = serialized(core);
+
+    // A fork restored from the parent shares its pages and replays the run,
+    // decoding the rewritten code again
+    fork.restore(parent);
+    EXPECT_EQ(fork.get_pc(), 0x206);
+    EXPECT_EQ(parent.PAGES[0].use_count(), 4);
+    fork.run(101);
+    EXPECT_EQ(serialized(fork), after);
+
+    core.restore(parent);
+    core.run(101);
+    EXPECT_EQ(serialized(core), after);
+
+    // Drawing and clearing the screen copy the framebuffer
+    core.restore(child);
+    core.exec_op(0xA000);
+    core.draw_sprite(0, 0, 5);
+    SNAPSHOT drawn = core.snapshot();
+    EXPECT_NE(drawn.FRAME, child.FRAME);
+    EXPECT_EQ(frame_pixel(drawn.FRAME->data, 0, 0), true);
+    core.restore(child);
+    EXPECT_EQ(frame_pixel(core.get_frame_buffer(), 0, 0), false);
+
+    // Writes from outside the machine copy their page as well
+    const uint8_t patch[] = {0xAB};
+    EXPECT_EQ(core.write_mem(0x800, patch, sizeof(patch)), true);
+    EXPECT_EQ(core.write_mem(MEM_SIZE - 1, rom, 2), false);
+    SNAPSHOT patched = core.snapshot();
+    EXPECT_NE(patched.PAGES[0x800 / SNAPSHOT_PAGE_SIZE],
+              child.PAGES[0x800 / SNAPSHOT_PAGE_SIZE]);
+    EXPECT_EQ(patched.PAGES[0x800 / SNAPSHOT_PAGE_SIZE]->data[0], 0xAB);
+
+    // A snapshot without pages is rejected
+    uint16_t pc = core.get_pc();
+    EXPECT_EQ(core.restore(SNAPSHOT()), false);
+    EXPECT_EQ(core.get_pc(), pc);
+    EXPECT_EQ(core.restore(child), true);
+}
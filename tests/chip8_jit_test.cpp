@@ -0,0 +1,299 @@
+#include "chip8_jit.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Writes an opcode into memory at the given address.
+ */
+static void put_op(CHIP8CORE &core, uint16_t addr, uint16_t opcode) {
+    const uint8_t bytes[] = {(uint8_t)(opcode >> 8), (uint8_t) opcode};
+    core.write_mem(addr, bytes, sizeof(bytes));
+}
+
+/**
+ * Checks that two cores are in the same machine state.
+ */
+static void expect_same_state(CHIP8CORE &a, CHIP8CORE &b) {
+    ASSERT_EQ(a.get_pc(), b.get_pc());
+    ASSERT_EQ(a.get_sp(), b.get_sp());
+    ASSERT_EQ(a.get_index_reg(), b.get_index_reg());
+    ASSERT_EQ(a.get_delay_timer(), b.get_delay_timer());
+    ASSERT_EQ(a.get_sound_timer(), b.get_sound_timer());
+    for (int i = 0; i < REG_SIZE; i++) {
+        ASSERT_EQ(a.get_reg_file()[i], b.get_reg_file()[i]) << "V" << i;
+    }
+    for (int i = 0; i < MEM_SIZE; i++) {
+        ASSERT_EQ(a.get_mem()[i], b.get_mem()[i]) << "MEM " << i;
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ASSERT_EQ(a.get_frame_buffer()[y], b.get_frame_buffer()[y])
+                << "row " << y;
+    }
+}
+
+TEST(CHIP8JitTests, TestEngineSelection) {
+    CHIP8JIT jit;
+    EXPECT_EQ(jit.get_engine(), ENGINE_INTERPRETER);
+
+    EXPECT_EQ(jit.set_engine(ENGINE_JIT), CHIP8JIT::jit_supported());
+    EXPECT_EQ(jit.get_engine() == ENGINE_JIT, CHIP8JIT::jit_supported());
+
+    EXPECT_EQ(jit.set_engine(ENGINE_INTERPRETER), true);
+    EXPECT_EQ(jit.get_engine(), ENGINE_INTERPRETER);
+}
+
+TEST(CHIP8JitTests, TestMatchesInterpreter) {
+    if (!CHIP8JIT::jit_supported()) {
+        GTEST_SKIP();
+    }
+
+    std::mt19937 gen(8);
+    uint64_t native_steps = 0;
+    for (int program = 0; program < 50; program++) {
+        CHIP8CORE reference;
+        for (int i = 0; i < REG_SIZE; i++) {
+            reference.get_reg_file()[i] = gen() & 0xFF;
+        }
+
+        // Random straight-line code, skips, jumps, calls and fallback
+        // instructions, followed by jumps back to the start. Instructions
+        // using I come right after an Annn that is never skipped or jumped
+        // over, so they stay inside memory.
+        const int length = 64;
+        std::vector<uint16_t> targets = {PC_START};
+        bool after_skip = false;
+        uint16_t addr = PC_START;
+        while (addr < PC_START + 2 * length) {
+            uint16_t x = gen() % 16, y = gen() % 16;
+            uint16_t kk = (gen() % 2) ? gen() % 4 : gen() % 256;
+            uint16_t target = targets[gen() % targets.size()];
+            uint16_t opcode;
+            uint32_t kind = gen() % 25;
+            if ((kind == 17 || kind == 18) && after_skip) {
+                put_op(reference, addr, 0x0000);
+                addr += 2;
+            }
+            targets.push_back(addr);
+            after_skip = (kind >= 6 && kind <= 9);
+            switch (kind) {
+                case 0:
+                    opcode = 0x6000 | x << 8 | kk;
+                    break;
+                case 1:
+                    opcode = 0x7000 | x << 8 | kk;
+                    break;
+                case 2:
+                case 3:
+                case 4:
+                    opcode = 0x8000 | x << 8 | y << 4 | (gen() % 8);
+                    break;
+                case 5:
+                    opcode = 0x800E | x << 8 | y << 4;
+                    break;
+                case 6:
+                    opcode = 0x3000 | x << 8 | kk;
+                    break;
+                case 7:
+                    opcode = 0x4000 | x << 8 | kk;
+                    break;
+                case 8:
+                    opcode = 0x5000 | x << 8 | y << 4;
+                    break;
+                case 9:
+                    opcode = 0x9000 | x << 8 | y << 4;
+                    break;
+                case 10:
+                    opcode = 0xA000 | (gen() % 0x1000);
+                    break;
+                case 11:
+                    opcode = 0xF01E | x << 8;
+                    break;
+                case 12:
+                    opcode = 0xF029 | x << 8;
+                    break;
+                case 13:
+                    opcode = 0xF007 | x << 8;
+                    break;
+                case 14:
+                    opcode = 0xF015 | x << 8;
+                    break;
+                case 15:
+                    opcode = 0xF018 | x << 8;
+                    break;
+                case 16:
+                    opcode = 0x1000 | target;
+                    break;
+                case 17:
+                    put_op(reference, addr, 0xA000 | (gen() % 0x800));
+                    addr += 2;
+                    opcode = 0xD000 | x << 8 | y << 4 | (gen() % 16);
+                    break;
+                case 18:
+                    // Store into the data area, I is reloaded first
+                    put_op(reference, addr, 0xA800 | (gen() % 0x100));
+                    addr += 2;
+                    opcode = 0xF055 | x << 8;
+                    break;
+                case 19:
+                    opcode = 0x2400;
+                    break;
+                default:
+                    opcode = 0x8000 | x << 8 | y << 4 | (gen() % 8);
+                    break;
+            }
+            put_op(reference, addr, opcode);
+            addr += 2;
+        }
+        put_op(reference, addr, 0x1200);
+        put_op(reference, addr + 2, 0x1200);
+
+        // Subroutine called by 2400
+        put_op(reference, 0x400, 0x7301);
+        put_op(reference, 0x402, 0x00EE);
+
+        CHIP8JIT jit;
+        jit = reference;
+        ASSERT_EQ(jit.set_engine(ENGINE_JIT), true);
+
+        // Uneven batches stop the JIT in the middle of blocks
+        uint64_t total_steps = 0;
+        for (int batch = 0; batch < 200; batch++) {
+            uint32_t steps = 1 + gen() % 40;
+            total_steps += steps;
+            ASSERT_EQ(reference.run(steps), steps);
+            ASSERT_EQ(jit.run(steps), steps);
+            expect_same_state(reference, jit);
+            if (HasFatalFailure()) {
+                FAIL() << "program " << program << " batch " << batch;
+            }
+        }
+
+        // Programs that end in a jump to itself skip it as an idle loop
+        JIT_STATS stats = jit.get_jit_stats();
+        EXPECT_EQ(stats.native_steps + stats.fallback_steps +
+                          jit.get_idle_stats().skipped_steps,
+                  total_steps);
+        native_steps += stats.native_steps;
+    }
+    EXPECT_GT(native_steps, 0u);
+}
+
+TEST(CHIP8JitTests, TestFallback) {
+    CHIP8JIT jit;
+    jit.set_engine(ENGINE_JIT);
+    uint8_t *v = jit.get_reg_file();
+
+    // 6005 - LD V0, 5, F029 - LD F, V0, D005 - DRW V0, V0, 5, F10A - LD V1, K
+    put_op(jit, PC_START, 0x6005);
+    put_op(jit, PC_START + 2, 0xF029);
+    put_op(jit, PC_START + 4, 0xD005);
+    put_op(jit, PC_START + 6, 0xF10A);
+
+    // Waiting for a key keeps re-executing Fx0A on the interpreter
+    EXPECT_EQ(jit.run(10), 10u);
+    EXPECT_EQ(jit.get_pc(), PC_START + 6);
+    EXPECT_EQ(jit.get_index_reg(), 25);
+    EXPECT_EQ(frame_pixel(jit.get_frame_buffer(), 5, 5), true);
+
+    jit.set_key_status(0x3, true);
+    jit.run(1);
+    EXPECT_EQ(v[1], 0x3);
+    EXPECT_EQ(jit.get_pc(), PC_START + 8);
+
+    JIT_STATS stats = jit.get_jit_stats();
+    if (CHIP8JIT::jit_supported()) {
+        EXPECT_EQ(stats.compiled_blocks, 1u);
+        EXPECT_EQ(stats.native_steps, 2u);
+        EXPECT_EQ(stats.fallback_steps, 9u);
+    } else {
+        EXPECT_EQ(stats.native_steps, 0u);
+    }
+}
+
+TEST(CHIP8JitTests, TestSelfModifyingCode) {
+    CHIP8JIT jit;
+    jit.set_engine(ENGINE_JIT);
+    uint8_t *v = jit.get_reg_file();
+
+    // 7A01 - ADD VA, 1 followed by 1200 - JP 0x200
+    put_op(jit, PC_START, 0x7A01);
+    put_op(jit, PC_START + 2, 0x1200);
+    jit.run(20);
+    EXPECT_EQ(v[0xA], 10);
+
+    // Patch the add into 7A05 - ADD VA, 5 and jump back to it
+    v[0] = 0x7A;
+    v[1] = 0x05;
+    jit.exec_op(0xA200);
+    jit.exec_op(0xF155);
+    jit.exec_op(0x1200);
+    jit.run(4);
+    EXPECT_EQ(v[0xA], 20);
+}
+
+TEST(CHIP8JitTests, TestLinkedBlocks) {
+    if (!CHIP8JIT::jit_supported()) {
+        GTEST_SKIP();
+    }
+    CHIP8JIT jit;
+    jit.set_engine(ENGINE_JIT);
+    const uint8_t *mem = jit.get_mem();
+    uint8_t *v = jit.get_reg_file();
+
+    // 7001 - ADD V0, 1, 3010 - SE V0, 0x10, 1200 - JP 0x200, 1206 - JP 0x206
+    put_op(jit, PC_START, 0x7001);
+    put_op(jit, PC_START + 2, 0x3010);
+    put_op(jit, PC_START + 4, 0x1200);
+    put_op(jit, PC_START + 6, 0x1206);
+
+    // The loop runs on in native code, the idle loop it ends in is skipped
+    EXPECT_EQ(jit.run(100), 100u);
+    EXPECT_EQ(v[0], 0x10);
+    EXPECT_EQ(jit.get_pc(), PC_START + 6);
+    JIT_STATS stats = jit.get_jit_stats();
+    EXPECT_EQ(stats.compiled_blocks, 2u);
+    EXPECT_EQ(stats.linked_exits, 2u);
+    EXPECT_EQ(stats.native_steps, 47u);
+    EXPECT_EQ(jit.get_idle_stats().skipped_steps, 53u);
+
+    // A store elsewhere in the page keeps the translations
+    jit.exec_op(0xA220);
+    jit.exec_op(0xF055);
+    jit.exec_op(0x6000);
+    jit.exec_op(0x1200);
+    EXPECT_EQ(jit.run(100), 100u);
+    EXPECT_EQ(v[0], 0x10);
+    EXPECT_EQ(mem[0x220], 0x10);
+    EXPECT_EQ(jit.get_jit_stats().compiled_blocks, 2u);
+    EXPECT_EQ(jit.get_jit_stats().native_steps, 94u);
+}
+
+TEST(CHIP8JitTests, TestLinkedExitToRewrittenBlock) {
+    CHIP8JIT reference;
+    CHIP8JIT jit;
+    jit.set_engine(ENGINE_JIT);
+    for (CHIP8JIT *core : {&reference, &jit}) {
+        // 7001 - ADD V0, 1 and 1300 - JP 0x300 at 0x200, 7101 - ADD V1, 1
+        // and 1200 - JP 0x200 at 0x300, the two exits get linked
+        put_op(*core, PC_START, 0x7001);
+        put_op(*core, PC_START + 2, 0x1300);
+        put_op(*core, 0x300, 0x7101);
+        put_op(*core, 0x302, 0x1200);
+        core->run(100);
+
+        // Rewrite the add at 0x300 into 7105 - ADD V1, 5, the exit of the
+        // block at 0x200 still leads to the old translation
+        uint8_t *v = core->get_reg_file();
+        v[0] = 0x71;
+        v[1] = 0x05;
+        core->exec_op(0xA300);
+        core->exec_op(0xF155);
+        core->exec_op(0x1300);
+        core->run(42);
+    }
+    EXPECT_EQ(jit.get_reg_file()[1], 60);
+    expect_same_state(reference, jit);
+}
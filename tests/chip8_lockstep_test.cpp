@@ -0,0 +1,237 @@
+#include "chip8_lockstep.h"
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Appends an opcode to a program.
+ */
+static void put_op(std::vector<uint8_t> &rom, uint16_t opcode) {
+    rom.push_back(opcode >> 8);
+    rom.push_back(opcode & 0xFF);
+}
+
+/**
+ * Checks that a lane is in the same machine state as a core.
+ */
+static void expect_same_state(CHIP8LOCKSTEP &lockstep, uint32_t lane,
+                              CHIP8CORE &core) {
+    ASSERT_EQ(lockstep.get_pc(lane), core.get_pc()) << "lane " << lane;
+    ASSERT_EQ(lockstep.get_sp(lane), core.get_sp()) << "lane " << lane;
+    ASSERT_EQ(lockstep.get_index_reg(lane), core.get_index_reg());
+    ASSERT_EQ(lockstep.get_delay_timer(lane), core.get_delay_timer());
+    ASSERT_EQ(lockstep.get_sound_timer(lane), core.get_sound_timer());
+    for (int i = 0; i < STACK_SIZE; i++) {
+        ASSERT_EQ(lockstep.get_stack(lane, i), core.get_stack()[i]);
+    }
+    for (int i = 0; i < REG_SIZE; i++) {
+        ASSERT_EQ(lockstep.get_reg(lane, i), core.get_reg_file()[i])
+                << "lane " << lane << " V" << i;
+    }
+    for (int i = 0; i < MEM_SIZE; i++) {
+        ASSERT_EQ(lockstep.get_mem(lane)[i], core.get_mem()[i])
+                << "lane " << lane << " MEM " << i;
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        ASSERT_EQ(lockstep.get_frame_buffer(lane)[y],
+                  core.get_frame_buffer()[y])
+                << "lane " << lane << " row " << y;
+    }
+}
+
+/**
+ * Runs a program on a lockstep engine and on one core per lane, each lane
+ * with its own seed and keys, and checks that every lane matches its core
+ * after batches of uneven length.
+ */
+static void expect_matches_cores(const std::vector<uint8_t> &rom,
+                                 uint32_t lanes) {
+    CHIP8LOCKSTEP lockstep(lanes);
+    std::vector<std::unique_ptr<CHIP8CORE>> cores;
+    ASSERT_EQ(lockstep.load_program_data(rom.data(), rom.size()), true);
+    for (uint32_t lane = 0; lane < lanes; lane++) {
+        cores.emplace_back(new CHIP8CORE());
+        ASSERT_EQ(cores[lane]->load_program_data(rom.data(), rom.size()), true);
+        cores[lane]->seed_rng(lane);
+        lockstep.seed_rng(lane, lane);
+    }
+
+    std::mt19937 gen(lanes);
+    const uint32_t batches[] = {1, 2, 7, 12, 100, 3, 1000, 12, 12, 250};
+    for (int frame = 0; frame < 30; frame++) {
+        uint32_t batch = batches[frame % 10];
+        uint64_t expected = 0;
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            expected += cores[lane]->run(batch);
+        }
+        EXPECT_EQ(lockstep.run(batch), expected);
+
+        lockstep.tick_timers();
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            cores[lane]->tick_timers();
+            ASSERT_NO_FATAL_FAILURE(
+                    expect_same_state(lockstep, lane, *cores[lane]));
+        }
+
+        // Lanes press and release keys at different times
+        for (uint32_t lane = 0; lane < lanes; lane++) {
+            uint8_t key = gen() % NUM_KEYS;
+            bool pressed = gen() % 2;
+            lockstep.set_key_status(lane, key, pressed);
+            cores[lane]->set_key_status(key, pressed);
+        }
+    }
+}
+
+TEST(CHIP8LockstepTests, TestInitialState) {
+    CHIP8LOCKSTEP lockstep(3);
+    CHIP8CORE core;
+    EXPECT_EQ(lockstep.get_lanes(), 3u);
+    for (uint32_t lane = 0; lane < 3; lane++) {
+        ASSERT_NO_FATAL_FAILURE(expect_same_state(lockstep, lane, core));
+    }
+
+    std::vector<uint8_t> too_large(MAX_PROG_SIZE + 1, 0);
+    EXPECT_EQ(lockstep.load_program_data(too_large.data(), too_large.size()),
+              false);
+}
+
+TEST(CHIP8LockstepTests, TestLanesSplitAndMerge) {
+    // C001 - RND V0, 1, 3000 - SE V0, 0, 7105 - ADD V1, 5, 7201 - ADD V2, 1,
+    // 1200 - JP 0x200
+    std::vector<uint8_t> rom;
+    for (uint16_t op : {0xC001, 0x3000, 0x7105, 0x7201, 0x1200}) {
+        put_op(rom, op);
+    }
+    ASSERT_NO_FATAL_FAILURE(expect_matches_cores(rom, 8));
+
+    // Lanes take both sides of the skip but run most instructions together
+    CHIP8LOCKSTEP lockstep(8);
+    lockstep.load_program_data(rom.data(), rom.size());
+    EXPECT_EQ(lockstep.run(1000), 8000u);
+    LOCKSTEP_STATS stats = lockstep.get_lockstep_stats();
+    EXPECT_EQ(stats.lane_steps, 8000u);
+    EXPECT_GE(stats.issues, 1000u);
+    EXPECT_LT(stats.issues, 1400u);
+
+    // Every instruction of the loop, RND included, runs as a lane loop
+    EXPECT_EQ(stats.scalar_lane_steps, 0u);
+}
+
+TEST(CHIP8LockstepTests, TestSelfModifyingLanes) {
+    // Each lane writes 74kk with its own random kk over the instruction at
+    // 0x208, then runs it: 6074 - LD V0, 0x74, C1FF - RND V1, A208 - LD I,
+    // 0x208, F155 - LD [I], V1, 0000 - overwritten, F433 - LD B, V4 which
+    // overwrites the code again, 1200 - JP 0x200
+    std::vector<uint8_t> rom;
+    for (uint16_t op : {0x6074, 0xC1FF, 0xA208, 0xF155, 0x0000, 0xF433,
+                        0x1200}) {
+        put_op(rom, op);
+    }
+    ASSERT_NO_FATAL_FAILURE(expect_matches_cores(rom, 5));
+}
+
+TEST(CHIP8LockstepTests, TestRandomPrograms) {
+    std::mt19937 gen(10);
+    for (int program = 0; program < 20; program++) {
+        // Random ALU code, skips, timer and key instructions, with memory and
+        // drawing instructions right after an Annn and Bnnn right after a
+        // small V0 that are never skipped, so I and PC stay in bounds
+        std::vector<uint8_t> rom;
+        put_op(rom, 0x2000 | (PC_START + 0x180));
+        bool after_skip = false;
+        while (rom.size() < 0x100) {
+            uint16_t x = gen() % 16, y = gen() % 16, kk = gen() % 256;
+            uint32_t kind = gen() % 16;
+            if (kind >= 11 && after_skip) {
+                put_op(rom, 0x0000);
+            }
+            after_skip = false;
+            switch (kind) {
+                case 0:
+                    put_op(rom, 0xC000 | x << 8 | kk);
+                    break;
+                case 1:
+                    put_op(rom, 0x6000 | x << 8 | kk);
+                    break;
+                case 2:
+                    put_op(rom, 0x7000 | x << 8 | kk);
+                    break;
+                case 3:
+                case 4: {
+                    const uint16_t alu[] = {0, 1, 2, 3, 4, 5, 6, 7, 0xE};
+                    put_op(rom, 0x8000 | x << 8 | y << 4 | alu[gen() % 9]);
+                    break;
+                }
+                case 5:
+                    put_op(rom, 0x3000 | x << 8 | (kk & 3));
+                    after_skip = true;
+                    break;
+                case 6:
+                    put_op(rom, 0x4000 | x << 8 | (kk & 3));
+                    after_skip = true;
+                    break;
+                case 7:
+                    put_op(rom, (gen() % 2 ? 0x5000 : 0x9000) | x << 8 |
+                                        y << 4);
+                    after_skip = true;
+                    break;
+                case 8:
+                    put_op(rom, (gen() % 2 ? 0xE09E : 0xE0A1) | x << 8);
+                    after_skip = true;
+                    break;
+                case 9: {
+                    const uint16_t timer[] = {0x07, 0x15, 0x18, 0x1E, 0x29};
+                    put_op(rom, 0xF000 | x << 8 | timer[gen() % 5]);
+                    break;
+                }
+                case 10:
+                    put_op(rom, 0xF00A | x << 8);
+                    break;
+                case 11:
+                    // Jumps to one of the three NOPs or the instruction after
+                    put_op(rom, 0x6000 | (gen() % 4) * 2);
+                    put_op(rom, 0xB000 | (rom.size() + PC_START + 2));
+                    put_op(rom, 0x0000);
+                    put_op(rom, 0x0000);
+                    put_op(rom, 0x0000);
+                    break;
+                case 12:
+                    put_op(rom, 0x00E0);
+                    break;
+                default: {
+                    const uint16_t mem[] = {0xF033, 0xF055, 0xF065, 0xD000};
+                    uint16_t op = mem[gen() % 4];
+                    put_op(rom, 0xA000 | (0x600 + (gen() % 256)));
+                    put_op(rom, op == 0xD000 ? op | x << 8 | y << 4 | (kk & 0xF)
+                                             : op | x << 8);
+                    break;
+                }
+            }
+        }
+        put_op(rom, 0x0000);
+        put_op(rom, 0x1202);
+
+        // The subroutine called first sets up the registers
+        rom.resize(0x180, 0);
+        for (int i = 0; i < REG_SIZE; i++) {
+            put_op(rom, 0xC0FF | i << 8);
+        }
+        put_op(rom, 0x00EE);
+
+        ASSERT_NO_FATAL_FAILURE(expect_matches_cores(rom, 1 + program % 7 * 6))
+                << "program " << program;
+    }
+}
+
+TEST(CHIP8LockstepTests, TestOpcodeRom) {
+    FILE *file = fopen("test_opcode.ch8", "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<uint8_t> rom(MAX_PROG_SIZE);
+    rom.resize(fread(rom.data(), 1, rom.size(), file));
+    fclose(file);
+    ASSERT_NO_FATAL_FAILURE(expect_matches_cores(rom, 4));
+}
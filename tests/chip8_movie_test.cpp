@@ -0,0 +1,118 @@
+#include "chip8_movie.h"
+
+#include <string.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "chip8_batch.h"
+#include "gtest/gtest.h"
+
+/**
+ * Loads a program driven by keys and Cxkk: F10A - LD V1, K waits for a key,
+ * C0FF - RND V0, 0xFF, F029 - LD F, V0, D235 - DRW V2, V3, 5, 7201 - ADD V2,
+ * 1, E19E - SKP V1, 1200 - JP 0x200, 1202 - JP 0x202 loops while V1 is held
+ */
+static void load_key_program(CHIP8CORE &core) {
+    const uint8_t rom[] = {0xF1, 0x0A, 0xC0, 0xFF, 0xF0, 0x29, 0xD2, 0x35,
+                           0x72, 0x01, 0xE1, 0x9E, 0x12, 0x00, 0x12, 0x02};
+    core.load_program_data(rom, sizeof(rom));
+}
+
+/**
+ * Records a session of random key presses, keeping a copy of the state
+ * after every frame.
+ */
+static void record_session(CHIP8MOVIE &movie, CHIP8CORE &core,
+                           std::vector<MACHINE_STATE> &states) {
+    std::mt19937 gen(3);
+    load_key_program(core);
+    movie.record(core, 42, 10, 50);
+    states.push_back(core.get_state());
+    for (int frame = 0; frame < 500; frame++) {
+        if (gen() % 4 == 0) {
+            movie.key_event(core, gen() % NUM_KEYS, gen() % 2);
+        }
+        movie.run_frame(core);
+        states.push_back(core.get_state());
+    }
+    movie.stop(core);
+}
+
+TEST(CHIP8MovieTests, TestRecordAndReplay) {
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE()), player(new CHIP8CORE());
+    std::vector<MACHINE_STATE> states;
+    CHIP8MOVIE movie;
+    record_session(movie, *core, states);
+    EXPECT_EQ(movie.is_recording(), false);
+    EXPECT_EQ(movie.get_frames(), 500u);
+    EXPECT_EQ(movie.get_total_steps(), 5000u);
+    EXPECT_EQ(movie.get_keyframes().size(), 11u);
+    EXPECT_GT(movie.get_events().size(), 20u);
+    EXPECT_EQ(movie.get_final_hash(),
+              hash_frame_buffer(core->get_frame_buffer()));
+
+    // The movie holds the ROM and seed, the player needs nothing else
+    ASSERT_EQ(movie.play(*player), true);
+    for (uint32_t frame = 0; frame <= 500; frame++) {
+        ASSERT_EQ(movie.get_frame(), frame);
+        ASSERT_EQ(memcmp(&player->get_state(), &states[frame],
+                         sizeof(MACHINE_STATE)),
+                  0)
+                << "frame " << frame;
+        EXPECT_EQ(movie.run_frame(*player), frame < 500 ? 10u : 0u);
+    }
+    EXPECT_EQ(movie.is_finished(), true);
+    EXPECT_EQ(movie.is_desynced(), false);
+}
+
+TEST(CHIP8MovieTests, TestSaveLoadAndSeek) {
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE()), player(new CHIP8CORE());
+    std::vector<MACHINE_STATE> states;
+    CHIP8MOVIE recorded;
+    record_session(recorded, *core, states);
+    ASSERT_EQ(recorded.save("test_movie.c8m"), true);
+
+    CHIP8MOVIE movie;
+    ASSERT_EQ(movie.load("test_movie.c8m"), true);
+    EXPECT_EQ(movie.get_seed(), 42u);
+    EXPECT_EQ(movie.get_steps_per_frame(), 10u);
+    EXPECT_EQ(movie.get_events().size(), recorded.get_events().size());
+
+    // Seeks land on keyframes, between them and backwards
+    for (uint32_t frame : {0u, 50u, 137u, 499u, 500u, 12u, 349u}) {
+        ASSERT_EQ(movie.seek(*player, frame), true);
+        EXPECT_EQ(movie.get_frame(), frame);
+        EXPECT_EQ(movie.get_steps(), 10u * frame);
+        ASSERT_EQ(memcmp(&player->get_state(), &states[frame],
+                         sizeof(MACHINE_STATE)),
+                  0)
+                << "frame " << frame;
+    }
+    EXPECT_EQ(movie.seek(*player, 501), false);
+
+    // Replaying to the end reproduces the recorded screen
+    ASSERT_EQ(movie.seek(*player, 420), true);
+    while (!movie.is_finished()) {
+        movie.run_frame(*player);
+    }
+    EXPECT_EQ(hash_frame_buffer(player->get_frame_buffer()),
+              movie.get_final_hash());
+    EXPECT_EQ(movie.is_desynced(), false);
+
+    // Files that are not movies of this version are rejected
+    EXPECT_EQ(movie.load("missing.c8m"), false);
+    EXPECT_EQ(movie.load("test_opcode.ch8"), false);
+
+    // So are movies with a keyframe that does not deserialize, here with a
+    // stack pointer past the stack
+    FILE *file = fopen("test_movie.c8m", "r+b");
+    ASSERT_NE(file, nullptr);
+    fseek(file, -(long) SERIALIZED_STATE_SIZE + STATE_HEADER_SIZE + 20,
+          SEEK_END);
+    fputc(STACK_SIZE, file);
+    fclose(file);
+    EXPECT_EQ(movie.load("test_movie.c8m"), false);
+    remove("test_movie.c8m");
+}
@@ -0,0 +1,135 @@
+#include "chip8_core.h"
+
+#include "chip8_bundle.h"
+#include "gtest/gtest.h"
+
+TEST(CHIP8QuirksTests, TestQuirkBehaviors) {
+    CHIP8CORE plain, quirky;
+    uint8_t *V = plain.get_reg_file();
+    uint8_t *QV = quirky.get_reg_file();
+    EXPECT_EQ(plain.get_quirks(), QUIRKS_DEFAULT);
+    EXPECT_EQ(quirky.set_quirks(NUM_QUIRK_PROFILES), false);
+    EXPECT_EQ(quirky.get_quirks(), QUIRKS_DEFAULT);
+
+    // 8xy6 / 8xyE shift Vx, or Vy with QUIRK_SHIFT_VY
+    ASSERT_EQ(quirky.set_quirks(QUIRK_SHIFT_VY), true);
+    V[0] = QV[0] = 0x81;
+    V[1] = QV[1] = 0x06;
+    plain.exec_op(0x8016);
+    quirky.exec_op(0x8016);
+    EXPECT_EQ(V[0], 0x40);
+    EXPECT_EQ(V[0xF], 1);
+    EXPECT_EQ(QV[0], 0x03);
+    EXPECT_EQ(QV[0xF], 0);
+    V[1] = QV[1] = 0x81;
+    plain.exec_op(0x801E);
+    quirky.exec_op(0x801E);
+    EXPECT_EQ(V[0], 0x80);
+    EXPECT_EQ(V[0xF], 0);
+    EXPECT_EQ(QV[0], 0x02);
+    EXPECT_EQ(QV[0xF], 1);
+
+    // Logic opcodes keep VF, or reset it with QUIRK_LOGIC_VF
+    ASSERT_EQ(quirky.set_quirks(QUIRK_LOGIC_VF), true);
+    for (uint16_t opcode : {0x8011, 0x8012, 0x8013}) {
+        V[0xF] = QV[0xF] = 1;
+        plain.exec_op(opcode);
+        quirky.exec_op(opcode);
+        EXPECT_EQ(V[0xF], 1);
+        EXPECT_EQ(QV[0xF], 0);
+    }
+
+    // Fx55 / Fx65 keep I, or leave it past Vx with QUIRK_MEM_INC_I
+    ASSERT_EQ(quirky.set_quirks(QUIRK_MEM_INC_I), true);
+    plain.exec_op(0xA300);
+    quirky.exec_op(0xA300);
+    plain.exec_op(0xF255);
+    quirky.exec_op(0xF255);
+    EXPECT_EQ(plain.get_index_reg(), 0x300);
+    EXPECT_EQ(quirky.get_index_reg(), 0x303);
+    EXPECT_EQ(quirky.get_mem()[0x302], QV[2]);
+    quirky.exec_op(0xF165);
+    EXPECT_EQ(quirky.get_index_reg(), 0x305);
+
+    // Bnnn adds V0, Bxnn with QUIRK_JUMP_VX adds Vx
+    ASSERT_EQ(quirky.set_quirks(QUIRK_JUMP_VX), true);
+    V[0] = QV[0] = 0x10;
+    V[2] = QV[2] = 0x20;
+    plain.exec_op(0xB234);
+    quirky.exec_op(0xB234);
+    EXPECT_EQ(plain.get_pc(), 0x244);
+    EXPECT_EQ(quirky.get_pc(), 0x254);
+
+    // Sprites are clipped at the edges, or wrap with QUIRK_WRAP
+    ASSERT_EQ(quirky.set_quirks(QUIRK_WRAP), true);
+    plain.exec_op(0x00E0);
+    quirky.exec_op(0x00E0);
+    plain.exec_op(0xA000);
+    quirky.exec_op(0xA000);
+    V[0] = QV[0] = 62;
+    V[1] = QV[1] = 30;
+    plain.exec_op(0xD015);
+    quirky.exec_op(0xD015);
+    EXPECT_EQ(frame_pixel(plain.get_frame_buffer(), 62, 30), true);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 62, 30), true);
+    EXPECT_EQ(frame_pixel(plain.get_frame_buffer(), 0, 30), false);
+    EXPECT_EQ(frame_pixel(plain.get_frame_buffer(), 62, 0), false);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 0, 30), true);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 1, 30), true);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 62, 0), true);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 1, 0), true);
+    EXPECT_EQ(frame_pixel(quirky.get_frame_buffer(), 0, 0), false);
+}
+
+TEST(CHIP8QuirksTests, TestProfileSelection) {
+    // V0 = 5, V1 = 3, SHR V0 {, V1}, halt
+    std::vector<uint8_t> program = {0x60, 0x05, 0x61, 0x03,
+                                    0x80, 0x16, 0x12, 0x06};
+    BUNDLE_ROM vip{"vip.ch8", QUIRKS_COSMAC_VIP, program};
+    BUNDLE_ROM plain{"plain.ch8", QUIRKS_DEFAULT, program};
+    BUNDLE_ROM unknown{"unknown.ch8", NUM_QUIRK_PROFILES, program};
+    ASSERT_EQ(write_bundle("test_quirks.pak", {vip, plain, unknown}), true);
+
+    // Loading a ROM of a bundle selects its profile, run and step use it
+    CHIP8CORE core;
+    ASSERT_EQ(core.load_program("test_quirks.pak#vip.ch8"), true);
+    EXPECT_EQ(core.get_quirks(), QUIRKS_COSMAC_VIP);
+    core.run(3);
+    EXPECT_EQ(core.get_reg_file()[0], 1);
+    ASSERT_EQ(core.load_program("test_quirks.pak#plain.ch8"), true);
+    EXPECT_EQ(core.get_quirks(), QUIRKS_DEFAULT);
+    core.get_reg_file()[0] = 5;
+    core.get_reg_file()[1] = 3;
+    core.exec_op(0x8016);
+    EXPECT_EQ(core.get_reg_file()[0], 2);
+    EXPECT_EQ(core.load_program("test_quirks.pak#unknown.ch8"), false);
+
+    // The cache does not share a ROM between profiles
+    ROM_CACHE cache;
+    std::shared_ptr<const MAPPED_ROM> vip_rom =
+            cache.load("test_quirks.pak#vip.ch8");
+    std::shared_ptr<const MAPPED_ROM> plain_rom =
+            cache.load("test_quirks.pak#plain.ch8");
+    ASSERT_NE(vip_rom, nullptr);
+    EXPECT_NE(vip_rom, plain_rom);
+    EXPECT_EQ(vip_rom->get_quirks(), QUIRKS_COSMAC_VIP);
+
+    // Running blocks matches single steps in every profile
+    std::vector<uint8_t> ran_state(SERIALIZED_STATE_SIZE);
+    std::vector<uint8_t> stepped_state(SERIALIZED_STATE_SIZE);
+    for (uint16_t quirks = 0; quirks < NUM_QUIRK_PROFILES; quirks++) {
+        CHIP8CORE ran, stepped;
+        ASSERT_EQ(ran.load_program("test_opcode.ch8"), true);
+        ASSERT_EQ(stepped.load_program("test_opcode.ch8"), true);
+        ASSERT_EQ(ran.set_quirks(quirks), true);
+        ASSERT_EQ(stepped.set_quirks(quirks), true);
+        ran.run(500);
+        for (int i = 0; i < 500; i++) {
+            stepped.step();
+        }
+        ran.serialize(ran_state.data(), ran_state.size());
+        stepped.serialize(stepped_state.data(), stepped_state.size());
+        EXPECT_EQ(ran_state, stepped_state);
+    }
+    remove("test_quirks.pak");
+}
@@ -0,0 +1,109 @@
+#include "chip8_rewind.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Loads a program that changes registers, memory and the framebuffer every
+ * frame: C0FF - RND V0, 0xFF, A300 - LD I, 0x300, F11E - ADD I, V1, F055 -
+ * LD [I], V0, 7101 - ADD V1, 1, D235 - DRW V2, V3, 5, 7201 - ADD V2, 1,
+ * 1200 - JP 0x200
+ */
+static void load_busy_program(CHIP8CORE &core) {
+    const uint8_t rom[] = {0xC0, 0xFF, 0xA3, 0x00, 0xF1, 0x1E, 0xF0, 0x55,
+                           0x71, 0x01, 0xD2, 0x35, 0x72, 0x01, 0x12, 0x00};
+    core.load_program_data(rom, sizeof(rom));
+}
+
+/**
+ * Serializes the machine state of a core, for comparing states by their
+ * defined fields only.
+ */
+static std::vector<uint8_t> serialized(CHIP8CORE &core) {
+    std::vector<uint8_t> data(SERIALIZED_STATE_SIZE);
+    data.resize(core.serialize(data.data(), data.size()));
+    return data;
+}
+
+/**
+ * Runs frames on a core, recording each in the history and in a list of
+ * serialized copies.
+ */
+static void record_frames(CHIP8CORE &core, CHIP8REWIND &rewind,
+                          std::vector<std::vector<uint8_t>> &frames,
+                          int count) {
+    for (int i = 0; i < count; i++) {
+        core.run_frame(12);
+        ASSERT_EQ(rewind.push(core), true);
+        frames.push_back(serialized(core));
+    }
+}
+
+/**
+ * Steps back through the history, checking each restored frame against the
+ * serialized copies, which lose their newest entry with every step.
+ */
+static void expect_steps_back(CHIP8CORE &core, CHIP8REWIND &rewind,
+                              std::vector<std::vector<uint8_t>> &frames,
+                              int count) {
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(rewind.step_back(core), true) << "step " << i;
+        frames.pop_back();
+        ASSERT_EQ(serialized(core), frames.back()) << "step " << i;
+    }
+}
+
+TEST(CHIP8RewindTests, TestStepBack) {
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    std::unique_ptr<CHIP8REWIND> rewind(new CHIP8REWIND());
+    std::vector<std::vector<uint8_t>> frames;
+    load_busy_program(*core);
+    EXPECT_EQ(rewind->step_back(*core), false);
+
+    ASSERT_NO_FATAL_FAILURE(record_frames(*core, *rewind, frames, 500));
+    EXPECT_EQ(rewind->get_frames(), 500u);
+
+    // Frames hold a few changed bytes, keyframes mostly zero runs
+    EXPECT_LT(rewind->get_used_bytes(), 500 * SERIALIZED_STATE_SIZE / 20);
+
+    // Stepping back crosses keyframes, recording again continues from the
+    // restored frame
+    ASSERT_NO_FATAL_FAILURE(expect_steps_back(*core, *rewind, frames, 150));
+    ASSERT_NO_FATAL_FAILURE(record_frames(*core, *rewind, frames, 70));
+    ASSERT_NO_FATAL_FAILURE(expect_steps_back(*core, *rewind, frames, 419));
+    EXPECT_EQ(rewind->get_frames(), 1u);
+    EXPECT_EQ(rewind->step_back(*core), false);
+
+    rewind->clear();
+    EXPECT_EQ(rewind->get_frames(), 0u);
+    EXPECT_EQ(rewind->get_used_bytes(), 0u);
+}
+
+TEST(CHIP8RewindTests, TestRingDropsOldestFrames) {
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    std::unique_ptr<CHIP8REWIND> rewind(new CHIP8REWIND(8000, 16));
+    std::vector<std::vector<uint8_t>> frames;
+    load_busy_program(*core);
+
+    // The ring wraps many times, only whole keyframe groups are dropped
+    ASSERT_NO_FATAL_FAILURE(record_frames(*core, *rewind, frames, 2000));
+    size_t kept = rewind->get_frames();
+    EXPECT_GT(kept, 16u);
+    EXPECT_LT(kept, 2000u);
+    EXPECT_LE(rewind->get_used_bytes(), 8000u);
+
+    // Stepping back and recording again reuses the freed space
+    ASSERT_NO_FATAL_FAILURE(expect_steps_back(*core, *rewind, frames, 10));
+    ASSERT_NO_FATAL_FAILURE(record_frames(*core, *rewind, frames, 300));
+    kept = rewind->get_frames();
+    ASSERT_NO_FATAL_FAILURE(
+            expect_steps_back(*core, *rewind, frames, (int) kept - 1));
+    EXPECT_EQ(rewind->step_back(*core), false);
+
+    // A ring smaller than one keyframe records nothing
+    CHIP8REWIND tiny(16, 16);
+    EXPECT_EQ(tiny.push(*core), false);
+    EXPECT_EQ(tiny.get_frames(), 0u);
+}
@@ -0,0 +1,85 @@
+#include "chip8_rom_cache.h"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Writes a file holding the given bytes.
+ */
+static void write_file(const char *path, const std::vector<uint8_t> &data) {
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *) data.data(), data.size());
+}
+
+TEST(CHIP8RomCacheTests, TestMappedRom) {
+    std::ifstream file("test_opcode.ch8", std::ios::binary);
+    std::vector<uint8_t> expected((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+    MAPPED_ROM rom;
+    EXPECT_EQ(rom.get_size(), 0u);
+    ASSERT_EQ(rom.open("test_opcode.ch8"), true);
+    ASSERT_EQ(rom.get_size(), expected.size());
+    EXPECT_EQ(std::vector<uint8_t>(rom.get_data(),
+                                   rom.get_data() + rom.get_size()),
+              expected);
+    EXPECT_EQ(rom.get_hash(), hash_bytes(expected.data(), expected.size()));
+
+    // Empty files are empty ROMs, missing and oversized ones fail
+    write_file("test_empty.ch8", {});
+    EXPECT_EQ(rom.open("test_empty.ch8"), true);
+    EXPECT_EQ(rom.get_size(), 0u);
+    EXPECT_EQ(rom.get_data(), nullptr);
+    EXPECT_EQ(rom.open("missing.ch8"), false);
+    write_file("test_large.ch8", std::vector<uint8_t>(MAX_PROG_SIZE + 1, 1));
+    EXPECT_EQ(rom.open("test_large.ch8"), false);
+
+    // Cores load the mapped program, clearing what followed the last one
+    CHIP8CORE core;
+    std::vector<uint8_t> filler(MAX_PROG_SIZE, 0xAA);
+    ASSERT_EQ(core.load_program_data(filler.data(), filler.size()), true);
+    ASSERT_EQ(core.load_program("test_opcode.ch8"), true);
+    EXPECT_EQ(std::vector<uint8_t>(core.get_mem() + PC_START,
+                                   core.get_mem() + PC_START + expected.size()),
+              expected);
+    EXPECT_EQ(core.get_mem()[PC_START + expected.size()], 0);
+    EXPECT_EQ(core.get_mem()[PC_START + MAX_PROG_SIZE - 1], 0);
+    EXPECT_EQ(core.load_program("test_large.ch8"), false);
+    remove("test_empty.ch8");
+    remove("test_large.ch8");
+}
+
+TEST(CHIP8RomCacheTests, TestSharedRoms) {
+    std::vector<uint8_t> game(300), other(300);
+    for (size_t i = 0; i < game.size(); i++) {
+        game[i] = (uint8_t) i;
+        other[i] = (uint8_t)(i * 7);
+    }
+    write_file("test_game_a.ch8", game);
+    write_file("test_game_b.ch8", game);
+    write_file("test_game_c.ch8", other);
+
+    // Repeated paths and copies of a file share one mapping
+    ROM_CACHE cache;
+    std::shared_ptr<const MAPPED_ROM> a = cache.load("test_game_a.ch8");
+    std::shared_ptr<const MAPPED_ROM> b = cache.load("test_game_b.ch8");
+    std::shared_ptr<const MAPPED_ROM> c = cache.load("test_game_c.ch8");
+    ASSERT_NE(a, nullptr);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(cache.load("test_game_a.ch8"), a);
+    EXPECT_EQ(cache.load("missing.ch8"), nullptr);
+    EXPECT_EQ(cache.get_mappings(), 2u);
+    EXPECT_EQ(cache.get_hits(), 2u);
+    EXPECT_EQ(std::vector<uint8_t>(c->get_data(), c->get_data() + 300), other);
+
+    // The mapping outlives the file and the cache
+    remove("test_game_a.ch8");
+    remove("test_game_b.ch8");
+    remove("test_game_c.ch8");
+    EXPECT_EQ(std::vector<uint8_t>(a->get_data(), a->get_data() + 300), game);
+}
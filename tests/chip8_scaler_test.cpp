@@ -0,0 +1,63 @@
+#include "chip8_scaler.h"
+
+#include "gtest/gtest.h"
+
+/**
+ * Scales a framebuffer one target pixel at a time.
+ */
+static std::vector<uint32_t> reference_scale(const uint64_t *frame,
+                                             int width, int height,
+                                             int stride, uint32_t border) {
+    std::vector<uint32_t> pixels(stride * height, border);
+    int pixel_width = width / SCREEN_WIDTH;
+    int pixel_height = height / SCREEN_HEIGHT;
+    for (int y = 0; y < SCREEN_HEIGHT * pixel_height; y++) {
+        for (int x = 0; x < SCREEN_WIDTH * pixel_width; x++) {
+            pixels[y * stride + x] =
+                    frame_pixel(frame, x / pixel_width, y / pixel_height)
+                            ? 0xFFFFFF
+                            : 0x000080;
+        }
+    }
+    return pixels;
+}
+
+TEST(CHIP8ScalerTests, TestScaleFrame) {
+    uint64_t frame[SCREEN_HEIGHT];
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        frame[y] = 0x8000000000000001 | (uint64_t) 0xF0F0 << y;
+    }
+
+    // Sizes that are and are not multiples of the screen, with padded rows
+    WORK_STEALING_POOL pool(4);
+    int sizes[][3] = {{64, 32, 64}, {640, 480, 640}, {650, 490, 700},
+                      {1920, 1080, 1920}, {33, 480, 40}};
+    for (auto &size : sizes) {
+        int width = size[0], height = size[1], stride = size[2];
+        std::vector<uint32_t> expected =
+                reference_scale(frame, width, height, stride, 0x123456);
+        std::vector<uint32_t> single(stride * height, 0x123456);
+        std::vector<uint32_t> banded(stride * height, 0x123456);
+        scale_frame(frame, 0x000080, 0xFFFFFF, single.data(), width, height,
+                    stride * sizeof(uint32_t));
+        scale_frame(frame, 0x000080, 0xFFFFFF, banded.data(), width, height,
+                    stride * sizeof(uint32_t), &pool);
+        EXPECT_EQ(single, expected) << width << "x" << height;
+        EXPECT_EQ(banded, expected) << width << "x" << height;
+    }
+
+    // Palette indices scale the same as the framebuffer they show
+    uint8_t indices[SCREEN_HEIGHT][SCREEN_WIDTH];
+    uint32_t palette[2] = {0x000080, 0xFFFFFF};
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            indices[y][x] = frame_pixel(frame, x, y);
+        }
+    }
+    std::vector<uint32_t> from_frame(700 * 490), from_indices(700 * 490);
+    scale_frame(frame, 0x000080, 0xFFFFFF, from_frame.data(), 650, 490,
+                700 * sizeof(uint32_t));
+    scale_pixels(indices, palette, from_indices.data(), 650, 490,
+                 700 * sizeof(uint32_t), &pool);
+    EXPECT_EQ(from_frame, from_indices);
+}
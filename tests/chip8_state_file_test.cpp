@@ -0,0 +1,152 @@
+#include "chip8_state_file.h"
+
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * Compresses a buffer and checks it decompresses to the same bytes.
+ * @return Compressed bytes
+ */
+static size_t lz_round_trip(const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> packed(LZ_MAX_COMPRESSED_SIZE(data.size()));
+    std::vector<uint8_t> unpacked(data.size());
+    size_t size = lz_compress(data.data(), data.size(), packed.data(),
+                              packed.size());
+    EXPECT_GT(size, 0u);
+    EXPECT_EQ(lz_decompress(packed.data(), size, unpacked.data(),
+                            unpacked.size()),
+              data.size());
+    EXPECT_EQ(unpacked, data);
+    return size;
+}
+
+TEST(CHIP8StateFileTests, TestChecksumAndCodec) {
+    const char check[] = "123456789";
+    EXPECT_EQ(state_crc32((const uint8_t *) check, strlen(check)), 0xCBF43926u);
+    EXPECT_EQ(state_crc32(nullptr, 0), 0u);
+
+    // Zeroes and repeats shrink, random bytes grow by at most the bound
+    std::mt19937 gen(5);
+    std::vector<uint8_t> zeroes(MEM_SIZE, 0), noise(MEM_SIZE);
+    for (uint8_t &byte : noise) {
+        byte = (uint8_t) gen();
+    }
+    EXPECT_LT(lz_round_trip(zeroes), 32u);
+    EXPECT_LE(lz_round_trip(noise), LZ_MAX_COMPRESSED_SIZE(noise.size()));
+    EXPECT_EQ(lz_round_trip({}), 1u);
+    lz_round_trip({1, 2, 3});
+    lz_round_trip({7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7});
+
+    std::ifstream rom("test_opcode.ch8", std::ios::binary);
+    std::vector<uint8_t> program((std::istreambuf_iterator<char>(rom)),
+                                 std::istreambuf_iterator<char>());
+    ASSERT_GT(program.size(), 0u);
+    program.resize(MEM_SIZE - 0x200, 0);
+    EXPECT_LT(lz_round_trip(program), program.size() / 4);
+
+    // Truncated lengths, bad offsets and full buffers are rejected
+    std::vector<uint8_t> packed(LZ_MAX_COMPRESSED_SIZE(MEM_SIZE));
+    std::vector<uint8_t> out(MEM_SIZE);
+    size_t size = lz_compress(zeroes.data(), zeroes.size(), packed.data(),
+                              packed.size());
+    EXPECT_EQ(lz_decompress(packed.data(), size - 2, out.data(), out.size()),
+              0u);
+    EXPECT_EQ(lz_decompress(packed.data(), size, out.data(), out.size() - 1),
+              0u);
+    const uint8_t far_match[] = {0x10, 0xAA, 0x02, 0x00, 0x00};
+    EXPECT_EQ(lz_decompress(far_match, sizeof(far_match), out.data(),
+                            out.size()),
+              0u);
+    EXPECT_EQ(lz_compress(noise.data(), noise.size(), packed.data(), 100), 0u);
+}
+
+TEST(CHIP8StateFileTests, TestPackAndConvert) {
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE()), loaded(new CHIP8CORE());
+    ASSERT_EQ(core->load_program("test_opcode.ch8"), true);
+    for (int step = 0; step < 400; step++) {
+        core->step();
+    }
+    core->set_key_status(3, true);
+
+    // Packing keeps every byte serialize wrote and fits in a kilobyte
+    uint8_t state[SERIALIZED_STATE_SIZE], unpacked[SERIALIZED_STATE_SIZE];
+    uint8_t file[STATE_FILE_MAX_SIZE];
+    ASSERT_EQ(core->serialize(state, sizeof(state)), SERIALIZED_STATE_SIZE);
+    size_t size = pack_state(state, {0x102030, 0xA0B0C0}, file, sizeof(file));
+    ASSERT_GT(size, 0u);
+    EXPECT_LT(size, 1024u);
+    STATE_PALETTE palette;
+    ASSERT_EQ(unpack_state(file, size, unpacked, palette), true);
+    EXPECT_EQ(memcmp(unpacked, state, sizeof(state)), 0);
+    EXPECT_EQ(palette.background, 0x102030u);
+    EXPECT_EQ(palette.foreground, 0xA0B0C0u);
+    ASSERT_EQ(loaded->deserialize(unpacked, sizeof(unpacked)), true);
+    EXPECT_EQ(memcmp(loaded->get_frame_buffer(), core->get_frame_buffer(),
+                     SCREEN_HEIGHT * sizeof(uint64_t)),
+              0);
+    EXPECT_EQ(pack_state(state, palette, file, 100), 0u);
+
+    // Any flipped bit or truncation fails the checksum or size checks
+    for (size_t i : {size_t(2), size_t(20), size - 1}) {
+        file[i] ^= 0x10;
+        EXPECT_EQ(unpack_state(file, size, unpacked, palette), false);
+        file[i] ^= 0x10;
+    }
+    EXPECT_EQ(unpack_state(file, size - 1, unpacked, palette), false);
+    EXPECT_EQ(unpack_state(state, sizeof(state), unpacked, palette), false);
+
+    // Legacy files store big endian registers and a color per pixel
+    std::vector<uint8_t> legacy(LEGACY_STATE_SIZE, 0);
+    const MACHINE_STATE &machine = core->get_state();
+    legacy[0] = machine.REGS.PC >> 8, legacy[1] = (uint8_t) machine.REGS.PC;
+    legacy[2] = machine.REGS.SP;
+    legacy[3] = machine.REGS.I >> 8, legacy[4] = (uint8_t) machine.REGS.I;
+    legacy[5] = machine.REGS.ST, legacy[6] = machine.REGS.DT;
+    memcpy(&legacy[LEGACY_V_OFFSET], machine.REGS.V, REG_SIZE);
+    for (int i = 0; i < STACK_SIZE; i++) {
+        legacy[LEGACY_STACK_OFFSET + 2 * i] = machine.REGS.STACK[i] >> 8;
+        legacy[LEGACY_STACK_OFFSET + 2 * i + 1] =
+                (uint8_t) machine.REGS.STACK[i];
+    }
+    memcpy(&legacy[LEGACY_MEM_OFFSET], machine.MEM, MEM_SIZE);
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) {
+        bool lit = frame_pixel(machine.FRAME, i % SCREEN_WIDTH,
+                               i / SCREEN_WIDTH);
+        legacy[LEGACY_PIX_OFFSET + 4 * i + 1] = lit ? 0xFF : 0x12;
+        legacy[LEGACY_PIX_OFFSET + 4 * i + 3] = lit ? 0xFF : 0x34;
+    }
+
+    std::unique_ptr<MACHINE_STATE> converted(new MACHINE_STATE());
+    ASSERT_EQ(convert_legacy_state(legacy.data(), legacy.size(), 0xFF00FF,
+                                   *converted, palette),
+              true);
+    EXPECT_EQ(palette.foreground, 0xFF00FFu);
+    EXPECT_EQ(palette.background, 0x120034u);
+    EXPECT_EQ(converted->REGS.PC, machine.REGS.PC);
+    EXPECT_EQ(converted->REGS.I, machine.REGS.I);
+    EXPECT_EQ(converted->REGS.SP, machine.REGS.SP);
+    EXPECT_EQ(memcmp(converted->REGS.V, machine.REGS.V, REG_SIZE), 0);
+    EXPECT_EQ(memcmp(converted->REGS.STACK, machine.REGS.STACK,
+                     sizeof(machine.REGS.STACK)),
+              0);
+    EXPECT_EQ(memcmp(converted->MEM, machine.MEM, MEM_SIZE), 0);
+    EXPECT_EQ(memcmp(converted->FRAME, machine.FRAME, sizeof(machine.FRAME)),
+              0);
+    EXPECT_EQ(converted->REGS.KEYS[3], false);
+    EXPECT_EQ(converted->REGS.RNG, rng_seed_state(DEFAULT_RNG_SEED));
+
+    legacy[2] = STACK_SIZE;
+    EXPECT_EQ(convert_legacy_state(legacy.data(), legacy.size(), 0xFF00FF,
+                                   *converted, palette),
+              false);
+    EXPECT_EQ(convert_legacy_state(legacy.data(), legacy.size() - 1, 0xFF00FF,
+                                   *converted, palette),
+              false);
+}
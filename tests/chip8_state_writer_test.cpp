@@ -0,0 +1,85 @@
+#include "chip8_state_writer.h"
+
+#include <fstream>
+#include <iterator>
+
+#include "gtest/gtest.h"
+
+/**
+ * Reads a whole file.
+ */
+static std::vector<uint8_t> read_file(const char *path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+}
+
+TEST(CHIP8StateWriterTests, TestCoalescedSaves) {
+    STATE_WRITER writer;
+    SAVE_RESULT result;
+    EXPECT_EQ(writer.poll(result), false);
+
+    // A burst of saves ends with the newest one on disk, every save is
+    // either written or replaced by a later one
+    const int num_saves = 200;
+    uint64_t last_ticket = 0;
+    for (int i = 0; i < num_saves; i++) {
+        uint64_t ticket = writer.save("test_writer_a.sv",
+                                      std::vector<uint8_t>(500, (uint8_t) i));
+        EXPECT_GT(ticket, last_ticket);
+        last_ticket = ticket;
+        writer.save("test_writer_b.sv", std::vector<uint8_t>(10, 7));
+    }
+    std::vector<uint8_t> pending;
+    if (writer.get_pending("test_writer_a.sv", pending)) {
+        EXPECT_EQ(pending, std::vector<uint8_t>(500, num_saves - 1));
+    }
+    EXPECT_EQ(writer.get_pending("test_writer_c.sv", pending), false);
+    writer.flush();
+    EXPECT_EQ(writer.get_pending("test_writer_a.sv", pending), false);
+
+    uint64_t written = 0, saves = 0, newest = 0;
+    while (writer.poll(result)) {
+        EXPECT_EQ(result.success, true) << result.error;
+        written++;
+        saves += result.saves;
+        if (result.path == "test_writer_a.sv") {
+            newest = result.ticket;
+        }
+    }
+    EXPECT_EQ(saves, 2u * num_saves);
+    EXPECT_EQ(written + writer.get_coalesced(), 2u * num_saves);
+    EXPECT_EQ(newest, last_ticket);
+    EXPECT_EQ(read_file("test_writer_a.sv"),
+              std::vector<uint8_t>(500, num_saves - 1));
+    EXPECT_EQ(read_file("test_writer_b.sv"), std::vector<uint8_t>(10, 7));
+    remove("test_writer_a.sv");
+    remove("test_writer_b.sv");
+}
+
+TEST(CHIP8StateWriterTests, TestFailedSave) {
+    // Failures are reported and leave no temporary file behind
+    STATE_WRITER writer;
+    uint64_t ticket =
+            writer.save("missing_dir/test.sv", std::vector<uint8_t>(4, 1));
+    writer.flush();
+    SAVE_RESULT result;
+    ASSERT_EQ(writer.poll(result), true);
+    EXPECT_EQ(result.ticket, ticket);
+    EXPECT_EQ(result.success, false);
+    EXPECT_NE(result.error.find("missing_dir/test.sv.tmp"), std::string::npos);
+
+    std::string error;
+    EXPECT_EQ(write_file_durably("test_durable.sv", nullptr, 0, error), true);
+    EXPECT_EQ(read_file("test_durable.sv").size(), 0u);
+    EXPECT_EQ(read_file("test_durable.sv.tmp").size(), 0u);
+    remove("test_durable.sv");
+
+    // Queued writes are finished by the destructor
+    {
+        STATE_WRITER closing;
+        closing.save("test_closing.sv", std::vector<uint8_t>(3, 9));
+    }
+    EXPECT_EQ(read_file("test_closing.sv"), std::vector<uint8_t>(3, 9));
+    remove("test_closing.sv");
+}
@@ -32,7 +32,7 @@ TEST(CHIP8Tests, TestConstructor) {
     CHIP8 chip8 = CHIP8();
 
     EXPECT_EQ(chip8.get_quit(), false);
-    EXPECT_EQ(chip8.get_draw(), true);
+    EXPECT_EQ(chip8.get_instructions_per_frame(), DEFAULT_IPF);
     EXPECT_EQ(chip8.get_pc(), PC_START);
     EXPECT_EQ(chip8.get_sp(), 0xFF);
     EXPECT_EQ(chip8.get_index_reg(), 0);
@@ -49,7 +49,7 @@ TEST(CHIP8Tests, TestConstructor) {
         EXPECT_EQ(V[i], 0);
     }
 
-    uint8_t *MEM = chip8.get_mem();
+    const uint8_t *MEM = chip8.get_mem();
     for (int i = 0; i < MEM_SIZE; i++) {
         if (i < MAP_LENGTH) {
             EXPECT_EQ(MEM[i], SPRITE_MAP[i]);
@@ -59,6 +59,17 @@ TEST(CHIP8Tests, TestConstructor) {
     }
 }
 
+TEST(CHIP8Tests, TestInstructionsPerFrame) {
+    CHIP8 chip8 = CHIP8();
+
+    chip8.set_instructions_per_frame(500);
+    EXPECT_EQ(chip8.get_instructions_per_frame(), 500u);
+
+    // A frame always executes at least one instruction
+    chip8.set_instructions_per_frame(0);
+    EXPECT_EQ(chip8.get_instructions_per_frame(), 1u);
+}
+
 TEST(CHIP8Tests, DISABLED_TestInitComponents) {
     CHIP8 chip8 = CHIP8();
     EXPECT_EQ(chip8.init_video(), true);
@@ -95,7 +106,7 @@ TEST(CHIP8Tests, TestLoadProgram) {
 
     // Copy from the data array into memory, this can be skipped by having fread
     // read directly into the correct starting address of memory
-    uint8_t *MEM = chip8.get_mem();
+    const uint8_t *MEM = chip8.get_mem();
     for (int i = 0; i < MAX_PROG_SIZE; i++) {
         EXPECT_EQ(MEM[PC_START + i], program_data[i]);
     }
@@ -114,6 +125,23 @@ TEST(CHIP8Tests, DISABLED_TestSaveState) {
     EXPECT_EQ(chip8.load_state(state_path), true);
 }
 
+TEST(CHIP8Tests, DISABLED_TestQueueSaveState) {
+    CHIP8 chip8 = CHIP8();
+    EXPECT_EQ(chip8.init_video(), true);
+    EXPECT_EQ(chip8.init_audio(), true);
+
+    char test_rom_path[] = "test_opcode.ch8";
+    EXPECT_EQ(chip8.load_program(test_rom_path), true);
+
+    // A queued save can be loaded before and after it reached the file
+    const char state_path[] = "test_queue_save.sav";
+    EXPECT_GT(chip8.queue_save_state(state_path), 0u);
+    EXPECT_EQ(chip8.load_state(state_path), true);
+    chip8.flush_saves();
+    EXPECT_EQ(chip8.report_saves(), 0);
+    EXPECT_EQ(chip8.load_state(state_path), true);
+}
+
 TEST(CHIP8Tests, DISABLED_DISABLED_TestExecOp_00E0) {
     CHIP8 chip8 = CHIP8();
     EXPECT_EQ(chip8.init_video(), true);
@@ -572,14 +600,13 @@ TEST(CHIP8Tests, DISABLED_TestExecOp_Ex9E) {
     uint8_t *v = chip8.get_reg_file();
     v[x] = valx;
 
-    INPUT *input = chip8.get_input_device();
-    EXPECT_EQ(input->get_key_status(valx), false);
+    EXPECT_EQ(chip8.get_key_status(valx), false);
 
     chip8.exec_op(test_opcode);
     EXPECT_EQ(chip8.get_pc(), curr_pc + 2);
 
-    input->flip_key_status(valx);
-    EXPECT_EQ(input->get_key_status(valx), true);
+    chip8.set_key_status(valx, true);
+    EXPECT_EQ(chip8.get_key_status(valx), true);
 
     curr_pc = chip8.get_pc();
     chip8.exec_op(test_opcode);
@@ -601,14 +628,13 @@ TEST(CHIP8Tests, DISABLED_TestExecOp_ExA1) {
     uint8_t *v = chip8.get_reg_file();
     v[x] = valx;
 
-    INPUT *input = chip8.get_input_device();
-    EXPECT_EQ(input->get_key_status(valx), false);
+    EXPECT_EQ(chip8.get_key_status(valx), false);
 
     chip8.exec_op(test_opcode);
     EXPECT_EQ(chip8.get_pc(), curr_pc + 4);
 
-    input->flip_key_status(valx);
-    EXPECT_EQ(input->get_key_status(valx), true);
+    chip8.set_key_status(valx, true);
+    EXPECT_EQ(chip8.get_key_status(valx), true);
 
     curr_pc = chip8.get_pc();
     chip8.exec_op(test_opcode);
@@ -723,7 +749,7 @@ TEST(CHIP8Tests, DISABLED_TestExecOp_Fx33) {
     test_opcode = test_opcode | (x << 8);
 
     uint16_t curr_index_reg = chip8.get_index_reg();
-    uint8_t *curr_mem = chip8.get_mem();
+    const uint8_t *curr_mem = chip8.get_mem();
     chip8.exec_op(test_opcode);
     EXPECT_EQ(curr_mem[curr_index_reg], 1);
     EXPECT_EQ(curr_mem[curr_index_reg + 1], 2);
@@ -742,11 +768,11 @@ TEST(CHIP8Tests, DISABLED_TestExecOp_Fx55) {
     }
 
     uint16_t curr_index_reg = chip8.get_index_reg();
-    uint8_t *curr_mem = chip8.get_mem();
+    const uint8_t *curr_mem = chip8.get_mem();
     chip8.exec_op(test_opcode);
 
     for (uint8_t i = 0; i < REG_SIZE; i++) {
-        curr_mem[curr_index_reg + i] = i;
+        EXPECT_EQ(curr_mem[curr_index_reg + i], i);
     }
 }
 
@@ -758,11 +784,11 @@ TEST(CHIP8Tests, DISABLED_TestExecOp_Fx65) {
     uint16_t test_opcode = 0xFF65;
 
     uint16_t curr_index_reg = chip8.get_index_reg();
-    uint8_t *curr_mem = chip8.get_mem();
-
+    uint8_t values[REG_SIZE];
     for (uint8_t i = 0; i < REG_SIZE; i++) {
-        curr_mem[curr_index_reg + i] = i;
+        values[i] = i;
     }
+    chip8.write_mem(curr_index_reg, values, sizeof(values));
 
     chip8.exec_op(test_opcode);
 
@@ -12,6 +12,14 @@ TEST(VideoInitCheckerTests, TestChecks) {
     EXPECT_EQ(init_checker.check_sdl_create_window_code((SDL_Window *) window),
               true);
     EXPECT_EQ(init_checker.check_sdl_create_window_code(nullptr), false);
+    EXPECT_EQ(init_checker.check_sdl_create_renderer_code(
+                      (SDL_Renderer *) window),
+              true);
+    EXPECT_EQ(init_checker.check_sdl_create_renderer_code(nullptr), false);
+    EXPECT_EQ(init_checker.check_sdl_create_texture_code(
+                      (SDL_Texture *) window),
+              true);
+    EXPECT_EQ(init_checker.check_sdl_create_texture_code(nullptr), false);
 }
 
 TEST(VIDEOTests, TestConstructor) {
@@ -25,6 +33,69 @@ TEST(VIDEOTests, TestConstructor) {
     EXPECT_EQ(video.get_foreground_color(), WHITE);
 }
 
+TEST(VIDEOTests, TestDirtyRects) {
+    VIDEO video = VIDEO();
+    uint32_t pixel_width = video.get_pixel_width();
+    uint32_t pixel_height = video.get_pixel_height();
+    SDL_Rect rects[SCREEN_HEIGHT];
+
+    // Rows drawn with the same columns share a rectangle
+    video.mark_dirty(3, 1);
+    video.mark_dirty(5, 1);
+    video.mark_dirty(5, 2);
+    video.mark_dirty(3, 2);
+    video.mark_dirty(0, 7);
+    video.mark_dirty(SCREEN_WIDTH, 7);
+    ASSERT_EQ(video.get_dirty_rects(rects), 2);
+    EXPECT_EQ(rects[0].x, (int)(3 * pixel_width));
+    EXPECT_EQ(rects[0].y, (int) pixel_height);
+    EXPECT_EQ(rects[0].w, (int)(3 * pixel_width));
+    EXPECT_EQ(rects[0].h, (int)(2 * pixel_height));
+    EXPECT_EQ(rects[1].x, 0);
+    EXPECT_EQ(rects[1].y, (int)(7 * pixel_height));
+    EXPECT_EQ(rects[1].w, (int) pixel_width);
+    EXPECT_EQ(rects[1].h, (int) pixel_height);
+
+    // Marking everything drops the rectangles for a full update
+    video.mark_all_dirty();
+    EXPECT_EQ(video.get_dirty_rects(rects), 0);
+}
+
+TEST(VIDEOTests, TestDrawWithoutSurface) {
+    VIDEO video = VIDEO();
+    SDL_Rect rects[SCREEN_HEIGHT];
+    uint64_t frame[SCREEN_HEIGHT] = {};
+    frame[4] = (uint64_t) 1 << 63 | 1;
+
+    // Without a surface, as with the texture backend, only the pixel map
+    // and the areas to show are updated
+    video.clear();
+    video.draw_frame(frame);
+    uint8_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
+    EXPECT_EQ(video.get_vid_mem(), nullptr);
+    EXPECT_EQ(pix_map[4][0], PALETTE_FOREGROUND);
+    EXPECT_EQ(pix_map[4][SCREEN_WIDTH - 1], PALETTE_FOREGROUND);
+    EXPECT_EQ(pix_map[4][1], PALETTE_BACKGROUND);
+    ASSERT_EQ(video.get_dirty_rects(rects), 1);
+    EXPECT_EQ(rects[0].y, (int)(4 * video.get_pixel_height()));
+    EXPECT_EQ(rects[0].w, (int)(SCREEN_WIDTH * video.get_pixel_width()));
+
+    // Changing colors only changes the palette
+    video.set_color_scheme(0x123456, 0x654321);
+    EXPECT_EQ(pix_map[4][0], PALETTE_FOREGROUND);
+    EXPECT_EQ(video.get_palette()[PALETTE_FOREGROUND], 0x123456u);
+    EXPECT_EQ(video.get_palette()[PALETTE_BACKGROUND], 0x654321u);
+    EXPECT_EQ(video.get_foreground_color(), 0x123456u);
+
+    // Equal colors still tell lit and unlit pixels apart
+    video.set_color_scheme(0x123456, 0x123456);
+    EXPECT_EQ(video.xor_color(0, 4), true);
+    EXPECT_EQ(video.xor_color(1, 4), false);
+    EXPECT_EQ(pix_map[4][0], PALETTE_BACKGROUND);
+    EXPECT_EQ(pix_map[4][1], PALETTE_FOREGROUND);
+    EXPECT_EQ(video.get_color(0x12, 0x34, 0x56), 0x123456u);
+}
+
 TEST(VIDEOTests, DISABLED_TestInit) {
     VIDEO video = VIDEO();
 
@@ -49,11 +120,11 @@ TEST(VIDEOTests, DISABLED_TestClear) {
     // Check that pixel map and video memory initialized to background color
     uint32_t bg_color = video.get_background_color();
     uint32_t *vid_mem = video.get_vid_mem();
-    uint32_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
+    uint8_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             EXPECT_EQ(vid_mem[y * SCREEN_WIDTH + x], bg_color);
-            EXPECT_EQ(pix_map[y][x], bg_color);
+            EXPECT_EQ(pix_map[y][x], PALETTE_BACKGROUND);
         }
     }
     for (int y = 0; y < WINDOW_HEIGHT; y++) {
@@ -115,20 +186,18 @@ TEST(VIDEOTests, DISABLED_TestXorColor) {
     EXPECT_EQ(video.xor_color(SCREEN_WIDTH, SCREEN_HEIGHT - 1), false);
     EXPECT_EQ(video.xor_color(SCREEN_WIDTH, SCREEN_HEIGHT), false);
 
-    uint32_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
-    uint32_t fg_color = video.get_foreground_color();
-    uint32_t bg_color = video.get_background_color();
+    uint8_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
 
     // Pixels are initially background color so expect false
     uint8_t test_x = 0;
     uint8_t test_y = 0;
-    EXPECT_EQ(pix_map[test_y][test_x], bg_color);
+    EXPECT_EQ(pix_map[test_y][test_x], PALETTE_BACKGROUND);
     EXPECT_EQ(video.xor_color(test_x, test_y), false);
-    EXPECT_EQ(pix_map[test_y][test_x], fg_color);
+    EXPECT_EQ(pix_map[test_y][test_x], PALETTE_FOREGROUND);
 
     // When XORing a foreground color we return true
     EXPECT_EQ(video.xor_color(test_x, test_y), true);
-    EXPECT_EQ(pix_map[test_y][test_x], bg_color);
+    EXPECT_EQ(pix_map[test_y][test_x], PALETTE_BACKGROUND);
 }
 
 TEST(VIDEOTests, DISABLED_TestDrawPixMap) {
@@ -136,7 +205,7 @@ TEST(VIDEOTests, DISABLED_TestDrawPixMap) {
     video.init();
     video.clear();
 
-    uint32_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
+    uint8_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
 
     uint8_t test_x = 0;
     uint8_t test_y = 0;
@@ -168,29 +237,26 @@ TEST(VIDEOTests, DISABLED_TestRandColorScheme) {
     video.init();
     video.clear();
 
-    uint32_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
-    uint32_t fg_color = video.get_foreground_color();
+    uint8_t(*pix_map)[SCREEN_WIDTH] = video.get_pix_map();
     uint32_t bg_color = video.get_background_color();
 
     // Pixels are initially background color so expect false
     uint8_t test_x = 0;
     uint8_t test_y = 0;
-    EXPECT_EQ(pix_map[test_y][test_x], bg_color);
+    EXPECT_EQ(pix_map[test_y][test_x], PALETTE_BACKGROUND);
     EXPECT_EQ(video.xor_color(test_x, test_y), false);
-    EXPECT_EQ(pix_map[test_y][test_x], fg_color);
+    EXPECT_EQ(pix_map[test_y][test_x], PALETTE_FOREGROUND);
 
     // Change color scheme
     video.rand_color_scheme();
 
-    // Check that colors updated in pixel map
-    uint32_t new_fg_color = video.get_foreground_color();
-    uint32_t new_bg_color = video.get_background_color();
+    // Check that the pixel map keeps its palette indices
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
             if ((x == test_x) && (y == test_y)) {
-                EXPECT_EQ(pix_map[y][x], new_fg_color);
+                EXPECT_EQ(pix_map[y][x], PALETTE_FOREGROUND);
             } else {
-                EXPECT_EQ(pix_map[y][x], new_bg_color);
+                EXPECT_EQ(pix_map[y][x], PALETTE_BACKGROUND);
             }
         }
     }
@@ -217,7 +283,7 @@ TEST(VIDEOTests, DISABLED_TestRandColorScheme) {
     EXPECT_EQ(video.xor_color(test_x, test_y), true);
     for (int y = 0; y < SCREEN_HEIGHT; y++) {
         for (int x = 0; x < SCREEN_WIDTH; x++) {
-            EXPECT_EQ(pix_map[y][x], new_bg_color);
+            EXPECT_EQ(pix_map[y][x], PALETTE_BACKGROUND);
         }
     }
 
@@ -0,0 +1,578 @@
+/**
+ * Ahead-of-time recompiler for CHIP 8 ROMs.  Follows the control flow of a
+ * ROM from 0x200 and writes a C++ translation unit defining an AOT_MODULE
+ * that CHIP8AOT runs, plus a header declaring it.
+ *
+ * Usage: chip8_aot <rom.ch8> <name> <output.cpp> <output.h>
+ */
+#include <ctype.h>
+#include <stdarg.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "chip8_core.h"
+
+/**
+ * Everything the recompiler knows about a ROM.
+ */
+struct PROGRAM {
+    std::vector<uint8_t> rom;  // ROM image, loaded at PC_START
+    std::set<uint16_t> leaders;  // Addresses that start a block
+};
+
+/**
+ * Determines if both bytes of an instruction lie inside the ROM image.
+ * @param program The ROM being recompiled
+ * @param addr Address of the instruction
+ * @return Boolean indicating if the instruction can be recompiled
+ */
+static bool in_rom(const PROGRAM &program, uint32_t addr) {
+    return addr >= PC_START && addr + 1 < PC_START + program.rom.size();
+}
+
+/**
+ * Reads the instruction at an address of the ROM image.
+ * @param program The ROM being recompiled
+ * @param addr Address of the instruction, inside the ROM
+ * @return The decoded instruction
+ */
+static DECODED_OP fetch(const PROGRAM &program, uint16_t addr) {
+    const uint8_t *bytes = &program.rom[addr - PC_START];
+    return decode_op((uint16_t) bytes[0] << 8 | bytes[1]);
+}
+
+/**
+ * Finds every block start reachable from PC_START by following jumps, calls,
+ * return sites, both sides of every skip and the jump tables of Bnnn.
+ * @param program The ROM being recompiled, leaders gets filled
+ */
+static void find_leaders(PROGRAM &program) {
+    std::vector<uint16_t> worklist = {PC_START};
+    std::set<uint16_t> visited;
+    auto add_leader = [&](uint32_t addr) {
+        if (in_rom(program, addr) && program.leaders.insert(addr).second) {
+            worklist.push_back(addr);
+        }
+    };
+    program.leaders.insert(PC_START);
+
+    while (!worklist.empty()) {
+        uint16_t pc = worklist.back();
+        worklist.pop_back();
+        for (; in_rom(program, pc) && visited.insert(pc).second; pc += 2) {
+            DECODED_OP op = fetch(program, pc);
+            bool ends = true;
+            switch (op.op) {
+                case OP_JP:
+                    add_leader(op.nnn);
+                    break;
+                case OP_CALL:
+                    add_leader(op.nnn);
+                    add_leader(pc + 2);
+                    break;
+                case OP_RET:
+                    break;
+                case OP_JP_V0:
+                    // Bnnn usually indexes a table of jumps at nnn, take the
+                    // table entries and the first instruction after it
+                    for (uint32_t entry = op.nnn; in_rom(program, entry);
+                         entry += 2) {
+                        add_leader(entry);
+                        if (fetch(program, entry).op != OP_JP) {
+                            break;
+                        }
+                    }
+                    break;
+                case OP_SE_VX_KK:
+                case OP_SNE_VX_KK:
+                case OP_SE_VX_VY:
+                case OP_SNE_VX_VY:
+                case OP_SKP:
+                case OP_SKNP:
+                    add_leader(pc + 2);
+                    add_leader(pc + 4);
+                    break;
+                case OP_LD_VX_K:
+                    // Re-executed until a key is pressed
+                    add_leader(pc);
+                    add_leader(pc + 2);
+                    break;
+                case OP_LD_B_VX:
+                case OP_LD_MEM_VX:
+                    // The store may have modified the code that follows
+                    add_leader(pc + 2);
+                    break;
+                default:
+                    ends = false;
+                    break;
+            }
+            if (ends) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Returns the statement continuing execution at an address, a direct goto
+ * when the address starts a recompiled block.
+ * @param program The ROM being recompiled
+ * @param addr Address execution continues at
+ * @return C++ statement
+ */
+static std::string jump(const PROGRAM &program, uint32_t addr) {
+    char text[64];
+    if (program.leaders.count(addr)) {
+        snprintf(text, sizeof(text), "goto L_%03X;", addr);
+    } else {
+        snprintf(text, sizeof(text), "{ pc = 0x%03X; goto dispatch; }",
+                 addr & 0xFFFF);
+    }
+    return text;
+}
+
+/**
+ * Formats a line of generated code.
+ */
+static std::string line(const char *format, ...)
+        __attribute__((format(printf, 1, 2)));
+static std::string line(const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    return std::string("    ") + text + "\n";
+}
+
+/**
+ * Emits the statements of one instruction, mirroring the opcode handlers of
+ * CHIP8CORE on local copies of V and I.
+ * @param program The ROM being recompiled
+ * @param addr Address of the instruction
+ * @param op The decoded instruction
+ * @return C++ statements
+ */
+static std::string emit_op(const PROGRAM &program, uint16_t addr,
+                           const DECODED_OP &op) {
+    uint16_t opcode = (uint16_t) program.rom[addr - PC_START] << 8 |
+                      program.rom[addr - PC_START + 1];
+    int x = op.x, y = op.y, kk = op.kk, nnn = op.nnn;
+    std::string next = jump(program, addr + 2);
+    std::string skip = jump(program, addr + 4);
+    std::string out;
+    switch (op.op) {
+        case OP_NOP:
+            break;
+        case OP_CLS:
+            out += line("core.clear_screen();");
+            break;
+        case OP_RET:
+            out += line("pc = stack[sp];");
+            out += line("sp -= 1;");
+            out += line("goto dispatch;");
+            break;
+        case OP_JP:
+            out += line("%s", jump(program, nnn).c_str());
+            break;
+        case OP_CALL:
+            out += line("sp += 1;");
+            out += line("stack[sp] = 0x%03X;", addr + 2);
+            out += line("%s", jump(program, nnn).c_str());
+            break;
+        case OP_SE_VX_KK:
+            out += line("if (v[%d] == 0x%02X) %s", x, kk, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_SNE_VX_KK:
+            out += line("if (v[%d] != 0x%02X) %s", x, kk, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_SE_VX_VY:
+            out += line("if (v[%d] == v[%d]) %s", x, y, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_SNE_VX_VY:
+            out += line("if (v[%d] != v[%d]) %s", x, y, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_LD_VX_KK:
+            out += line("v[%d] = 0x%02X;", x, kk);
+            break;
+        case OP_ADD_VX_KK:
+            out += line("v[%d] += 0x%02X;", x, kk);
+            break;
+        case OP_LD_VX_VY:
+            out += line("v[%d] = v[%d];", x, y);
+            break;
+        case OP_OR:
+            out += line("v[%d] |= v[%d];", x, y);
+            break;
+        case OP_AND:
+            out += line("v[%d] &= v[%d];", x, y);
+            break;
+        case OP_XOR:
+            out += line("v[%d] ^= v[%d];", x, y);
+            break;
+        case OP_ADD_VX_VY:
+            out += line("v[15] = ((v[%d] + v[%d]) > 255) ? 1 : 0;", x, y);
+            out += line("v[%d] += v[%d];", x, y);
+            break;
+        case OP_SUB:
+            out += line("v[15] = (v[%d] > v[%d]) ? 1 : 0;", x, y);
+            out += line("v[%d] -= v[%d];", x, y);
+            break;
+        case OP_SHR:
+            out += line("v[15] = v[%d] & 0x1;", x);
+            out += line("v[%d] = v[%d] >> 1;", x, x);
+            break;
+        case OP_SUBN:
+            out += line("v[15] = (v[%d] > v[%d]) ? 1 : 0;", y, x);
+            out += line("v[%d] = v[%d] - v[%d];", x, y, x);
+            break;
+        case OP_SHL:
+            out += line("v[15] = (v[%d] & 0x80) ? 1 : 0;", x);
+            out += line("v[%d] = v[%d] << 1;", x, x);
+            break;
+        case OP_LD_I:
+            out += line("i = 0x%03X;", nnn);
+            break;
+        case OP_RND:
+            // Draws from the core's random number generator
+            out += line("SYNC_OUT();");
+            out += line("core.exec_op(0x%04X);", opcode);
+            out += line("SYNC_IN();");
+            break;
+        case OP_DRW:
+            out += line("AOT_ACCESS::I(core) = i;");
+            out += line("core.draw_sprite(v[%d], v[%d], %d);", x, y, kk & 0xF);
+            out += line("v[15] = AOT_ACCESS::V(core)[15];");
+            break;
+        case OP_SKP:
+            out += line("if (core.get_key_status(v[%d])) %s", x, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_SKNP:
+            out += line("if (!core.get_key_status(v[%d])) %s", x, skip.c_str());
+            out += line("%s", next.c_str());
+            break;
+        case OP_LD_VX_DT:
+            out += line("v[%d] = dt;", x);
+            break;
+        case OP_LD_VX_K:
+            out += line("SYNC_OUT();");
+            out += line("AOT_ACCESS::PC(core) = 0x%03X;", addr);
+            out += line("core.exec_op(0x%04X);", opcode);
+            out += line("SYNC_IN();");
+            out += line("pc = AOT_ACCESS::PC(core);");
+            out += line("goto dispatch;");
+            break;
+        case OP_LD_DT_VX:
+            out += line("dt = v[%d];", x);
+            break;
+        case OP_LD_ST_VX:
+            out += line("st = v[%d];", x);
+            break;
+        case OP_ADD_I_VX:
+            out += line("i += v[%d];", x);
+            break;
+        case OP_LD_F_VX:
+            out += line("i = 5 * v[%d];", x);
+            break;
+        case OP_LD_B_VX:
+            out += line("mem[i] = v[%d] / 100;", x);
+            out += line("mem[i + 1] = (v[%d] %% 100) / 10;", x);
+            out += line("mem[i + 2] = v[%d] %% 10;", x);
+            out += line("core.invalidate_code(i, 3);");
+            out += line("%s", next.c_str());
+            break;
+        case OP_LD_MEM_VX:
+            for (int k = 0; k <= x; k++) {
+                out += line("mem[i + %d] = v[%d];", k, k);
+            }
+            out += line("core.invalidate_code(i, %d);", x + 1);
+            out += line("%s", next.c_str());
+            break;
+        case OP_LD_VX_MEM:
+            for (int k = 0; k <= x; k++) {
+                out += line("v[%d] = mem[i + %d];", k, k);
+            }
+            break;
+    }
+    return out;
+}
+
+/**
+ * Determines if execution can not continue past an instruction in the same
+ * block, because it always transfers control.
+ * @param op The decoded instruction
+ * @return Boolean indicating if the instruction ends its block
+ */
+static bool ends_block(const DECODED_OP &op) {
+    switch (op.op) {
+        case OP_RET:
+        case OP_JP:
+        case OP_CALL:
+        case OP_SE_VX_KK:
+        case OP_SNE_VX_KK:
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+        case OP_SKP:
+        case OP_SKNP:
+        case OP_LD_VX_K:
+        case OP_LD_B_VX:
+        case OP_LD_MEM_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Determines if a block has the shape of a loop CHIP8CORE fast-forwards
+ * while idle: a jump to itself, Fx07 / 3xkk / 1nnn or Fx07 / 4xkk / 1nnn
+ * polling the delay timer, or Ex9E / 1nnn or ExA1 / 1nnn polling a key.
+ * Whether the loop repeats depends on the timers and keys when it runs.
+ * @param program The ROM being recompiled
+ * @param start Leader address of the block
+ * @return Boolean indicating if the block may be an idle loop
+ */
+static bool polls(const PROGRAM &program, uint16_t start) {
+    auto jumps_back = [&](int i) {
+        uint16_t pc = start + 2 * i;
+        return in_rom(program, pc) && fetch(program, pc).op == OP_JP &&
+               fetch(program, pc).nnn == start;
+    };
+    switch (fetch(program, start).op) {
+        case OP_JP:
+            return jumps_back(0);
+        case OP_LD_VX_DT: {
+            if (!in_rom(program, start + 2)) {
+                return false;
+            }
+            DECODED_OP skip = fetch(program, start + 2);
+            return (skip.op == OP_SE_VX_KK || skip.op == OP_SNE_VX_KK) &&
+                   skip.x == fetch(program, start).x && jumps_back(2);
+        }
+        case OP_SKP:
+        case OP_SKNP:
+            return jumps_back(1);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Emits the block starting at a leader: a budget and self-modification check
+ * followed by its instructions.  Blocks that may be idle loops first return
+ * to CHIP8AOT::run while the core is idle, which fast-forwards them.
+ * @param program The ROM being recompiled
+ * @param start Leader address of the block
+ * @return C++ code of the block
+ */
+static std::string emit_block(const PROGRAM &program, uint16_t start) {
+    std::string body;
+    int length = 0;
+    uint16_t pc = start;
+    bool ended = false;
+    while (!ended) {
+        if (length > 0 && program.leaders.count(pc)) {
+            // Fall through into the next block
+            body += line("%s", jump(program, pc).c_str());
+            break;
+        }
+        if (!in_rom(program, pc)) {
+            body += line("%s", jump(program, pc).c_str());
+            break;
+        }
+
+        DECODED_OP op = fetch(program, pc);
+        if (op.op == OP_JP_V0) {
+            // Indirect jump, handed to the interpreter
+            body += line("pc = 0x%03X;", pc);
+            body += line("goto leave;");
+            break;
+        }
+        body += emit_op(program, pc, op);
+        ended = ends_block(op);
+        length++;
+        pc += 2;
+    }
+
+    std::string out;
+    char label[32];
+    snprintf(label, sizeof(label), "L_%03X:\n", start);
+    out += label;
+    if (length > 0 && polls(program, start)) {
+        out += line("SYNC_OUT();");
+        out += line("AOT_ACCESS::PC(core) = 0x%03X;", start);
+        out += line("if (core.is_idle()) {");
+        out += line("    pc = 0x%03X;", start);
+        out += line("    goto leave;");
+        out += line("}");
+    }
+    if (length > 0) {
+        out += line("if (max_steps - steps < %d || !core.block_intact(0x%03X, "
+                    "%d)) {",
+                    length, start, 2 * length);
+        out += line("    pc = 0x%03X;", start);
+        out += line("    goto leave;");
+        out += line("}");
+        out += line("steps += %d;", length);
+    }
+    return out + body;
+}
+
+/**
+ * Splits blocks longer than MAX_BLOCK_LENGTH by adding leaders, so a block
+ * never spans more than two code pages.
+ * @param program The ROM being recompiled, leaders gets extended
+ */
+static void split_long_blocks(PROGRAM &program) {
+    for (auto it = program.leaders.begin(); it != program.leaders.end(); ++it) {
+        uint16_t pc = *it;
+        for (int length = 0; in_rom(program, pc); length++, pc += 2) {
+            if (length > 0 && program.leaders.count(pc)) {
+                break;
+            }
+            if (length == MAX_BLOCK_LENGTH) {
+                program.leaders.insert(pc);
+                break;
+            }
+            DECODED_OP op = fetch(program, pc);
+            if (op.op == OP_JP_V0 || ends_block(op)) {
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Writes the translation unit of a recompiled ROM.
+ * @param program The ROM being recompiled
+ * @param name Name of the module
+ * @param rom_path Path of the ROM, for the header comment
+ * @param file Output file
+ */
+static void write_source(const PROGRAM &program, const std::string &name,
+                         const char *rom_path, FILE *file) {
+    fprintf(file, "// Generated by chip8_aot from %s, do not edit.\n",
+            rom_path);
+    fprintf(file, "#include \"aot_%s.h\"\n\n", name.c_str());
+
+    fprintf(file, "static const uint8_t ROM[] = {");
+    for (size_t i = 0; i < program.rom.size(); i++) {
+        fprintf(file, "%s0x%02X,", (i % 12) ? " " : "\n    ", program.rom[i]);
+    }
+    fprintf(file, "\n};\n\n");
+
+    fprintf(file, "#define SYNC_OUT()                                      \\\n"
+                  "    for (int k = 0; k < REG_SIZE; k++) {             \\\n"
+                  "        AOT_ACCESS::V(core)[k] = v[k];               \\\n"
+                  "    }                                                \\\n"
+                  "    AOT_ACCESS::I(core) = i\n"
+                  "#define SYNC_IN()                                       \\\n"
+                  "    for (int k = 0; k < REG_SIZE; k++) {             \\\n"
+                  "        v[k] = AOT_ACCESS::V(core)[k];               \\\n"
+                  "    }                                                \\\n"
+                  "    i = AOT_ACCESS::I(core)\n\n");
+
+    fprintf(file, "static uint32_t run_%s(CHIP8AOT &core, uint32_t max_steps) "
+                  "{\n",
+            name.c_str());
+    fprintf(file, "    uint8_t v[REG_SIZE];\n"
+                  "    uint16_t i;\n"
+                  "    SYNC_IN();\n"
+                  "    uint16_t pc = AOT_ACCESS::PC(core);\n"
+                  "    uint8_t &sp = AOT_ACCESS::SP(core);\n"
+                  "    uint16_t *stack = AOT_ACCESS::STACK(core);\n"
+                  "    uint8_t *mem = AOT_ACCESS::MEM(core);\n"
+                  "    uint8_t &dt = AOT_ACCESS::DT(core);\n"
+                  "    uint8_t &st = AOT_ACCESS::ST(core);\n"
+                  "    uint32_t steps = 0;\n"
+                  "    (void) sp, (void) stack, (void) mem, (void) dt, "
+                  "(void) st;\n\n");
+
+    // Only computed jumps return to the switch, a ROM without them would
+    // leave the label unused
+    std::string blocks;
+    for (uint16_t leader : program.leaders) {
+        blocks += emit_block(program, leader) + "\n";
+    }
+    if (blocks.find("goto dispatch;") != std::string::npos) {
+        fprintf(file, "dispatch:\n");
+    }
+    fprintf(file, "    switch (pc) {\n");
+    for (uint16_t leader : program.leaders) {
+        fprintf(file, "        case 0x%03X:\n            goto L_%03X;\n",
+                leader, leader);
+    }
+    fprintf(file, "        default:\n            goto leave;\n    }\n\n");
+    fprintf(file, "%s", blocks.c_str());
+
+    fprintf(file, "leave:\n"
+                  "    SYNC_OUT();\n"
+                  "    AOT_ACCESS::PC(core) = pc;\n"
+                  "    return steps;\n"
+                  "}\n\n");
+    fprintf(file, "extern const AOT_MODULE AOT_%s = {\"%s\", ROM, sizeof(ROM), "
+                  "run_%s};\n",
+            name.c_str(), name.c_str(), name.c_str());
+}
+
+/**
+ * Writes the header declaring the module of a recompiled ROM.
+ * @param name Name of the module
+ * @param file Output file
+ */
+static void write_header(const std::string &name, FILE *file) {
+    std::string guard = "AOT_" + name + "_H";
+    for (char &c : guard) {
+        c = toupper(c);
+    }
+    fprintf(file, "// Generated by chip8_aot, do not edit.\n");
+    fprintf(file, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+    fprintf(file, "#include \"chip8_aot.h\"\n\n");
+    fprintf(file, "extern const AOT_MODULE AOT_%s;\n\n#endif\n", name.c_str());
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 5) {
+        printf("Usage: %s <rom.ch8> <name> <output.cpp> <output.h>\n",
+               argv[0]);
+        return -1;
+    }
+
+    PROGRAM program;
+    FILE *rom_file = fopen(argv[1], "rb");
+    if (rom_file == nullptr) {
+        std::cout << "Unable to open file.\n" << std::endl;
+        return -1;
+    }
+    uint8_t buffer[MAX_PROG_SIZE + 1];
+    size_t size = fread(buffer, 1, sizeof(buffer), rom_file);
+    fclose(rom_file);
+    if (size > MAX_PROG_SIZE) {
+        std::cout << "Program too large.\n" << std::endl;
+        return -1;
+    }
+    program.rom.assign(buffer, buffer + size);
+
+    find_leaders(program);
+    split_long_blocks(program);
+
+    std::string name = argv[2];
+    FILE *source = fopen(argv[3], "w");
+    FILE *header = fopen(argv[4], "w");
+    if (source == nullptr || header == nullptr) {
+        std::cout << "Unable to write output.\n" << std::endl;
+        return -1;
+    }
+    write_source(program, name, argv[1], source);
+    write_header(name, header);
+    fclose(source);
+    fclose(header);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/**
+ * Headless batch runner.  Runs every combination of the given ROMs, seeds and
+ * input scripts for a number of frames on a work-stealing pool and prints one
+ * CSV line per job.
+ *
+ * ROMs can be files, "bundle.pak#name" references to a ROM of a bundle, or
+ * bundles, which stand for every ROM they hold.
+ *
+ * Usage: chip8_batch [options] <rom.ch8 | bundle.pak | bundle.pak#name>...
+ *   -f <frames>   Frames to run each job for, default 600
+ *   -i <steps>    Instructions per frame, default 12
+ *   -j <threads>  Worker threads, default one per hardware thread
+ *   -s <seeds>    Comma separated Cxkk seeds, default 0
+ *   -k <scripts>  Comma separated input scripts, default no input
+ */
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "chip8_batch.h"
+#include "chip8_bundle.h"
+
+#define DEFAULT_FRAMES 600        // Ten seconds of emulated time
+#define DEFAULT_STEPS_PER_FRAME 12
+
+/**
+ * Splits a comma separated list.
+ * @param list The list
+ * @return The items of the list
+ */
+static std::vector<std::string> split(const char *list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+/**
+ * Prints the usage of the tool.
+ * @param name Name the tool was started with
+ */
+static void usage(const char *name) {
+    printf("Usage: %s [-f frames] [-i steps per frame] [-j threads] "
+           "[-s seed,...] [-k script,...] <rom.ch8>...\n",
+           name);
+}
+
+int main(int argc, char *argv[]) {
+    BATCH_OPTIONS options = BATCH_OPTIONS{DEFAULT_FRAMES,
+                                          DEFAULT_STEPS_PER_FRAME};
+    unsigned threads = 0;
+    std::vector<std::string> seeds = {"0"};
+    std::vector<std::string> scripts = {""};
+    std::vector<std::string> roms;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() == 2 && arg[0] == '-' && i + 1 < argc) {
+            const char *value = argv[++i];
+            switch (arg[1]) {
+                case 'f':
+                    options.frames = strtoul(value, nullptr, 10);
+                    continue;
+                case 'i':
+                    options.steps_per_frame = strtoul(value, nullptr, 10);
+                    continue;
+                case 'j':
+                    threads = strtoul(value, nullptr, 10);
+                    continue;
+                case 's':
+                    seeds = split(value);
+                    continue;
+                case 'k':
+                    scripts = split(value);
+                    continue;
+            }
+            usage(argv[0]);
+            return -1;
+        }
+        if (arg.size() > 4 && arg.compare(arg.size() - 4, 4, ".pak") == 0) {
+            // A bundle stands for every ROM it holds
+            ROM_BUNDLE bundle;
+            if (!bundle.open(arg.c_str())) {
+                return -1;
+            }
+            for (const BUNDLE_ENTRY &entry : bundle.get_entries()) {
+                roms.push_back(arg + "#" + entry.name);
+            }
+            continue;
+        }
+        roms.push_back(arg);
+    }
+    if (roms.empty() || seeds.empty() || scripts.empty()) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    // Every ROM runs with every seed and every script
+    std::vector<BATCH_JOB> jobs;
+    for (const std::string &script : scripts) {
+        std::vector<INPUT_EVENT> events;
+        if (!script.empty() && !load_input_script(script.c_str(), events)) {
+            return -1;
+        }
+        for (const std::string &rom : roms) {
+            for (const std::string &seed : seeds) {
+                uint64_t value = strtoull(seed.c_str(), nullptr, 0);
+                jobs.push_back(BATCH_JOB{rom, value, script, events});
+            }
+        }
+    }
+
+    WORK_STEALING_POOL pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BATCH_RESULT> results = run_batch(jobs, options, pool);
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+    printf("rom,seed,script,status,frames,steps,frame_hash,seconds\n");
+    uint64_t total_steps = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const BATCH_RESULT &result = results[i];
+        const char *status = !result.loaded ? "error"
+                             : result.halted ? "halted"
+                                             : "ok";
+        printf("%s,%llu,%s,%s,%u,%llu,%016llx,%.6f\n", jobs[i].rom.c_str(),
+               (unsigned long long) jobs[i].seed, jobs[i].script.c_str(),
+               status, result.frames, (unsigned long long) result.steps,
+               (unsigned long long) result.frame_hash, result.seconds);
+        total_steps += result.steps;
+    }
+    fprintf(stderr,
+            "%zu jobs on %u threads in %.3f s, %.0f instr/s, %llu steals\n",
+            jobs.size(), pool.get_threads(), elapsed.count(),
+            total_steps / elapsed.count(),
+            (unsigned long long) pool.get_steals());
+    return 0;
+}
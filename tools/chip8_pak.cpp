@@ -0,0 +1,155 @@
+/**
+ * ROM bundle tool.  Packs directories of ROMs into one indexed bundle that
+ * the core and the batch runner read as "bundle.pak#name", and lists what a
+ * bundle holds.
+ *
+ * Usage: chip8_pak build <bundle.pak> [-q profile] <dir or rom>...
+ *          -q <profile>  Quirk profile of the ROMs that follow, default 0
+ *        chip8_pak list <bundle.pak>
+ *
+ * Directories contribute their files ending in .ch8 or .c8.
+ */
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <filesystem>
+
+#include "chip8_bundle.h"
+
+namespace fs = std::filesystem;
+
+/**
+ * Prints the usage of the tool.
+ * @param name Name the tool was started with
+ */
+static void usage(const char *name) {
+    printf("Usage: %s build <bundle.pak> [-q profile] <dir or rom>...\n",
+           name);
+    printf("       %s list <bundle.pak>\n", name);
+}
+
+/**
+ * Recognizes ROM files in a directory by their extension, so READMEs and
+ * other files that happen to be small are not bundled.
+ * @param path Path of the file
+ * @return Boolean indicating if the file is named like a ROM
+ */
+static bool is_rom_file(const fs::path &path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return (char) tolower(c); });
+    return extension == ".ch8" || extension == ".c8";
+}
+
+/**
+ * Adds a ROM file to the bundle being built.
+ * @param path Path of the ROM
+ * @param name Name the ROM gets in the bundle
+ * @param quirks Quirk profile of the ROM
+ * @param roms ROMs of the bundle
+ * @return Boolean indicating if the ROM was read
+ */
+static bool add_rom(const fs::path &path, const std::string &name,
+                    uint16_t quirks, std::vector<BUNDLE_ROM> &roms) {
+    MAPPED_ROM rom;
+    if (!rom.open(path.c_str())) {
+        return false;
+    }
+    const uint8_t *data = rom.get_data();
+    roms.push_back(BUNDLE_ROM{
+            name, quirks, std::vector<uint8_t>(data, data + rom.get_size())});
+    return true;
+}
+
+/**
+ * Builds a bundle of ROM files and of the ROM files under directories, named
+ * by their path relative to the directory.  Named files must be ROMs, files
+ * in directories that fail to load are reported and left out.
+ * @param out Path of the bundle
+ * @param argc Number of arguments after the bundle
+ * @param argv Quirk options, ROMs and directories
+ * @return Exit code of the tool
+ */
+static int build(const char *out, int argc, char *argv[]) {
+    std::vector<BUNDLE_ROM> roms;
+    uint16_t quirks = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            quirks = (uint16_t) strtoul(argv[++i], nullptr, 10);
+            continue;
+        }
+
+        fs::path input = argv[i];
+        std::error_code error;
+        if (!fs::is_directory(input, error)) {
+            if (!add_rom(input, input.filename().string(), quirks, roms)) {
+                return -1;
+            }
+            continue;
+        }
+
+        // Walk the directory in a stable order
+        std::vector<fs::path> files;
+        for (const fs::directory_entry &entry :
+             fs::recursive_directory_iterator(input, error)) {
+            if (entry.is_regular_file() && is_rom_file(entry.path())) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const fs::path &file : files) {
+            std::string name = file.lexically_relative(input).generic_string();
+            if (!add_rom(file, name, quirks, roms)) {
+                printf("Skipped %s\n", file.c_str());
+            }
+        }
+    }
+
+    // Names must be unique, later ones would be unreachable
+    std::vector<std::string> names;
+    for (const BUNDLE_ROM &rom : roms) {
+        names.push_back(rom.name);
+    }
+    std::sort(names.begin(), names.end());
+    auto repeated = std::adjacent_find(names.begin(), names.end());
+    if (repeated != names.end()) {
+        printf("Two ROMs are named %s\n", repeated->c_str());
+        return -1;
+    }
+
+    if (!write_bundle(out, roms)) {
+        return -1;
+    }
+    printf("%zu ROMs bundled into %s\n", roms.size(), out);
+    return 0;
+}
+
+/**
+ * Lists the ROMs of a bundle.
+ * @param path Path of the bundle
+ * @return Exit code of the tool
+ */
+static int list(const char *path) {
+    ROM_BUNDLE bundle;
+    if (!bundle.open(path)) {
+        return -1;
+    }
+    printf("name,size,offset,quirks,hash\n");
+    for (const BUNDLE_ENTRY &entry : bundle.get_entries()) {
+        printf("%s,%u,%u,%u,%016llx\n", entry.name.c_str(), entry.size,
+               entry.offset, entry.quirks, (unsigned long long) entry.hash);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "list") == 0) {
+        return list(argv[2]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "build") == 0) {
+        return build(argv[2], argc - 3, argv + 3);
+    }
+    usage(argv[0]);
+    return -1;
+}
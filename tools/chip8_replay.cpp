@@ -0,0 +1,83 @@
+/**
+ * Headless movie player.  Replays a movie recorded by the SDL frontend at
+ * full speed, optionally starting at a frame, and reports whether the
+ * replay ended on the same screen as the recording.
+ *
+ * Usage: chip8_replay [options] <movie.c8m>
+ *   -s <frame>    Frame to seek to before replaying, default 0
+ *   -n <repeats>  Times to replay, for benchmarking, default 1
+ */
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+
+#include "chip8_batch.h"
+#include "chip8_movie.h"
+
+/**
+ * Prints the usage of the tool.
+ * @param name Name the tool was started with
+ */
+static void usage(const char *name) {
+    printf("Usage: %s [-s frame] [-n repeats] <movie.c8m>\n", name);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t start_frame = 0;
+    uint32_t repeats = 1;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            start_frame = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repeats = strtoul(argv[++i], nullptr, 10);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == nullptr || repeats == 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    CHIP8MOVIE movie;
+    if (!movie.load(path)) {
+        return -1;
+    }
+
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    double seek_seconds = 0, replay_seconds = 0;
+    uint64_t replayed_steps = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!movie.seek(*core, start_frame)) {
+            printf("Movie has only %u frames\n", movie.get_frames());
+            return -1;
+        }
+        auto seeked = std::chrono::steady_clock::now();
+        uint64_t seek_steps = movie.get_steps();
+        while (!movie.is_finished()) {
+            movie.run_frame(*core);
+        }
+        std::chrono::duration<double> seek = seeked - start;
+        std::chrono::duration<double> replay =
+                std::chrono::steady_clock::now() - seeked;
+        seek_seconds += seek.count();
+        replay_seconds += replay.count();
+        replayed_steps += movie.get_steps() - seek_steps;
+    }
+
+    uint64_t hash = hash_frame_buffer(core->get_frame_buffer());
+    bool match = hash == movie.get_final_hash() && !movie.is_desynced();
+    printf("frames %u, events %zu, keyframes %zu, seed %llu\n",
+           movie.get_frames(), movie.get_events().size(),
+           movie.get_keyframes().size(),
+           (unsigned long long) movie.get_seed());
+    printf("frame hash %016llx, %s\n", (unsigned long long) hash,
+           match ? "matches the recording" : "DIFFERS from the recording");
+    printf("seek %.3f ms, replay %.3f ms, %.1f million instructions/s\n",
+           1e3 * seek_seconds / repeats, 1e3 * replay_seconds / repeats,
+           replayed_steps / replay_seconds / 1e6);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/**
+ * Save state converter.  Rewrites a state file of the legacy fixed layout,
+ * or a raw serialized state, in the compact state file format, and prints
+ * what a compact state file holds.
+ *
+ * Usage: chip8_state convert [-f color] <old.sv> <new.sv>
+ *          -f <color>  Hex color lit pixels were drawn in, default ffffff
+ *        chip8_state info <state.sv>
+ */
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "chip8_state_file.h"
+
+#define DEFAULT_FOREGROUND 0xFFFFFF  // The frontend's initial pixel color
+
+/**
+ * Prints the usage of the tool.
+ * @param name Name the tool was started with
+ */
+static void usage(const char *name) {
+    printf("Usage: %s convert [-f color] <old.sv> <new.sv>\n", name);
+    printf("       %s info <state.sv>\n", name);
+}
+
+/**
+ * Reads a whole file.
+ * @param path Path of the file
+ * @param data Receives the contents
+ * @return Boolean indicating if the file was read
+ */
+static bool read_file(const char *path, std::vector<uint8_t> &data) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr) {
+        printf("Unable to open %s\n", path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t bytes_read;
+    while ((bytes_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + bytes_read);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Converts a legacy or serialized state into a compact state file.
+ * @param in Path of the state to convert
+ * @param out Path of the compact state file to write
+ * @param foreground Color lit pixels of a legacy state were drawn in
+ * @return Exit code of the tool
+ */
+static int convert(const char *in, const char *out, uint32_t foreground) {
+    std::vector<uint8_t> data;
+    if (!read_file(in, data)) {
+        return -1;
+    }
+
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    std::unique_ptr<MACHINE_STATE> state(new MACHINE_STATE());
+    STATE_PALETTE palette = {0, foreground};
+    if (convert_legacy_state(data.data(), data.size(), foreground, *state,
+                             palette)) {
+        core->set_state(*state);
+    } else if (!core->deserialize(data.data(), data.size())) {
+        printf("%s is neither a legacy nor a serialized state\n", in);
+        return -1;
+    }
+
+    uint8_t serialized[SERIALIZED_STATE_SIZE], packed[STATE_FILE_MAX_SIZE];
+    core->serialize(serialized, sizeof(serialized));
+    size_t size = pack_state(serialized, palette, packed, sizeof(packed));
+    FILE *file = fopen(out, "wb");
+    if (file == nullptr || fwrite(packed, 1, size, file) != size) {
+        printf("Unable to write %s\n", out);
+        if (file != nullptr) {
+            fclose(file);
+        }
+        return -1;
+    }
+    fclose(file);
+    printf("%s: %zu bytes -> %s: %zu bytes\n", in, data.size(), out, size);
+    return 0;
+}
+
+/**
+ * Prints the registers and colors of a compact state file.
+ * @param path Path of the state file
+ * @return Exit code of the tool
+ */
+static int info(const char *path) {
+    std::vector<uint8_t> data;
+    if (!read_file(path, data)) {
+        return -1;
+    }
+    uint8_t serialized[SERIALIZED_STATE_SIZE];
+    STATE_PALETTE palette;
+    std::unique_ptr<CHIP8CORE> core(new CHIP8CORE());
+    if (!unpack_state(data.data(), data.size(), serialized, palette) ||
+        !core->deserialize(serialized, sizeof(serialized))) {
+        printf("%s is not an intact compact state file\n", path);
+        return -1;
+    }
+    const MACHINE_STATE &state = core->get_state();
+    printf("%zu bytes, PC %03X, I %03X, SP %02X, DT %u, ST %u\n", data.size(),
+           state.REGS.PC, state.REGS.I, state.REGS.SP, state.REGS.DT,
+           state.REGS.ST);
+    printf("foreground %06X, background %06X\n", palette.foreground,
+           palette.background);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return info(argv[2]);
+    }
+    if (argc < 2 || strcmp(argv[1], "convert") != 0) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    uint32_t foreground = DEFAULT_FOREGROUND;
+    const char *paths[2] = {nullptr, nullptr};
+    int num_paths = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            foreground = strtoul(argv[++i], nullptr, 16);
+        } else if (num_paths < 2) {
+            paths[num_paths++] = argv[i];
+        } else {
+            num_paths++;
+        }
+    }
+    if (num_paths != 2) {
+        usage(argv[0]);
+        return -1;
+    }
+    return convert(paths[0], paths[1], foreground);
+}